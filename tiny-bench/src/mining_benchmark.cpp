@@ -47,8 +47,7 @@ static std::vector<uint8_t> make_test_prefix()
 
 static std::vector<uint8_t> make_target(uint8_t bits)
 {
-    uint256_t target = uint256_t(1) << (255 - bits);
-    return PoW::target_to_bytes(target);
+    return PoW::target_to_bytes(PoW::get_target(bits));
 }
 
 static bool verify_nonce(const std::vector<uint8_t>& prefix, uint64_t nonce, const std::vector<uint8_t>& target)
@@ -66,7 +65,7 @@ static bool verify_nonce(const std::vector<uint8_t>& prefix, uint64_t nonce, con
         std::memcpy(full_header.data() + prefix.size(), &le_nonce, 8);
     }
 
-    auto hash = SHA256::double_hash_binary(full_header);
+    const auto hash = SHA256::double_hash(full_header);
     for (size_t i = 0; i < 32; i++)
     {
         if (hash[i] < target[i])
@@ -83,7 +83,7 @@ std::string Block::id() const
 	std::scoped_lock lock(cached_id_mutex_);
 
 	if (cached_id_.empty())
-		cached_id_ = Utils::byte_array_to_hex_string(SHA256::double_hash_binary(header().get_buffer()));
+		cached_id_ = Utils::byte_array_to_hex_string(SHA256::double_hash(header().get_buffer()));
 
 	return cached_id_;
 }
@@ -99,7 +99,7 @@ BinaryBuffer Block::serialize() const
 	return buffer;
 }
 
-bool Block::deserialize(BinaryBuffer& buffer)
+bool Block::deserialize_header(BinaryBuffer& buffer)
 {
 	uint64_t new_version = 0;
 	if (!buffer.read(new_version))
@@ -125,6 +125,24 @@ bool Block::deserialize(BinaryBuffer& buffer)
 	if (!buffer.read(new_nonce))
 		return false;
 
+	version = new_version;
+	prev_block_hash = std::move(new_prev_block_hash);
+	merkle_hash = std::move(new_merkle_hash);
+	timestamp = new_timestamp;
+	bits = new_bits;
+	nonce = new_nonce;
+	txs.clear();
+	cached_id_.clear();
+
+	return true;
+}
+
+bool Block::deserialize(BinaryBuffer& buffer)
+{
+	Block new_header;
+	if (!new_header.deserialize_header(buffer))
+		return false;
+
 	uint32_t txs_size = 0;
 	if (!buffer.read_size(txs_size))
 		return false;
@@ -139,14 +157,8 @@ bool Block::deserialize(BinaryBuffer& buffer)
 		new_txs.push_back(std::move(tx));
 	}
 
-	version = new_version;
-	prev_block_hash = std::move(new_prev_block_hash);
-	merkle_hash = std::move(new_merkle_hash);
-	timestamp = new_timestamp;
-	bits = new_bits;
-	nonce = new_nonce;
+	*this = std::move(new_header);
 	txs = std::move(new_txs);
-	cached_id_.clear();
 
 	return true;
 }
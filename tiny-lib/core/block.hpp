@@ -44,6 +44,8 @@ public:
 
 	BinaryBuffer serialize() const override;
 	bool deserialize(BinaryBuffer& buffer) override;
+	// Reads only what header() writes and leaves txs empty, as sent during headers-first sync
+	bool deserialize_header(BinaryBuffer& buffer);
 
 	bool operator==(const Block& obj) const;
 
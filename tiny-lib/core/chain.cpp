@@ -40,6 +40,8 @@ std::vector<std::vector<std::shared_ptr<Block>>> Chain::side_branches{};
 std::unordered_multimap<std::string, OrphanBlock> Chain::orphan_blocks{};
 
 std::unordered_map<std::string, uint32_t> Chain::active_chain_index{ { genesis_block->id(), 0 } };
+std::unordered_map<std::string, uint256_t> Chain::chain_work_index{
+	{ genesis_block->id(), PoW::get_block_work(genesis_block->bits) } };
 
 std::recursive_mutex Chain::mutex;
 
@@ -49,6 +51,9 @@ std::atomic_bool Chain::assume_valid_pending = !NetParams::ASSUME_VALID_BLOCK_HA
 
 uint32_t Chain::last_saved_height = 0;
 
+std::vector<Chain::MedianTimePastEntry> Chain::active_chain_mtp{
+	{ genesis_block, genesis_block->timestamp } };
+
 uint32_t Chain::get_current_height()
 {
 	std::scoped_lock lock(mutex);
@@ -60,27 +65,51 @@ int64_t Chain::get_median_time_past(uint32_t num_last_blocks)
 {
 	std::scoped_lock lock(mutex);
 
-	if (num_last_blocks > active_chain.size())
+	if (num_last_blocks == 0 || num_last_blocks > active_chain.size())
 		return 0;
 
-	const uint32_t first_idx = static_cast<uint32_t>(active_chain.size()) - num_last_blocks;
+	return get_median_time_past_at_height(static_cast<uint32_t>(active_chain.size()) - 1, num_last_blocks);
+}
 
-	std::vector<int64_t> timestamps;
-	timestamps.reserve(num_last_blocks);
-	for (uint32_t i = first_idx; i < active_chain.size(); i++)
-		timestamps.push_back(active_chain[i]->timestamp);
-	std::ranges::sort(timestamps);
+int64_t Chain::get_median_time_past_at_height(uint32_t height,
+	uint32_t num_last_blocks /*= NetParams::MEDIAN_TIME_PAST_BLOCKS*/)
+{
+	std::scoped_lock lock(mutex);
 
-	return timestamps[num_last_blocks / 2];
+	if (height >= active_chain.size())
+		return 0;
+
+	if (num_last_blocks == NetParams::MEDIAN_TIME_PAST_BLOCKS && height < active_chain_mtp.size() &&
+		active_chain_mtp[height].block == active_chain[height])
+		return active_chain_mtp[height].median_time_past;
+
+	return compute_median_time_past_at_height(height, num_last_blocks);
 }
 
-int64_t Chain::get_median_time_past_at_height(uint32_t height, uint32_t num_last_blocks /*= 11*/)
+Tx::ValidationContext Chain::get_validation_context()
 {
 	std::scoped_lock lock(mutex);
 
-	if (height >= active_chain.size())
+	return { static_cast<int64_t>(active_chain.size()), get_median_time_past(NetParams::MEDIAN_TIME_PAST_BLOCKS) };
+}
+
+int64_t Chain::get_median_time_past_before(int64_t height, const std::function<int64_t(int64_t)>& get_timestamp)
+{
+	constexpr int64_t count = NetParams::MEDIAN_TIME_PAST_BLOCKS;
+	if (height < count)
 		return 0;
 
+	std::vector<int64_t> timestamps;
+	timestamps.reserve(count);
+	for (int64_t i = height - count; i < height; i++)
+		timestamps.push_back(get_timestamp(i));
+	std::ranges::nth_element(timestamps, timestamps.begin() + count / 2);
+
+	return timestamps[count / 2];
+}
+
+int64_t Chain::compute_median_time_past_at_height(uint32_t height, uint32_t num_last_blocks)
+{
 	const uint32_t count = std::min(num_last_blocks, height + 1);
 	const uint32_t first_idx = height + 1 - count;
 
@@ -88,7 +117,7 @@ int64_t Chain::get_median_time_past_at_height(uint32_t height, uint32_t num_last
 	timestamps.reserve(count);
 	for (uint32_t i = first_idx; i <= height; i++)
 		timestamps.push_back(active_chain[i]->timestamp);
-	std::ranges::sort(timestamps);
+	std::ranges::nth_element(timestamps, timestamps.begin() + count / 2);
 
 	return timestamps[count / 2];
 }
@@ -117,8 +146,7 @@ uint32_t Chain::validate_block(const std::shared_ptr<Block>& block)
 	if (block->timestamp - Utils::get_unix_timestamp() > static_cast<int64_t>(NetParams::MAX_FUTURE_BLOCK_TIME_IN_SECS))
 		throw BlockValidationException("Block timestamp too far in future");
 
-	const uint256_t target_hash = uint256_t(1) << (std::numeric_limits<uint8_t>::max() - block->bits);
-	if (!HashChecker::is_valid(block->id(), target_hash))
+	if (!HashChecker::is_valid(block->id(), PoW::get_target(block->bits)))
 		throw BlockValidationException("Block header does not satisfy bits");
 
 	if (!txs.front()->is_coinbase())
@@ -149,7 +177,9 @@ uint32_t Chain::validate_block(const std::shared_ptr<Block>& block)
 	if (MerkleTree::get_root_of_txs(txs)->value != block->merkle_hash)
 		throw BlockValidationException("Merkle hash invalid");
 
-	if (block->timestamp <= get_median_time_past(11))
+	const auto context = get_validation_context();
+
+	if (block->timestamp <= context.median_time_past)
 		throw BlockValidationException("timestamp too old");
 
 	uint32_t prev_block_chain_idx;
@@ -175,10 +205,10 @@ uint32_t Chain::validate_block(const std::shared_ptr<Block>& block)
 	if (PoW::get_next_work_required(block->prev_block_hash) != block->bits)
 		throw BlockValidationException("Bits incorrect");
 
-	const int64_t block_height = static_cast<int64_t>(active_chain.size());
-	const int64_t block_mtp = get_median_time_past(11);
+	const int64_t block_height = context.height;
 
 	Tx::ValidateRequest req;
+	req.context = context;
 	req.siblings_in_block.reserve(block->txs.size() - 1);
 	req.siblings_in_block.assign(block->txs.begin() + 1, block->txs.end());
 	req.allow_utxo_from_mempool = false;
@@ -188,8 +218,6 @@ uint32_t Chain::validate_block(const std::shared_ptr<Block>& block)
 	{
 		try
 		{
-			non_coinbase_tx->check_lock_time(block_height, block_mtp);
-			non_coinbase_tx->check_sequence_locks(block_height, block_mtp);
 			non_coinbase_tx->validate(req);
 		}
 		catch (const TxValidationException& ex)
@@ -321,19 +349,30 @@ int64_t Chain::connect_block(const std::shared_ptr<Block>& block, bool doing_reo
 
 	auto& chain = chain_idx == ACTIVE_CHAIN_IDX ? active_chain : side_branches[chain_idx - 1];
 	chain.push_back(block);
+	index_chain_work(block);
 
 	if (chain_idx == ACTIVE_CHAIN_IDX)
 	{
 		index_block(block, static_cast<uint32_t>(chain.size()) - 1);
 
+		std::vector<std::pair<std::string, uint64_t>> tx_fee_rates;
 		for (const auto& tx : block->txs)
 		{
 			const auto tx_id = tx->id();
 
+			if (!tx->is_coinbase())
+			{
+				// While the inputs are still unspent, including those created earlier in the block
+				const uint32_t tx_size = tx->serialize().get_size();
+				tx_fee_rates.emplace_back(tx_id, tx_size > 0 ? PoW::calculate_fees(tx) / tx_size : 0);
+			}
+
 			{
 				std::scoped_lock lock_mempool(Mempool::mutex);
 
 				Mempool::remove_entry(tx_id);
+				if (!tx->is_coinbase())
+					Mempool::remove_conflicts(tx);
 			}
 
 			if (!tx->is_coinbase())
@@ -348,10 +387,9 @@ int64_t Chain::connect_block(const std::shared_ptr<Block>& block, bool doing_reo
 				UTXO::add_to_map(tx->tx_outs[i], tx_id, i, tx->is_coinbase(), chain.size());
 			}
 		}
-	}
 
-	if (chain_idx == ACTIVE_CHAIN_IDX)
-		FeeEstimator::record_block(block);
+		FeeEstimator::record_block(block_id, tx_fee_rates);
+	}
 
 	if (assume_valid_pending.load() && block_id == NetParams::ASSUME_VALID_BLOCK_HASH)
 	{
@@ -410,6 +448,9 @@ std::shared_ptr<Block> Chain::disconnect_block(const std::shared_ptr<Block>& blo
 	if (block_id != back->id())
 		throw std::runtime_error("Block being disconnected must be the tip");
 
+	// Rolls the estimator's height back first, so the txs returning to the pool are timed from it
+	FeeEstimator::unrecord_block(block_id);
+
 	{
 		std::scoped_lock lock_mempool(Mempool::mutex);
 
@@ -417,18 +458,6 @@ std::shared_ptr<Block> Chain::disconnect_block(const std::shared_ptr<Block>& blo
 		{
 			const auto tx_id = tx->id();
 
-			if (!tx->is_coinbase())
-			{
-				Mempool::MempoolEntry entry;
-				entry.tx = tx;
-				entry.serialized_size = tx->serialize().get_size();
-				entry.fee = PoW::calculate_fees(tx);
-				entry.fee_rate = entry.serialized_size > 0 ? entry.fee / entry.serialized_size : 0;
-				entry.insertion_time = std::chrono::steady_clock::now();
-				Mempool::total_size_bytes += entry.serialized_size;
-				Mempool::map[tx_id] = std::move(entry);
-			}
-
 			for (const auto& tx_in : tx->tx_ins)
 			{
 				if (tx_in->to_spend != nullptr)
@@ -442,11 +471,23 @@ std::shared_ptr<Block> Chain::disconnect_block(const std::shared_ptr<Block>& blo
 			{
 				UTXO::remove_from_map(tx_id, i);
 			}
+
+			// With its inputs unspent again, so its fee can be worked out
+			if (!tx->is_coinbase())
+			{
+				Mempool::MempoolEntry entry;
+				entry.tx = tx;
+				entry.serialized_size = tx->serialize().get_size();
+				entry.fee = PoW::calculate_fees(tx);
+				entry.fee_rate = entry.serialized_size > 0 ? entry.fee / entry.serialized_size : 0;
+				entry.insertion_time = std::chrono::steady_clock::now();
+				const auto fee_rate = entry.fee_rate;
+				Mempool::insert_entry(tx_id, std::move(entry));
+				FeeEstimator::track_tx(tx_id, fee_rate);
+			}
 		}
 	}
 
-	FeeEstimator::unrecord_block(block_id);
-
 	unindex_block(active_chain.back());
 	active_chain.pop_back();
 
@@ -476,6 +517,16 @@ std::vector<std::shared_ptr<Block>> Chain::disconnect_to_fork(const std::shared_
 
 uint256_t Chain::get_chain_work(const std::vector<std::shared_ptr<Block>>& chain)
 {
+	std::scoped_lock lock(mutex);
+
+	if (chain.empty())
+		return 0;
+
+	const auto it = chain_work_index.find(chain.back()->id());
+	if (it != chain_work_index.end())
+		return it->second;
+
+	// Chains that were not assembled through connect_block have no index entries
 	uint256_t total_work = 0;
 	for (const auto& block : chain)
 		total_work += PoW::get_block_work(block->bits);
@@ -483,6 +534,24 @@ uint256_t Chain::get_chain_work(const std::vector<std::shared_ptr<Block>>& chain
 	return total_work;
 }
 
+uint256_t Chain::get_chain_work_at_height(uint32_t height)
+{
+	std::scoped_lock lock(mutex);
+
+	if (height >= active_chain.size())
+		return 0;
+
+	const auto it = chain_work_index.find(active_chain[height]->id());
+	if (it != chain_work_index.end())
+		return it->second;
+
+	uint256_t total_work = 0;
+	for (uint32_t i = 0; i <= height; i++)
+		total_work += PoW::get_block_work(active_chain[i]->bits);
+
+	return total_work;
+}
+
 bool Chain::reorg_if_necessary()
 {
 	std::scoped_lock lock(mutex);
@@ -497,11 +566,19 @@ bool Chain::reorg_if_necessary()
 	{
 		auto [fork_block, fork_height] = locate_block_in_active_chain(chain[0]->prev_block_hash);
 
-		std::vector<std::shared_ptr<Block>> full_branch(active_chain.begin(),
-			active_chain.begin() + fork_height + 1);
-		full_branch.insert(full_branch.end(), chain.begin(), chain.end());
+		uint256_t branch_work;
+		if (const auto it = chain_work_index.find(chain.back()->id()); it != chain_work_index.end())
+		{
+			branch_work = it->second;
+		}
+		else
+		{
+			std::vector<std::shared_ptr<Block>> full_branch(active_chain.begin(),
+				active_chain.begin() + fork_height + 1);
+			full_branch.insert(full_branch.end(), chain.begin(), chain.end());
 
-		const uint256_t branch_work = get_chain_work(full_branch);
+			branch_work = get_chain_work(full_branch);
+		}
 		if (branch_work > active_chain_work)
 		{
 			LOG_INFO("Attempting reorg of idx {} to active chain, branch chainwork {} vs active {}",
@@ -745,8 +822,7 @@ bool Chain::load_from_disk()
 					rebuild_active_chain_index();
 					side_branches.clear();
 					UTXO::map.clear();
-					Mempool::map.clear();
-					Mempool::total_size_bytes = 0;
+					Mempool::clear();
 
 					LOG_ERROR("Load chain failed, starting from genesis");
 
@@ -775,10 +851,11 @@ void Chain::reset()
 	std::scoped_lock lock(mutex);
 	active_chain.clear();
 	active_chain_index.clear();
+	active_chain_mtp.clear();
+	chain_work_index.clear();
 	side_branches.clear();
 	orphan_blocks.clear();
-	Mempool::map.clear();
-	Mempool::total_size_bytes = 0;
+	Mempool::clear();
 	UTXO::map.clear();
 	FeeEstimator::reset();
 	SigCache::clear();
@@ -789,18 +866,43 @@ void Chain::reset()
 void Chain::index_block(const std::shared_ptr<Block>& block, uint32_t height)
 {
 	active_chain_index[block->id()] = height;
+
+	active_chain_mtp.resize(std::min<size_t>(active_chain_mtp.size(), height));
+	active_chain_mtp.push_back({ block,
+		compute_median_time_past_at_height(height, NetParams::MEDIAN_TIME_PAST_BLOCKS) });
+}
+
+void Chain::index_chain_work(const std::shared_ptr<Block>& block)
+{
+	uint256_t prev_work = 0;
+	if (!block->prev_block_hash.empty())
+	{
+		const auto it = chain_work_index.find(block->prev_block_hash);
+		if (it == chain_work_index.end())
+			return;
+		prev_work = it->second;
+	}
+
+	chain_work_index[block->id()] = prev_work + PoW::get_block_work(block->bits);
 }
 
 void Chain::unindex_block(const std::shared_ptr<Block>& block)
 {
 	active_chain_index.erase(block->id());
+
+	if (!active_chain_mtp.empty() && active_chain_mtp.back().block == block)
+		active_chain_mtp.pop_back();
 }
 
 void Chain::rebuild_active_chain_index()
 {
 	active_chain_index.clear();
+	active_chain_mtp.clear();
+	active_chain_mtp.reserve(active_chain.size());
 	for (uint32_t i = 0; i < active_chain.size(); i++)
 	{
 		active_chain_index[active_chain[i]->id()] = i;
+		active_chain_mtp.push_back({ active_chain[i],
+			compute_median_time_past_at_height(i, NetParams::MEDIAN_TIME_PAST_BLOCKS) });
 	}
 }
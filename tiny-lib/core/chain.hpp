@@ -1,6 +1,7 @@
 #pragma once
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -10,6 +11,7 @@
 #include <vector>
 
 #include "core/block.hpp"
+#include "core/net_params.hpp"
 #include "core/tx.hpp"
 #include "core/tx_in.hpp"
 #include "core/tx_out.hpp"
@@ -45,9 +47,15 @@ public:
 	static uint32_t get_current_height();
 	static int64_t get_median_time_past(uint32_t num_last_blocks);
 
-	static int64_t get_median_time_past_at_height(uint32_t height, uint32_t num_last_blocks = 11);
+	static int64_t get_median_time_past_at_height(uint32_t height,
+		uint32_t num_last_blocks = NetParams::MEDIAN_TIME_PAST_BLOCKS);
+	static Tx::ValidationContext get_validation_context();
+	// Median time past a block at height must exceed, over the MEDIAN_TIME_PAST_BLOCKS ancestors
+	// get_timestamp returns. 0 while there are fewer, the same rule get_validation_context applies.
+	static int64_t get_median_time_past_before(int64_t height, const std::function<int64_t(int64_t)>& get_timestamp);
 
 	static uint256_t get_chain_work(const std::vector<std::shared_ptr<Block>>& chain);
+	static uint256_t get_chain_work_at_height(uint32_t height);
 
 	static uint32_t validate_block(const std::shared_ptr<Block>& block);
 
@@ -80,9 +88,24 @@ private:
 	static constexpr char CHAIN_PATH[] = "chain.dat";
 
 	static std::unordered_map<std::string, uint32_t> active_chain_index;
+	// Cumulative work from the root up to and including each connected block, in any chain.
+	// Keyed by block id, so entries stay valid across reorgs.
+	static std::unordered_map<std::string, uint256_t> chain_work_index;
 	static uint32_t last_saved_height;
 
+	// Median time past over NetParams::MEDIAN_TIME_PAST_BLOCKS per active chain height, maintained
+	// alongside active_chain_index. An entry is only used while its block is still at that height.
+	struct MedianTimePastEntry
+	{
+		std::shared_ptr<Block> block;
+		int64_t median_time_past;
+	};
+	static std::vector<MedianTimePastEntry> active_chain_mtp;
+
+	static int64_t compute_median_time_past_at_height(uint32_t height, uint32_t num_last_blocks);
+
 	static void index_block(const std::shared_ptr<Block>& block, uint32_t height);
+	static void index_chain_work(const std::shared_ptr<Block>& block);
 	static void unindex_block(const std::shared_ptr<Block>& block);
 	static void rebuild_active_chain_index();
 };
@@ -1,24 +1,54 @@
 #include "core/mempool.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <latch>
 #include <ranges>
+#include <span>
+#include <unordered_set>
 #include <utility>
+#include <boost/asio/post.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "util/binary_buffer.hpp"
 #include "util/exceptions.hpp"
 #include "util/log.hpp"
+#include "util/memory_usage.hpp"
+#include "util/random.hpp"
+#include "util/utils.hpp"
 #include "net/net_client.hpp"
 #include "core/net_params.hpp"
+#include "mining/fee_estimator.hpp"
 #include "mining/pow.hpp"
 #include "net/tx_info_msg.hpp"
 
 std::unordered_map<std::string, Mempool::MempoolEntry> Mempool::map;
+std::unordered_map<std::shared_ptr<TxOutPoint>, std::string, TxOutPointHash, TxOutPointEqual> Mempool::spenders;
 
-std::vector<std::shared_ptr<Tx>> Mempool::orphaned_txs;
+std::unordered_map<std::string, Mempool::OrphanTx> Mempool::orphan_txs;
+std::unordered_map<std::shared_ptr<TxOutPoint>, std::unordered_set<std::string>, TxOutPointHash, TxOutPointEqual>
+	Mempool::orphans_by_outpoint;
+uint64_t Mempool::orphan_txs_size_bytes = 0;
 
 std::recursive_mutex Mempool::mutex;
 
 uint64_t Mempool::total_size_bytes = 0;
+uint64_t Mempool::total_memory_usage = 0;
+
+FeeRateHistogram Mempool::fee_histogram;
+
+std::set<std::pair<uint64_t, std::string>> Mempool::eviction_index;
+std::set<std::pair<std::chrono::steady_clock::time_point, std::string>> Mempool::expiry_index;
+
+uint64_t Mempool::rolling_min_fee_per_kb = 0;
+std::chrono::steady_clock::time_point Mempool::rolling_min_fee_updated;
+
+Mempool::BlockTemplate Mempool::block_template;
+std::unordered_set<std::string> Mempool::block_template_tx_ids;
+bool Mempool::block_template_dirty = false;
+bool Mempool::block_template_complete = true;
 
 std::shared_ptr<UTXO> Mempool::find_utxo_in_mempool(const std::shared_ptr<TxOutPoint>& tx_out_point)
 {
@@ -46,46 +76,338 @@ std::shared_ptr<Block> Mempool::select_from_mempool(const std::shared_ptr<Block>
 	std::scoped_lock lock(mutex);
 
 	auto new_block = std::make_shared<Block>(*block);
+	const auto txs = select_txs(new_block->serialize().get_size());
+	new_block->txs.insert(new_block->txs.end(), txs.begin(), txs.end());
+
+	return new_block;
+}
+
+Mempool::BlockTemplate Mempool::get_block_template()
+{
+	std::scoped_lock lock(mutex);
 
-	std::set<std::string> added_to_block;
-	uint32_t current_block_size = new_block->serialize().get_size();
+	if (block_template_dirty)
+	{
+		block_template = BlockTemplate();
+		block_template_tx_ids.clear();
+		for (const auto& tx : select_txs(BLOCK_TEMPLATE_RESERVED_SIZE))
+		{
+			const auto tx_id = tx->id();
+			const auto& entry = map.at(tx_id);
 
-	while (true)
+			block_template.txs.push_back(tx);
+			block_template.fees += entry.fee;
+			block_template.size += entry.serialized_size;
+			block_template_tx_ids.insert(tx_id);
+		}
+		block_template_dirty = false;
+		block_template_complete = block_template.txs.size() == map.size();
+	}
+	else if (block_template.txs.size() != block_template_tx_ids.size())
 	{
-		std::string best_tx_id;
-		uint64_t best_effective_rate = 0;
+		std::erase_if(block_template.txs, [](const auto& tx) { return !block_template_tx_ids.contains(tx->id()); });
+	}
 
-		for (const auto& [tx_id, entry] : map)
+	return block_template;
+}
+
+std::vector<std::shared_ptr<Tx>> Mempool::select_txs(uint32_t current_block_size)
+{
+	std::vector<std::shared_ptr<Tx>> txs;
+
+	auto entries = build_assembly_entries();
+
+	// Ordered by package score, the best candidate last
+	std::set<std::pair<uint64_t, std::string>> queue;
+	for (const auto& [tx_id, entry] : entries)
+		queue.emplace(entry.score(), tx_id);
+
+	std::unordered_set<std::string> added_to_block;
+
+	while (!queue.empty())
+	{
+		const auto best_it = std::prev(queue.end());
+		const auto best_tx_id = best_it->second;
+		queue.erase(best_it);
+
+		const auto& best_entry = entries.at(best_tx_id);
+
+		std::vector<std::string> package;
+		package.reserve(best_entry.ancestors.size() + 1);
+		for (const auto& anc_id : best_entry.ancestors)
 		{
-			if (added_to_block.contains(tx_id))
-				continue;
+			if (!added_to_block.contains(anc_id))
+				package.push_back(anc_id);
+		}
+		package.push_back(best_tx_id);
 
-			const uint64_t pkg_rate = compute_ancestor_package_fee_rate(tx_id, added_to_block);
-			const uint64_t effective_rate = std::max(entry.fee_rate, pkg_rate);
+		// A tx always has more ancestors than any of its ancestors, so this puts parents first
+		std::ranges::sort(package, {}, [&entries](const auto& tx_id) { return entries.at(tx_id).ancestors.size(); });
 
-			if (effective_rate > best_effective_rate || best_tx_id.empty())
+		if (std::ranges::any_of(package, [&entries](const auto& tx_id) { return entries.at(tx_id).missing_inputs; }))
+		{
+			LOG_ERROR("Unable to find UTXO for an input of {} or its ancestors, skipping it", best_tx_id);
+
+			continue;
+		}
+
+		uint32_t package_size = 0;
+		for (const auto& tx_id : package)
+			package_size += entries.at(tx_id).entry->serialized_size;
+		if (!check_block_size(current_block_size + package_size))
+			continue;
+
+		for (const auto& tx_id : package)
+		{
+			const auto& entry = entries.at(tx_id);
+			queue.erase({ entry.score(), tx_id });
+
+			txs.push_back(entry.entry->tx);
+			added_to_block.insert(tx_id);
+
+			LOG_TRACE("Selected transaction {} for block", tx_id);
+		}
+		current_block_size += package_size;
+
+		// Only descendants of what was just included change their package score
+		for (const auto& tx_id : package)
+		{
+			const auto& included = *entries.at(tx_id).entry;
+
+			std::unordered_set<std::string> visited;
+			std::vector<std::string> stack(included.children.begin(), included.children.end());
+			while (!stack.empty())
 			{
-				best_effective_rate = effective_rate;
-				best_tx_id = tx_id;
+				const auto desc_id = std::move(stack.back());
+				stack.pop_back();
+				if (added_to_block.contains(desc_id) || !visited.insert(desc_id).second)
+					continue;
+
+				auto& desc = entries.at(desc_id);
+				queue.erase({ desc.score(), desc_id });
+				desc.ancestor_fee -= included.fee;
+				desc.ancestor_size -= included.serialized_size;
+				queue.emplace(desc.score(), desc_id);
+
+				stack.insert(stack.end(), desc.entry->children.begin(), desc.entry->children.end());
 			}
 		}
+	}
+
+	return txs;
+}
+
+std::unordered_map<std::string, Mempool::AssemblyEntry> Mempool::build_assembly_entries()
+{
+	std::unordered_map<std::string, AssemblyEntry> entries;
+	entries.reserve(map.size());
+
+	for (const auto& [tx_id, entry] : map)
+	{
+		auto& assembly_entry = entries[tx_id];
+		assembly_entry.entry = &entry;
+		assembly_entry.ancestors = find_ancestor_tx_ids(tx_id);
+		assembly_entry.ancestor_fee = entry.ancestor_fee;
+		assembly_entry.ancestor_size = entry.ancestor_size;
+
+		for (const auto& tx_in : entry.tx->tx_ins)
+		{
+			const auto& to_spend = tx_in->to_spend;
+			if (to_spend != nullptr && !entry.parents.contains(to_spend->tx_id) &&
+				UTXO::find_in_map(to_spend) == nullptr)
+				assembly_entry.missing_inputs = true;
+		}
+	}
 
-		if (best_tx_id.empty())
-			break;
+	return entries;
+}
+
+void Mempool::add_tx_to_mempool(const std::shared_ptr<Tx>& tx,
+	const std::shared_ptr<Connection>& from_peer /*= nullptr*/)
+{
+	std::scoped_lock lock(mutex);
 
-		new_block = try_add_to_block(new_block, best_tx_id, added_to_block, current_block_size);
-		if (new_block == nullptr)
+	if (accept_tx(tx, std::chrono::steady_clock::now(), true, from_peer.get()))
+		retry_orphans(tx->id());
+}
+
+uint32_t Mempool::add_txs_to_mempool(const std::vector<std::shared_ptr<Tx>>& txs,
+	const std::shared_ptr<Connection>& from_peer /*= nullptr*/)
+{
+	return admit_batch(txs, std::vector(txs.size(), std::chrono::steady_clock::now()), true, from_peer.get());
+}
+
+uint32_t Mempool::admit_batch(const std::vector<std::shared_ptr<Tx>>& txs,
+	const std::vector<std::chrono::steady_clock::time_point>& insertion_times, bool relay, const Connection* from_peer)
+{
+	std::unordered_map<std::string, size_t> batch_idxs;
+	for (size_t i = 0; i < txs.size(); i++)
+		batch_idxs.emplace(txs[i]->id(), i);
+
+	// Spent outputs looked up ahead of the parallel checks, those of txs earlier in the batch included
+	std::vector<std::vector<std::shared_ptr<UTXO>>> utxos(txs.size());
+	for (size_t i = 0; i < txs.size(); i++)
+	{
+		for (const auto& tx_in : txs[i]->tx_ins)
 		{
-			LOG_ERROR("Block assembly failed, returning partial block");
+			std::shared_ptr<UTXO> utxo;
+			if (tx_in->to_spend != nullptr)
+			{
+				utxo = UTXO::find_in_map(tx_in->to_spend);
+
+				const auto batch_it = batch_idxs.find(tx_in->to_spend->tx_id);
+				if (utxo == nullptr && batch_it != batch_idxs.end() && tx_in->to_spend->tx_out_idx >= 0 &&
+					static_cast<size_t>(tx_in->to_spend->tx_out_idx) < txs[batch_it->second]->tx_outs.size())
+				{
+					utxo = std::make_shared<UTXO>(txs[batch_it->second]->tx_outs[tx_in->to_spend->tx_out_idx],
+						tx_in->to_spend, false, -1);
+				}
 
-			return std::make_shared<Block>(*block);
+				if (utxo == nullptr)
+					utxo = find_utxo_in_mempool(tx_in->to_spend);
+			}
+			utxos[i].push_back(utxo);
 		}
 	}
 
-	return new_block;
+	// Stateless checks and signatures, the latter landing in the signature cache for accept_tx
+	std::vector<uint8_t> prevalidated(txs.size(), 0);
+	const size_t task_count = std::min<size_t>(std::max(1u, boost::thread::hardware_concurrency()), txs.size());
+	std::latch checked(static_cast<std::ptrdiff_t>(task_count));
+	for (size_t t = 0; t < task_count; t++)
+	{
+		boost::asio::post(get_check_pool(), [&txs, &utxos, &prevalidated, &checked, t, task_count]
+		{
+			for (size_t i = t; i < txs.size(); i += task_count)
+			{
+				try
+				{
+					txs[i]->validate_basics();
+				}
+				catch (const TxValidationException&)
+				{
+					continue;
+				}
+				prevalidated[i] = txs[i]->check_signatures(utxos[i]) ? 1 : 0;
+			}
+			checked.count_down();
+		});
+	}
+	checked.wait();
+
+	// Parents in the batch ahead of their children, otherwise in the order given
+	std::vector<uint32_t> missing_parent_counts(txs.size(), 0);
+	std::vector<std::vector<size_t>> batch_children(txs.size());
+	for (size_t i = 0; i < txs.size(); i++)
+	{
+		std::unordered_set<size_t> parent_idxs;
+		for (const auto& tx_in : txs[i]->tx_ins)
+		{
+			if (tx_in->to_spend == nullptr)
+				continue;
+
+			const auto batch_it = batch_idxs.find(tx_in->to_spend->tx_id);
+			if (batch_it != batch_idxs.end() && batch_it->second != i && parent_idxs.insert(batch_it->second).second)
+				batch_children[batch_it->second].push_back(i);
+		}
+		missing_parent_counts[i] = static_cast<uint32_t>(parent_idxs.size());
+	}
+
+	std::set<size_t> ready;
+	for (size_t i = 0; i < txs.size(); i++)
+	{
+		if (missing_parent_counts[i] == 0)
+			ready.insert(i);
+	}
+
+	std::scoped_lock lock(mutex);
+
+	uint32_t admitted = 0;
+	std::vector<uint8_t> handled(txs.size(), 0);
+	while (!ready.empty())
+	{
+		const size_t i = *ready.begin();
+		ready.erase(ready.begin());
+		handled[i] = 1;
+
+		for (const auto child_idx : batch_children[i])
+		{
+			if (--missing_parent_counts[child_idx] == 0)
+				ready.insert(child_idx);
+		}
+
+		if (!prevalidated[i])
+		{
+			LOG_ERROR("Transaction {} rejected: failed basic or signature checks", txs[i]->id());
+
+			continue;
+		}
+
+		if (accept_tx(txs[i], insertion_times[i], relay, from_peer))
+		{
+			admitted++;
+			retry_orphans(txs[i]->id());
+		}
+	}
+
+	// Only txs in a dependency cycle are left, which can never be valid
+	for (size_t i = 0; i < txs.size(); i++)
+	{
+		if (!handled[i])
+			LOG_ERROR("Transaction {} rejected: spends its own descendant", txs[i]->id());
+	}
+
+	return admitted;
 }
 
-void Mempool::add_tx_to_mempool(const std::shared_ptr<Tx>& tx)
+boost::asio::thread_pool& Mempool::get_check_pool()
+{
+	static boost::asio::thread_pool pool(std::max(1u, boost::thread::hardware_concurrency()));
+
+	return pool;
+}
+
+void Mempool::retry_orphans(const std::string& tx_id)
+{
+	std::scoped_lock lock(mutex);
+
+	std::vector<std::string> admitted{ tx_id };
+	while (!admitted.empty())
+	{
+		const auto parent_id = std::move(admitted.back());
+		admitted.pop_back();
+
+		const auto parent_it = map.find(parent_id);
+		if (parent_it == map.end())
+			continue;
+
+		std::unordered_set<std::string> dependent_ids;
+		for (uint32_t i = 0; i < parent_it->second.tx->tx_outs.size(); i++)
+		{
+			const auto it = orphans_by_outpoint.find(std::make_shared<TxOutPoint>(parent_id, i));
+			if (it != orphans_by_outpoint.end())
+				dependent_ids.insert(it->second.begin(), it->second.end());
+		}
+
+		for (const auto& orphan_id : dependent_ids)
+		{
+			const auto orphan_it = orphan_txs.find(orphan_id);
+			if (orphan_it == orphan_txs.end())
+				continue;
+
+			const auto orphan = orphan_it->second;
+			remove_orphan(orphan_id);
+
+			LOG_INFO("Retrying orphan transaction {} after parent {}", orphan_id, parent_id);
+
+			if (accept_tx(orphan.tx, std::chrono::steady_clock::now(), true, orphan.from_peer))
+				admitted.push_back(orphan_id);
+		}
+	}
+}
+
+bool Mempool::accept_tx(const std::shared_ptr<Tx>& tx, std::chrono::steady_clock::time_point insertion_time,
+	bool relay, const Connection* from_peer /*= nullptr*/)
 {
 	std::scoped_lock lock(mutex);
 
@@ -94,7 +416,7 @@ void Mempool::add_tx_to_mempool(const std::shared_ptr<Tx>& tx)
 	{
 		LOG_INFO("Transaction {} already seen", tx_id);
 
-		return;
+		return false;
 	}
 
 	if (has_dust_outputs(tx))
@@ -102,7 +424,24 @@ void Mempool::add_tx_to_mempool(const std::shared_ptr<Tx>& tx)
 		LOG_ERROR("Transaction {} rejected: contains dust output(s) below threshold {}",
 			tx_id, NetParams::DUST_THRESHOLD);
 
-		return;
+		return false;
+	}
+
+	// Checked before signatures, when the fee is already known because every input can be found
+	const uint64_t min_fee_per_kb = get_min_fee_per_kb();
+	if (min_fee_per_kb != 0 && std::ranges::all_of(tx->tx_ins, [](const auto& tx_in)
+		{
+			return tx_in->to_spend == nullptr || UTXO::find_in_map(tx_in->to_spend) != nullptr ||
+				map.contains(tx_in->to_spend->tx_id);
+		}))
+	{
+		const uint64_t tx_size = tx->serialize().get_size();
+		if (PoW::calculate_fees(tx) * 1000 < min_fee_per_kb * tx_size)
+		{
+			LOG_ERROR("Transaction {} rejected: fee below mempool minimum of {} per kB", tx_id, min_fee_per_kb);
+
+			return false;
+		}
 	}
 
 	try
@@ -117,31 +456,32 @@ void Mempool::add_tx_to_mempool(const std::shared_ptr<Tx>& tx)
 		{
 			LOG_INFO("Transaction {} submitted as orphan", ex.to_orphan->id());
 
-			orphaned_txs.push_back(ex.to_orphan);
+			add_orphan(ex.to_orphan, from_peer);
 
-			return;
+			return false;
 		}
 		LOG_ERROR("Transaction {} rejected", tx_id);
 
-		return;
+		return false;
 	}
 
 	if (violates_chain_limits(tx))
 	{
 		LOG_ERROR("Transaction {} rejected: exceeds ancestor/descendant chain limit", tx_id);
 
-		return;
+		return false;
 	}
 
 	const auto conflicting = find_conflicting_txs(tx);
 	if (!conflicting.empty())
 	{
 		if (!try_replace_by_fee(tx))
-			return;
+			return false;
 
-		NetClient::send_msg_random(TxInfoMsg(tx));
+		if (relay)
+			NetClient::send_msg_random(TxInfoMsg(tx));
 
-		return;
+		return true;
 	}
 
 	MempoolEntry entry;
@@ -149,16 +489,20 @@ void Mempool::add_tx_to_mempool(const std::shared_ptr<Tx>& tx)
 	entry.serialized_size = tx->serialize().get_size();
 	entry.fee = PoW::calculate_fees(tx);
 	entry.fee_rate = entry.serialized_size > 0 ? entry.fee / entry.serialized_size : 0;
-	entry.insertion_time = std::chrono::steady_clock::now();
+	entry.insertion_time = insertion_time;
 
-	total_size_bytes += entry.serialized_size;
-	map[tx_id] = std::move(entry);
+	FeeEstimator::track_tx(tx_id, entry.fee_rate);
+	insert_entry(tx_id, std::move(entry));
 
-	LOG_TRACE("Transaction {} added to mempool (size now {} bytes)", tx_id, total_size_bytes);
+	LOG_TRACE("Transaction {} added to mempool (size now {} bytes, {} bytes in memory)", tx_id, total_size_bytes,
+		get_memory_usage());
 
 	enforce_size_cap();
 
-	NetClient::send_msg_random(TxInfoMsg(tx));
+	if (relay)
+		NetClient::send_msg_random(TxInfoMsg(tx));
+
+	return map.contains(tx_id);
 }
 
 bool Mempool::try_replace_by_fee(const std::shared_ptr<Tx>& tx)
@@ -217,10 +561,8 @@ bool Mempool::try_replace_by_fee(const std::shared_ptr<Tx>& tx)
 	}
 
 	for (const auto& id : to_remove)
-	{
 		LOG_TRACE("RBF: removing conflicting transaction {}", id);
-		remove_entry(id);
-	}
+	drop_entries({ to_remove.begin(), to_remove.end() });
 
 	MempoolEntry entry;
 	entry.tx = tx;
@@ -229,8 +571,8 @@ bool Mempool::try_replace_by_fee(const std::shared_ptr<Tx>& tx)
 	entry.fee_rate = tx_size > 0 ? new_fee / tx_size : 0;
 	entry.insertion_time = std::chrono::steady_clock::now();
 
-	total_size_bytes += entry.serialized_size;
-	map[tx_id] = std::move(entry);
+	FeeEstimator::track_tx(tx_id, entry.fee_rate);
+	insert_entry(tx_id, std::move(entry));
 
 	LOG_INFO("RBF: transaction {} replaced {} conflicting transaction(s) (fee {} > {})",
 		tx_id, to_remove.size(), new_fee, conflicting_fees);
@@ -240,6 +582,95 @@ bool Mempool::try_replace_by_fee(const std::shared_ptr<Tx>& tx)
 	return true;
 }
 
+void Mempool::add_orphan(const std::shared_ptr<Tx>& tx, const Connection* from_peer)
+{
+	std::scoped_lock lock(mutex);
+
+	const auto tx_id = tx->id();
+	if (orphan_txs.contains(tx_id))
+		return;
+
+	const auto now = Utils::get_unix_timestamp();
+	std::vector<std::string> expired_ids;
+	for (const auto& [orphan_id, orphan] : orphan_txs)
+	{
+		if (now - orphan.added_time > NetParams::ORPHAN_TX_EXPIRE_SECS)
+			expired_ids.push_back(orphan_id);
+	}
+	for (const auto& orphan_id : expired_ids)
+	{
+		LOG_INFO("Evicting expired orphan transaction {}", orphan_id);
+
+		remove_orphan(orphan_id);
+	}
+
+	const auto size = tx->serialize().get_size();
+	if (size > NetParams::MAX_ORPHAN_TXS_SIZE_BYTES)
+		return;
+
+	orphan_txs[tx_id] = OrphanTx{ tx, size, now, from_peer };
+	orphan_txs_size_bytes += size;
+	for (const auto& tx_in : tx->tx_ins)
+	{
+		if (tx_in->to_spend != nullptr)
+			orphans_by_outpoint[tx_in->to_spend].insert(tx_id);
+	}
+
+	while (orphan_txs.size() > NetParams::MAX_ORPHAN_TXS ||
+		orphan_txs_size_bytes > NetParams::MAX_ORPHAN_TXS_SIZE_BYTES)
+	{
+		const auto victim = std::next(orphan_txs.begin(),
+			Random::get_int(0, static_cast<int64_t>(orphan_txs.size()) - 1));
+
+		LOG_INFO("Orphan pool full, evicting orphan transaction {}", victim->first);
+
+		remove_orphan(victim->first);
+	}
+}
+
+void Mempool::remove_orphan(const std::string& tx_id)
+{
+	std::scoped_lock lock(mutex);
+
+	const auto it = orphan_txs.find(tx_id);
+	if (it == orphan_txs.end())
+		return;
+
+	for (const auto& tx_in : it->second.tx->tx_ins)
+	{
+		if (tx_in->to_spend == nullptr)
+			continue;
+
+		const auto outpoint_it = orphans_by_outpoint.find(tx_in->to_spend);
+		if (outpoint_it == orphans_by_outpoint.end())
+			continue;
+
+		outpoint_it->second.erase(tx_id);
+		if (outpoint_it->second.empty())
+			orphans_by_outpoint.erase(outpoint_it);
+	}
+
+	orphan_txs_size_bytes -= it->second.size;
+	orphan_txs.erase(it);
+}
+
+void Mempool::erase_orphans_from_peer(const std::shared_ptr<Connection>& peer)
+{
+	std::scoped_lock lock(mutex);
+
+	std::vector<std::string> peer_orphan_ids;
+	for (const auto& [orphan_id, orphan] : orphan_txs)
+	{
+		if (orphan.from_peer == peer.get())
+			peer_orphan_ids.push_back(orphan_id);
+	}
+	for (const auto& orphan_id : peer_orphan_ids)
+		remove_orphan(orphan_id);
+
+	if (!peer_orphan_ids.empty())
+		LOG_INFO("Erased {} orphan transactions from disconnected peer", peer_orphan_ids.size());
+}
+
 std::vector<std::shared_ptr<Tx>> Mempool::find_conflicting_txs(const std::shared_ptr<Tx>& tx)
 {
 	std::vector<std::shared_ptr<Tx>> conflicts;
@@ -249,29 +680,13 @@ std::vector<std::shared_ptr<Tx>> Mempool::find_conflicting_txs(const std::shared
 		if (tx_in->to_spend == nullptr)
 			continue;
 
-		for (const auto& [existing_id, existing_entry] : map)
-		{
-			for (const auto& existing_in : existing_entry.tx->tx_ins)
-			{
-				if (existing_in->to_spend == nullptr)
-					continue;
+		const auto spender_it = spenders.find(tx_in->to_spend);
+		if (spender_it == spenders.end())
+			continue;
 
-				if (*existing_in->to_spend == *tx_in->to_spend)
-				{
-					bool already_found = false;
-					for (const auto& c : conflicts)
-					{
-						if (c->id() == existing_id)
-						{
-							already_found = true;
-							break;
-						}
-					}
-					if (!already_found)
-						conflicts.push_back(existing_entry.tx);
-				}
-			}
-		}
+		const auto& existing_tx = map.at(spender_it->second).tx;
+		if (std::ranges::find(conflicts, existing_tx) == conflicts.end())
+			conflicts.push_back(existing_tx);
 	}
 
 	return conflicts;
@@ -279,44 +694,36 @@ std::vector<std::shared_ptr<Tx>> Mempool::find_conflicting_txs(const std::shared
 
 std::vector<std::string> Mempool::find_descendant_tx_ids(const std::string& tx_id)
 {
-	std::vector<std::string> descendants;
+	return walk_graph(tx_id, &MempoolEntry::children);
+}
+
+std::vector<std::string> Mempool::walk_graph(const std::string& tx_id,
+	std::unordered_set<std::string> MempoolEntry::* links)
+{
+	std::vector<std::string> found;
+	std::unordered_set<std::string> seen{ tx_id };
 	std::vector<std::string> queue{ tx_id };
 
 	while (!queue.empty())
 	{
-		const auto current = queue.back();
+		const auto current = std::move(queue.back());
 		queue.pop_back();
 
-		for (const auto& [id, entry] : map)
-		{
-			if (id == current)
-				continue;
+		const auto it = map.find(current);
+		if (it == map.end())
+			continue;
 
-			for (const auto& tx_in : entry.tx->tx_ins)
+		for (const auto& linked_id : it->second.*links)
+		{
+			if (seen.insert(linked_id).second)
 			{
-				if (tx_in->to_spend != nullptr && tx_in->to_spend->tx_id == current)
-				{
-					bool already_found = false;
-					for (const auto& d : descendants)
-					{
-						if (d == id)
-						{
-							already_found = true;
-							break;
-						}
-					}
-					if (!already_found)
-					{
-						descendants.push_back(id);
-						queue.push_back(id);
-					}
-					break;
-				}
+				found.push_back(linked_id);
+				queue.push_back(linked_id);
 			}
 		}
 	}
 
-	return descendants;
+	return found;
 }
 
 bool Mempool::check_block_size(uint32_t current_size)
@@ -324,220 +731,335 @@ bool Mempool::check_block_size(uint32_t current_size)
 	return current_size < NetParams::MAX_BLOCK_SERIALIZED_SIZE_IN_BYTES;
 }
 
-std::shared_ptr<Block> Mempool::try_add_to_block(std::shared_ptr<Block> block, const std::string& tx_id,
-	std::set<std::string>& added_to_block, uint32_t& current_block_size)
-
+std::vector<std::string> Mempool::find_ancestor_tx_ids(const std::string& tx_id)
 {
-	std::scoped_lock lock(mutex);
+	return walk_graph(tx_id, &MempoolEntry::parents);
+}
 
-	if (added_to_block.contains(tx_id))
-		return block;
+bool Mempool::violates_chain_limits(const std::shared_ptr<Tx>& tx)
+{
+	std::unordered_set<std::string> parent_ids;
+	for (const auto& tx_in : tx->tx_ins)
+	{
+		if (tx_in->to_spend != nullptr && map.contains(tx_in->to_spend->tx_id))
+			parent_ids.insert(tx_in->to_spend->tx_id);
+	}
 
-	const auto tx_it = map.find(tx_id);
-	if (tx_it == map.end())
-		return block;
+	// Checking each parent's count first bounds every walk by the limit
+	std::unordered_set<std::string> ancestor_ids = parent_ids;
+	for (const auto& parent_id : parent_ids)
+	{
+		if (map.at(parent_id).ancestor_count >= NetParams::MAX_ANCESTOR_COUNT)
+			return true;
 
-	const auto& tx = tx_it->second.tx;
+		for (auto& anc_id : find_ancestor_tx_ids(parent_id))
+			ancestor_ids.insert(std::move(anc_id));
+		if (ancestor_ids.size() >= NetParams::MAX_ANCESTOR_COUNT)
+			return true;
+	}
 
-	for (const auto& tx_in : tx->tx_ins)
+	for (const auto& anc_id : ancestor_ids)
 	{
-		const auto& to_spend = tx_in->to_spend;
+		if (map.at(anc_id).descendant_count >= NetParams::MAX_DESCENDANT_COUNT)
+			return true;
+	}
 
-		if (UTXO::find_in_map(to_spend) != nullptr)
-			continue;
+	return false;
+}
 
-		const auto& in_mempool = find_utxo_in_mempool(to_spend);
-		if (in_mempool == nullptr)
-		{
-			LOG_ERROR("Unable to find UTXO for {}", tx_in->to_spend->tx_id);
+bool Mempool::has_dust_outputs(const std::shared_ptr<Tx>& tx)
+{
+	if (tx->is_coinbase())
+		return false;
 
-			return nullptr;
-		}
+	for (const auto& tx_out : tx->tx_outs)
+	{
+		if (tx_out->value < NetParams::DUST_THRESHOLD)
+			return true;
+	}
 
-		block = try_add_to_block(block, in_mempool->tx_out_point->tx_id, added_to_block, current_block_size);
-		if (block == nullptr)
-		{
-			LOG_ERROR("Unable to add parent");
+	return false;
+}
 
-			return nullptr;
-		}
-	}
+void Mempool::enforce_size_cap()
+{
+	trim_to_size(NetParams::MAX_MEMPOOL_SIZE_BYTES);
+}
 
-	const uint32_t tx_serialized_size = tx->serialize().get_size();
-	if (!check_block_size(current_block_size + tx_serialized_size))
-		return block;
+void Mempool::trim_to_size(uint64_t max_memory_bytes)
+{
+	std::scoped_lock lock(mutex);
 
-	block->txs.push_back(tx);
-	current_block_size += tx_serialized_size;
+	while (get_memory_usage() > max_memory_bytes && !eviction_index.empty())
+	{
+		const auto worst_id = eviction_index.begin()->second;
+		const auto& worst = map.at(worst_id);
 
-	LOG_TRACE("Added transaction {} to block {}", tx_id, block->id());
+		// Anything paying no more than what was just evicted would only be evicted again
+		const uint64_t evicted_fee_per_kb = worst.descendant_size > 0
+			? worst.descendant_fee * 1000 / worst.descendant_size
+			: 0;
+		raise_min_fee(evicted_fee_per_kb + NetParams::INCREMENTAL_RELAY_FEE);
 
-	added_to_block.insert(tx_id);
+		auto desc_ids = find_descendant_tx_ids(worst_id);
+		desc_ids.push_back(worst_id);
 
-	return block;
+		for (const auto& id : desc_ids)
+			LOG_TRACE("Evicting transaction {} (fee rate {}) to enforce mempool size cap", id, map.at(id).fee_rate);
+		drop_entries(std::move(desc_ids));
+	}
 }
 
-std::vector<std::string> Mempool::find_ancestor_tx_ids(const std::string& tx_id)
+uint64_t Mempool::get_min_fee_per_kb()
 {
-	std::vector<std::string> ancestors;
-	std::vector<std::string> queue{ tx_id };
+	std::scoped_lock lock(mutex);
 
-	while (!queue.empty())
+	if (rolling_min_fee_per_kb == 0)
+		return 0;
+
+	const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - rolling_min_fee_updated).count();
+	const auto half_life = std::chrono::duration<double>(ROLLING_MIN_FEE_HALF_LIFE).count();
+	const auto min_fee_per_kb = static_cast<double>(rolling_min_fee_per_kb) * std::pow(0.5, elapsed / half_life);
+
+	// Once decayed this far it stays off until the next raise
+	if (min_fee_per_kb < NetParams::INCREMENTAL_RELAY_FEE / 2)
 	{
-		const auto current = queue.back();
-		queue.pop_back();
+		rolling_min_fee_per_kb = 0;
 
-		const auto it = map.find(current);
-		if (it == map.end())
-			continue;
+		return 0;
+	}
 
-		for (const auto& tx_in : it->second.tx->tx_ins)
-		{
-			if (tx_in->to_spend == nullptr)
-				continue;
+	return static_cast<uint64_t>(std::llround(min_fee_per_kb));
+}
 
-			const auto& parent_id = tx_in->to_spend->tx_id;
-			if (!map.contains(parent_id))
-				continue;
+void Mempool::raise_min_fee(uint64_t fee_per_kb)
+{
+	if (fee_per_kb > get_min_fee_per_kb())
+	{
+		rolling_min_fee_per_kb = fee_per_kb;
+		rolling_min_fee_updated = std::chrono::steady_clock::now();
 
-			bool already_found = false;
-			for (const auto& a : ancestors)
-			{
-				if (a == parent_id)
-				{
-					already_found = true;
-					break;
-				}
-			}
-			if (!already_found)
-			{
-				ancestors.push_back(parent_id);
-				queue.push_back(parent_id);
-			}
-		}
+		LOG_INFO("Mempool minimum fee raised to {} per kB", fee_per_kb);
 	}
+}
+
+uint64_t Mempool::get_descendant_score(const MempoolEntry& entry)
+{
+	const uint64_t descendant_fee_rate = entry.descendant_size > 0 ? entry.descendant_fee / entry.descendant_size : 0;
 
-	return ancestors;
+	return std::max(entry.fee_rate, descendant_fee_rate);
 }
 
-uint64_t Mempool::compute_ancestor_package_fee_rate(const std::string& tx_id,
-	const std::set<std::string>& excluded)
+void Mempool::save_to_disk(const std::string& path /*= MEMPOOL_PATH*/)
 {
-	const auto it = map.find(tx_id);
-	if (it == map.end())
-		return 0;
+	BinaryBuffer mempool_data;
+	size_t entry_count;
+	{
+		std::scoped_lock lock(mutex);
 
-	uint64_t total_fee = it->second.fee;
-	uint64_t total_size = it->second.serialized_size;
+		std::vector<const MempoolEntry*> entries;
+		entries.reserve(map.size());
+		for (const auto& entry : map | std::views::values)
+			entries.push_back(&entry);
+		// A tx has more ancestors than any of its parents
+		std::ranges::sort(entries, {}, &MempoolEntry::ancestor_count);
 
-	const auto ancestors = find_ancestor_tx_ids(tx_id);
-	for (const auto& anc_id : ancestors)
+		const auto now = std::chrono::steady_clock::now();
+		const int64_t now_unix = Utils::get_unix_timestamp();
+
+		mempool_data.write_size(static_cast<uint32_t>(entries.size()));
+		for (const auto* entry : entries)
+		{
+			mempool_data.write_raw(entry->tx->serialize().get_buffer());
+			mempool_data.write(entry->fee);
+			mempool_data.write(now_unix -
+				std::chrono::duration_cast<std::chrono::seconds>(now - entry->insertion_time).count());
+		}
+		entry_count = entries.size();
+	}
+
+	// Renamed over the previous save only once complete, so a crash mid-write leaves that one intact
+	const auto new_path = path + ".new";
+	std::ofstream mempool_out(new_path, std::ios::binary | std::ios::trunc);
+	if (!mempool_out)
 	{
-		if (excluded.contains(anc_id))
-			continue;
+		LOG_ERROR("Failed to open {} for writing", new_path);
 
-		const auto anc_it = map.find(anc_id);
-		if (anc_it == map.end())
-			continue;
+		return;
+	}
+	auto& mempool_data_buffer = mempool_data.get_buffer();
+	mempool_out.write(reinterpret_cast<const char*>(mempool_data_buffer.data()), mempool_data_buffer.size());
+	mempool_out.flush();
+	const bool written = mempool_out.good();
+	mempool_out.close();
+
+	std::error_code ec;
+	if (written)
+		std::filesystem::rename(new_path, path, ec);
+	if (!written || ec)
+	{
+		LOG_ERROR("Failed to write {}", path);
+		std::filesystem::remove(new_path, ec);
 
-		total_fee += anc_it->second.fee;
-		total_size += anc_it->second.serialized_size;
+		return;
 	}
 
-	return total_size > 0 ? total_fee / total_size : 0;
+	LOG_INFO("Saved mempool with {} transactions", entry_count);
 }
 
-bool Mempool::violates_chain_limits(const std::shared_ptr<Tx>& tx)
+uint32_t Mempool::load_from_disk(const std::string& path /*= MEMPOOL_PATH*/)
 {
-	uint32_t ancestor_count = 0;
-	for (const auto& tx_in : tx->tx_ins)
+	std::ifstream mempool_in(path, std::ios::binary);
+	if (!mempool_in.good())
+		return 0;
+
+	BinaryBuffer mempool_data(std::vector<uint8_t>(std::istreambuf_iterator<char>(mempool_in), {}));
+	mempool_in.close();
+
+	struct SavedEntry
 	{
-		if (tx_in->to_spend == nullptr)
-			continue;
+		std::shared_ptr<Tx> tx;
+		uint64_t fee = 0;
+		int64_t insertion_time = 0;
+	};
 
-		const auto& parent_id = tx_in->to_spend->tx_id;
-		if (!map.contains(parent_id))
-			continue;
+	uint32_t entry_count = 0;
+	if (!mempool_data.read_size(entry_count))
+	{
+		LOG_ERROR("Load mempool failed, starting empty");
 
-		const auto parent_ancestors = find_ancestor_tx_ids(parent_id);
-		const uint32_t depth = static_cast<uint32_t>(parent_ancestors.size()) + 1;
-		if (depth > ancestor_count)
-			ancestor_count = depth;
+		return 0;
 	}
 
-	if (ancestor_count >= NetParams::MAX_ANCESTOR_COUNT)
-		return true;
+	const int64_t now_unix = Utils::get_unix_timestamp();
+	const uint64_t min_fee_per_kb = get_min_fee_per_kb();
 
-	for (const auto& tx_in : tx->tx_ins)
+	// Expired and no longer paying enough entries are dropped before any signature work
+	std::vector<SavedEntry> saved;
+	// The count comes from the file, so it is only trusted as far as the bytes left could hold a fee and time each
+	saved.reserve(std::min<size_t>(entry_count,
+		(mempool_data.get_size() - mempool_data.get_read_offset()) / (sizeof(uint64_t) + sizeof(int64_t))));
+	for (uint32_t i = 0; i < entry_count; i++)
 	{
-		if (tx_in->to_spend == nullptr)
-			continue;
+		SavedEntry entry;
+		entry.tx = std::make_shared<Tx>();
+		if (!entry.tx->deserialize(mempool_data) || !mempool_data.read(entry.fee) ||
+			!mempool_data.read(entry.insertion_time))
+		{
+			LOG_ERROR("Load mempool failed after {} of {} transactions", i, entry_count);
 
-		const auto& parent_id = tx_in->to_spend->tx_id;
-		if (!map.contains(parent_id))
+			break;
+		}
+		if (now_unix - entry.insertion_time >= NetParams::MEMPOOL_TX_EXPIRE_SECS)
+			continue;
+		if (entry.fee * 1000 < min_fee_per_kb * entry.tx->serialize().get_size())
 			continue;
+		saved.push_back(std::move(entry));
+	}
 
-		auto ancestors = find_ancestor_tx_ids(parent_id);
-		ancestors.push_back(parent_id);
+	const auto now = std::chrono::steady_clock::now();
 
-		for (const auto& anc_id : ancestors)
+	uint32_t admitted = 0;
+	for (size_t batch_start = 0; batch_start < saved.size(); batch_start += LOAD_BATCH_SIZE)
+	{
+		const auto batch = std::span(saved).subspan(batch_start,
+			std::min<size_t>(LOAD_BATCH_SIZE, saved.size() - batch_start));
+
+		std::vector<std::shared_ptr<Tx>> txs;
+		std::vector<std::chrono::steady_clock::time_point> insertion_times;
+		for (const auto& entry : batch)
 		{
-			const auto descendants = find_descendant_tx_ids(anc_id);
-			if (static_cast<uint32_t>(descendants.size()) + 1 >= NetParams::MAX_DESCENDANT_COUNT)
-				return true;
+			txs.push_back(entry.tx);
+			insertion_times.push_back(now - std::chrono::seconds(std::max<int64_t>(now_unix - entry.insertion_time, 0)));
 		}
+
+		admitted += admit_batch(txs, insertion_times, false, nullptr);
 	}
 
-	return false;
+	LOG_INFO("Loaded {} of {} saved mempool transactions", admitted, saved.size());
+
+	return admitted;
 }
 
-bool Mempool::has_dust_outputs(const std::shared_ptr<Tx>& tx)
+void Mempool::insert_entry(const std::string& tx_id, MempoolEntry entry)
 {
-	if (tx->is_coinbase())
-		return false;
+	std::scoped_lock lock(mutex);
 
-	for (const auto& tx_out : tx->tx_outs)
+	remove_entry(tx_id);
+
+	entry.parents.clear();
+	entry.children.clear();
+	for (const auto& tx_in : entry.tx->tx_ins)
 	{
-		if (tx_out->value < NetParams::DUST_THRESHOLD)
-			return true;
+		if (tx_in->to_spend != nullptr && map.contains(tx_in->to_spend->tx_id))
+			entry.parents.insert(tx_in->to_spend->tx_id);
+	}
+	// Pool txs can already spend this one when it comes back from a disconnected block
+	auto out_point = std::make_shared<TxOutPoint>(tx_id, 0);
+	for (size_t i = 0; i < entry.tx->tx_outs.size(); i++)
+	{
+		out_point->tx_out_idx = static_cast<int64_t>(i);
+		if (const auto spender_it = spenders.find(out_point); spender_it != spenders.end())
+			entry.children.insert(spender_it->second);
 	}
 
-	return false;
-}
+	entry.memory_usage = estimate_entry_memory_usage(tx_id, entry);
+	total_size_bytes += entry.serialized_size;
+	total_memory_usage += entry.memory_usage +
+		(entry.parents.size() + entry.children.size()) * get_link_memory_usage(tx_id);
+	fee_histogram.add(entry.fee_rate);
+	auto& inserted = map[tx_id] = std::move(entry);
+	expiry_index.emplace(inserted.insertion_time, tx_id);
 
-void Mempool::enforce_size_cap()
-{
-	while (total_size_bytes > NetParams::MAX_MEMPOOL_SIZE_BYTES && !map.empty())
+	for (const auto& tx_in : inserted.tx->tx_ins)
 	{
-		std::string worst_id;
-		uint64_t worst_fee_rate = UINT64_MAX;
+		if (tx_in->to_spend != nullptr)
+			spenders[tx_in->to_spend] = tx_id;
+	}
+	for (const auto& parent_id : inserted.parents)
+		map.at(parent_id).children.insert(tx_id);
+	for (const auto& child_id : inserted.children)
+		map.at(child_id).parents.insert(tx_id);
 
-		for (const auto& [id, entry] : map)
+	if (inserted.children.empty())
+	{
+		// Nothing in the pool descends from a new tx, so it only joins its ancestors' packages
+		inserted.ancestor_count = 1;
+		inserted.ancestor_size = inserted.serialized_size;
+		inserted.ancestor_fee = inserted.fee;
+		inserted.descendant_count = 1;
+		inserted.descendant_size = inserted.serialized_size;
+		inserted.descendant_fee = inserted.fee;
+		for (const auto& anc_id : find_ancestor_tx_ids(tx_id))
 		{
-			if (entry.fee_rate < worst_fee_rate)
-			{
-				worst_fee_rate = entry.fee_rate;
-				worst_id = id;
-			}
-		}
+			const auto& ancestor = map.at(anc_id);
+			inserted.ancestor_count++;
+			inserted.ancestor_size += ancestor.serialized_size;
+			inserted.ancestor_fee += ancestor.fee;
 
-		if (worst_id.empty())
-			break;
-
-		auto desc_ids = find_descendant_tx_ids(worst_id);
-		desc_ids.push_back(worst_id);
-
-		for (const auto& id : desc_ids)
-		{
-			LOG_TRACE("Evicting transaction {} (fee rate {}) to enforce mempool size cap", id,
-				map.contains(id) ? map[id].fee_rate : 0);
-			remove_entry(id);
+			add_descendant(anc_id, inserted);
 		}
+		eviction_index.emplace(get_descendant_score(inserted), tx_id);
 	}
+	else
+	{
+		// Back from a disconnected block, joining packages that may already overlap
+		const auto ancestors = find_ancestor_tx_ids(tx_id);
+		const auto descendants = find_descendant_tx_ids(tx_id);
+		update_package_state(tx_id);
+		for (const auto& anc_id : ancestors)
+			update_package_state(anc_id);
+		for (const auto& desc_id : descendants)
+			update_package_state(desc_id);
+	}
+
+	add_to_block_template(tx_id, inserted);
 }
 
 void Mempool::remove_entry(const std::string& tx_id)
 {
+	std::scoped_lock lock(mutex);
+
 	const auto it = map.find(tx_id);
 	if (it == map.end())
 		return;
@@ -547,31 +1069,262 @@ void Mempool::remove_entry(const std::string& tx_id)
 	else
 		total_size_bytes = 0;
 
+	fee_histogram.remove(it->second.fee_rate);
+
+	const uint64_t memory_usage = it->second.memory_usage +
+		(it->second.parents.size() + it->second.children.size()) * get_link_memory_usage(tx_id);
+	total_memory_usage -= std::min(memory_usage, total_memory_usage);
+
+	for (const auto& tx_in : it->second.tx->tx_ins)
+	{
+		if (tx_in->to_spend == nullptr)
+			continue;
+
+		const auto spender_it = spenders.find(tx_in->to_spend);
+		if (spender_it != spenders.end() && spender_it->second == tx_id)
+			spenders.erase(spender_it);
+	}
+
+	if (block_template_tx_ids.erase(tx_id) != 0)
+	{
+		block_template.fees -= it->second.fee;
+		block_template.size -= it->second.serialized_size;
+
+		if (!block_template_complete)
+			block_template_dirty = true;
+	}
+
+	eviction_index.erase({ get_descendant_score(it->second), tx_id });
+	expiry_index.erase({ it->second.insertion_time, tx_id });
+
+	const auto ancestors = find_ancestor_tx_ids(tx_id);
+	const auto descendants = find_descendant_tx_ids(tx_id);
+	// Without children the tx only leaves its ancestors' packages, and without parents, as when it
+	// confirms, only its descendants'. Anything else can split packages and is recomputed below.
+	const bool deltas_suffice = it->second.children.empty() || it->second.parents.empty();
+	if (deltas_suffice)
+	{
+		for (const auto& anc_id : ancestors)
+			remove_descendant(anc_id, it->second);
+		for (const auto& desc_id : descendants)
+			remove_ancestor(map.at(desc_id), it->second);
+	}
+
+	for (const auto& parent_id : it->second.parents)
+		map.at(parent_id).children.erase(tx_id);
+	for (const auto& child_id : it->second.children)
+		map.at(child_id).parents.erase(tx_id);
+
 	map.erase(it);
+
+	if (deltas_suffice)
+		return;
+
+	for (const auto& anc_id : ancestors)
+		update_package_state(anc_id);
+	for (const auto& desc_id : descendants)
+		update_package_state(desc_id);
 }
 
-void Mempool::expire_old_transactions()
+void Mempool::remove_conflicts(const std::shared_ptr<Tx>& tx)
 {
 	std::scoped_lock lock(mutex);
 
-	const auto now = std::chrono::steady_clock::now();
-	std::vector<std::string> to_remove;
+	std::unordered_set<std::string> to_remove;
+	for (const auto& conflict : find_conflicting_txs(tx))
+	{
+		const auto conflict_id = conflict->id();
+		LOG_INFO("Removing transaction {} that conflicts with confirmed transaction {}", conflict_id, tx->id());
+
+		to_remove.insert(conflict_id);
+		for (const auto& desc_id : find_descendant_tx_ids(conflict_id))
+			to_remove.insert(desc_id);
+	}
+	if (!to_remove.empty())
+		drop_entries({ to_remove.begin(), to_remove.end() });
+}
+
+void Mempool::drop_entry(const std::string& tx_id)
+{
+	remove_entry(tx_id);
+	FeeEstimator::untrack_tx(tx_id);
+}
 
-	for (const auto& [id, entry] : map)
+void Mempool::drop_entries(std::vector<std::string> tx_ids)
+{
+	// A descendant has strictly more ancestors than each of its ancestors
+	std::ranges::sort(tx_ids, std::ranges::greater(), [](const std::string& id) { return map.at(id).ancestor_count; });
+
+	for (const auto& id : tx_ids)
+		drop_entry(id);
+}
+
+void Mempool::add_descendant(const std::string& tx_id, const MempoolEntry& descendant)
+{
+	auto& entry = map.at(tx_id);
+
+	eviction_index.erase({ get_descendant_score(entry), tx_id });
+	entry.descendant_count++;
+	entry.descendant_size += descendant.serialized_size;
+	entry.descendant_fee += descendant.fee;
+	eviction_index.emplace(get_descendant_score(entry), tx_id);
+}
+
+void Mempool::remove_descendant(const std::string& tx_id, const MempoolEntry& descendant)
+{
+	auto& entry = map.at(tx_id);
+
+	eviction_index.erase({ get_descendant_score(entry), tx_id });
+	entry.descendant_count--;
+	entry.descendant_size -= descendant.serialized_size;
+	entry.descendant_fee -= descendant.fee;
+	eviction_index.emplace(get_descendant_score(entry), tx_id);
+}
+
+void Mempool::remove_ancestor(MempoolEntry& entry, const MempoolEntry& ancestor)
+{
+	entry.ancestor_count--;
+	entry.ancestor_size -= ancestor.serialized_size;
+	entry.ancestor_fee -= ancestor.fee;
+}
+
+void Mempool::update_package_state(const std::string& tx_id)
+{
+	auto& entry = map.at(tx_id);
+
+	eviction_index.erase({ get_descendant_score(entry), tx_id });
+
+	entry.ancestor_count = 1;
+	entry.ancestor_size = entry.serialized_size;
+	entry.ancestor_fee = entry.fee;
+	for (const auto& anc_id : find_ancestor_tx_ids(tx_id))
 	{
-		const auto age = std::chrono::duration_cast<std::chrono::seconds>(now - entry.insertion_time).count();
-		if (age >= NetParams::MEMPOOL_TX_EXPIRE_SECS)
-			to_remove.push_back(id);
+		const auto& ancestor = map.at(anc_id);
+		entry.ancestor_count++;
+		entry.ancestor_size += ancestor.serialized_size;
+		entry.ancestor_fee += ancestor.fee;
 	}
 
-	for (const auto& id : to_remove)
+	entry.descendant_count = 1;
+	entry.descendant_size = entry.serialized_size;
+	entry.descendant_fee = entry.fee;
+	for (const auto& desc_id : find_descendant_tx_ids(tx_id))
+	{
+		const auto& descendant = map.at(desc_id);
+		entry.descendant_count++;
+		entry.descendant_size += descendant.serialized_size;
+		entry.descendant_fee += descendant.fee;
+	}
+
+	eviction_index.emplace(get_descendant_score(entry), tx_id);
+}
+
+uint64_t Mempool::get_memory_usage()
+{
+	std::scoped_lock lock(mutex);
+
+	return total_memory_usage + MemoryUsage::bucket_usage(map.bucket_count()) +
+		MemoryUsage::bucket_usage(spenders.bucket_count()) + MemoryUsage::bucket_usage(block_template_tx_ids.bucket_count()) +
+		MemoryUsage::dynamic_usage(block_template.txs);
+}
+
+uint64_t Mempool::estimate_entry_memory_usage(const std::string& tx_id, const MempoolEntry& entry)
+{
+	// The id is copied into the map key, the eviction, expiry and block template indexes, and the
+	// spenders node of every input
+	uint64_t usage = entry.tx->get_memory_usage() +
+		MemoryUsage::hash_node_usage<std::pair<const std::string, MempoolEntry>>() +
+		MemoryUsage::tree_node_usage<std::pair<uint64_t, std::string>>() +
+		MemoryUsage::tree_node_usage<std::pair<std::chrono::steady_clock::time_point, std::string>>() +
+		MemoryUsage::hash_node_usage<std::string>() +
+		4 * MemoryUsage::dynamic_usage(tx_id);
+	usage += entry.tx->tx_ins.size() *
+		(MemoryUsage::hash_node_usage<std::pair<const std::shared_ptr<TxOutPoint>, std::string>>() +
+			MemoryUsage::dynamic_usage(tx_id));
+
+	return usage;
+}
+
+uint64_t Mempool::get_link_memory_usage(const std::string& tx_id)
+{
+	return 2 * (MemoryUsage::hash_node_usage<std::string>() + MemoryUsage::dynamic_usage(tx_id));
+}
+
+void Mempool::clear()
+{
+	std::scoped_lock lock(mutex);
+
+	map.clear();
+	spenders.clear();
+	eviction_index.clear();
+	expiry_index.clear();
+	total_size_bytes = 0;
+	total_memory_usage = 0;
+	fee_histogram.clear();
+
+	orphan_txs.clear();
+	orphans_by_outpoint.clear();
+	orphan_txs_size_bytes = 0;
+
+	rolling_min_fee_per_kb = 0;
+
+	block_template = BlockTemplate();
+	block_template_tx_ids.clear();
+	block_template_dirty = false;
+	block_template_complete = true;
+}
+
+void Mempool::add_to_block_template(const std::string& tx_id, const MempoolEntry& entry)
+{
+	if (block_template_dirty)
+		return;
+
+	// Appending keeps the template valid only if the tx fits, its mempool parents are already in it
+	// and no pool tx spends it yet, as one coming back from a disconnected block may already have
+	// children in the template. Otherwise a rebuild may choose better packages, so leave that to the
+	// next request.
+	bool appendable = entry.children.empty() &&
+		check_block_size(BLOCK_TEMPLATE_RESERVED_SIZE + block_template.size + entry.serialized_size);
+	for (const auto& tx_in : entry.tx->tx_ins)
+	{
+		if (!appendable)
+			break;
+		if (tx_in->to_spend == nullptr)
+			continue;
+
+		const auto& parent_id = tx_in->to_spend->tx_id;
+		if (map.contains(parent_id) && !block_template_tx_ids.contains(parent_id))
+			appendable = false;
+	}
+
+	if (!appendable)
 	{
+		block_template_dirty = true;
+
+		return;
+	}
+
+	block_template.txs.push_back(entry.tx);
+	block_template.fees += entry.fee;
+	block_template.size += entry.serialized_size;
+	block_template_tx_ids.insert(tx_id);
+}
+
+void Mempool::expire_old_transactions()
+{
+	std::scoped_lock lock(mutex);
+
+	const auto cutoff = std::chrono::steady_clock::now() - std::chrono::seconds(NetParams::MEMPOOL_TX_EXPIRE_SECS);
+
+	while (!expiry_index.empty() && expiry_index.begin()->first <= cutoff)
+	{
+		const auto id = expiry_index.begin()->second;
+
 		LOG_INFO("Expiring transaction {} from mempool (exceeded TTL of {} seconds)", id,
 			NetParams::MEMPOOL_TX_EXPIRE_SECS);
 
 		auto desc_ids = find_descendant_tx_ids(id);
-		remove_entry(id);
-		for (const auto& desc_id : desc_ids)
-			remove_entry(desc_id);
+		desc_ids.push_back(id);
+		drop_entries(std::move(desc_ids));
 	}
 }
@@ -1,16 +1,22 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <boost/asio/thread_pool.hpp>
 
 #include "core/block.hpp"
 #include "core/tx.hpp"
 #include "core/tx_out_point.hpp"
 #include "core/unspent_tx_out.hpp"
+#include "mining/fee_rate_histogram.hpp"
+
+class Connection;
 
 class Mempool
 {
@@ -22,40 +28,198 @@ public:
 		uint64_t fee = 0;
 		uint64_t fee_rate = 0;
 		std::chrono::steady_clock::time_point insertion_time;
+		// Heap memory of the tx and of its nodes in the pool indexes, set by insert_entry
+		uint64_t memory_usage = 0;
+
+		// Links to other pool txs and package totals including the tx itself. insert_entry and
+		// remove_entry maintain these, whatever the caller sets is overwritten. Admission keeps the
+		// totals within NetParams::MAX_ANCESTOR_COUNT and MAX_DESCENDANT_COUNT, though txs returning
+		// from a disconnected block can exceed them.
+		std::unordered_set<std::string> parents;
+		std::unordered_set<std::string> children;
+		uint32_t ancestor_count = 1;
+		uint64_t ancestor_size = 0;
+		uint64_t ancestor_fee = 0;
+		uint32_t descendant_count = 1;
+		uint64_t descendant_size = 0;
+		uint64_t descendant_fee = 0;
+	};
+
+	// Block contents kept up to date as the pool changes, in an order that is valid to mine
+	struct BlockTemplate
+	{
+		std::vector<std::shared_ptr<Tx>> txs;
+		uint64_t fees = 0;
+		uint32_t size = 0;
 	};
 
 	static std::unordered_map<std::string, MempoolEntry> map;
+	// Outpoint to the id of the pool tx spending it, maintained by insert_entry and remove_entry
+	static std::unordered_map<std::shared_ptr<TxOutPoint>, std::string, TxOutPointHash, TxOutPointEqual> spenders;
+
+	// Tx waiting for a parent, retried when a tx creating one of the outpoints it spends is admitted
+	struct OrphanTx
+	{
+		std::shared_ptr<Tx> tx;
+		uint32_t size = 0;
+		int64_t added_time = 0;
+		// Identifies the connection the tx came from, only compared and never dereferenced
+		const Connection* from_peer = nullptr;
+	};
 
-	static std::vector<std::shared_ptr<Tx>> orphaned_txs;
+	static std::unordered_map<std::string, OrphanTx> orphan_txs;
+	// Outpoint to the ids of the orphans spending it
+	static std::unordered_map<std::shared_ptr<TxOutPoint>, std::unordered_set<std::string>, TxOutPointHash,
+		TxOutPointEqual> orphans_by_outpoint;
+	static uint64_t orphan_txs_size_bytes;
 
 	static std::recursive_mutex mutex;
 
+	// Serialized size of all pool txs
 	static uint64_t total_size_bytes;
+	// Sum of the entries' memory_usage and of their links to each other
+	static uint64_t total_memory_usage;
+
+	// Fee rates of all pool txs, maintained by insert_entry and remove_entry
+	static FeeRateHistogram fee_histogram;
 
 	static std::shared_ptr<UTXO> find_utxo_in_mempool(const std::shared_ptr<TxOutPoint>& tx_out_point);
 
 	static std::shared_ptr<Block> select_from_mempool(const std::shared_ptr<Block>& block);
+	static BlockTemplate get_block_template();
+
+	// Also retries the orphans that the tx, and every orphan admitted after it, provides an input for
+	static void add_tx_to_mempool(const std::shared_ptr<Tx>& tx, const std::shared_ptr<Connection>& from_peer = nullptr);
 
-	static void add_tx_to_mempool(const std::shared_ptr<Tx>& tx);
+	// Runs the stateless and signature checks of all txs in parallel outside the lock, then admits
+	// them parents first. Used for txs received in a row from a peer and for loading. Returns the
+	// number of txs admitted.
+	static uint32_t add_txs_to_mempool(const std::vector<std::shared_ptr<Tx>>& txs,
+		const std::shared_ptr<Connection>& from_peer = nullptr);
+
+	static void erase_orphans_from_peer(const std::shared_ptr<Connection>& peer);
 
 	static bool try_replace_by_fee(const std::shared_ptr<Tx>& tx);
 
 	static void expire_old_transactions();
 
+	// Estimated heap memory of the pool: entries, links and the indexes' bucket arrays
+	static uint64_t get_memory_usage();
+
+	// Evicts the lowest descendant score packages until get_memory_usage() is no more than max_memory_bytes
+	static void trim_to_size(uint64_t max_memory_bytes);
+	// Fee a tx needs to enter the pool. Raised by evictions, halves every ROLLING_MIN_FEE_HALF_LIFE.
+	static uint64_t get_min_fee_per_kb();
+
+	static constexpr char MEMPOOL_PATH[] = "mempool.dat";
+	// Miners also save at shutdown, this only bounds what a crash loses
+	static constexpr int64_t SAVE_INTERVAL_SECS = 10 * 60;
+
+	// Writes every entry with its fee and insertion time, parents ahead of their children, to path.new
+	// and then renames it to path
+	static void save_to_disk(const std::string& path = MEMPOOL_PATH);
+	// Revalidates saved entries in batches, checking each batch's signatures in parallel first, and
+	// admits them with their original insertion times. Returns the number of txs admitted.
+	static uint32_t load_from_disk(const std::string& path = MEMPOOL_PATH);
+
+	static void insert_entry(const std::string& tx_id, MempoolEntry entry);
 	static void remove_entry(const std::string& tx_id);
+	// Drops pool txs spending an outpoint that tx, just confirmed, spends, along with their descendants
+	static void remove_conflicts(const std::shared_ptr<Tx>& tx);
+	static void clear();
 
 private:
+	static constexpr auto ROLLING_MIN_FEE_HALF_LIFE = std::chrono::hours(12);
+
+	static constexpr uint32_t LOAD_BATCH_SIZE = 256;
+
+	// Shared by every admit_batch call for the checks it runs outside the lock, started on first use
+	static boost::asio::thread_pool& get_check_pool();
+
+	// Ordered by descendant score, i.e. max(own fee rate, fee rate with descendants), lowest first
+	static std::set<std::pair<uint64_t, std::string>> eviction_index;
+	// Ordered by insertion time, so expiry only visits entries that are due
+	static std::set<std::pair<std::chrono::steady_clock::time_point, std::string>> expiry_index;
+
+	// Value and time of the last raise. Reads decay from these without writing back, so frequent
+	// reads don't compound rounding.
+	static uint64_t rolling_min_fee_per_kb;
+	static std::chrono::steady_clock::time_point rolling_min_fee_updated;
+
+	static void raise_min_fee(uint64_t fee_per_kb);
+	static uint64_t get_descendant_score(const MempoolEntry& entry);
+
+	// Room left in the template for the block header and the coinbase
+	static constexpr uint32_t BLOCK_TEMPLATE_RESERVED_SIZE = 1000;
+
+	// While not dirty the template is valid to mine, parents ahead of children. It holds every tx in
+	// the pool unless the last rebuild had to leave some out, in which case any removal marks it dirty
+	// so the freed room gets refilled. Removed txs are only dropped from block_template.txs on the
+	// next get_block_template.
+	static BlockTemplate block_template;
+	static std::unordered_set<std::string> block_template_tx_ids;
+	static bool block_template_dirty;
+	static bool block_template_complete;
+
+	static void add_to_block_template(const std::string& tx_id, const MempoolEntry& entry);
+
 	static bool check_block_size(uint32_t current_size);
 
-	static std::shared_ptr<Block> try_add_to_block(std::shared_ptr<Block> block, const std::string& tx_id,
-		std::set<std::string>& added_to_block, uint32_t& current_block_size);
+	static std::vector<std::shared_ptr<Tx>> select_txs(uint32_t current_block_size);
+
+	// Per-tx state while assembling a block. ancestor_fee and ancestor_size cover the tx and its
+	// ancestors not yet in the block, and are lowered as ancestors get included.
+	struct AssemblyEntry
+	{
+		const MempoolEntry* entry = nullptr;
+		std::vector<std::string> ancestors;
+		uint64_t ancestor_fee = 0;
+		uint64_t ancestor_size = 0;
+		bool missing_inputs = false;
+
+		uint64_t score() const
+		{
+			return std::max(entry->fee_rate, ancestor_size > 0 ? ancestor_fee / ancestor_size : 0);
+		}
+	};
+
+	static std::unordered_map<std::string, AssemblyEntry> build_assembly_entries();
+
+	static bool accept_tx(const std::shared_ptr<Tx>& tx, std::chrono::steady_clock::time_point insertion_time,
+		bool relay, const Connection* from_peer = nullptr);
+
+	static uint32_t admit_batch(const std::vector<std::shared_ptr<Tx>>& txs,
+		const std::vector<std::chrono::steady_clock::time_point>& insertion_times, bool relay,
+		const Connection* from_peer);
+	static void retry_orphans(const std::string& tx_id);
 
-	static uint64_t compute_ancestor_package_fee_rate(const std::string& tx_id,
-		const std::set<std::string>& excluded);
+	// Expires old orphans, then evicts random ones until the pool is within its count and size caps
+	static void add_orphan(const std::shared_ptr<Tx>& tx, const Connection* from_peer);
+	static void remove_orphan(const std::string& tx_id);
 
 	static std::vector<std::shared_ptr<Tx>> find_conflicting_txs(const std::shared_ptr<Tx>& tx);
 	static std::vector<std::string> find_descendant_tx_ids(const std::string& tx_id);
 	static std::vector<std::string> find_ancestor_tx_ids(const std::string& tx_id);
+	static std::vector<std::string> walk_graph(const std::string& tx_id,
+		std::unordered_set<std::string> MempoolEntry::* links);
+
+	// Package totals move by one tx at a time as it joins or leaves another tx's package. Descendant
+	// totals key the eviction index, which is kept in step.
+	static void add_descendant(const std::string& tx_id, const MempoolEntry& descendant);
+	static void remove_descendant(const std::string& tx_id, const MempoolEntry& descendant);
+	static void remove_ancestor(MempoolEntry& entry, const MempoolEntry& ancestor);
+	// Recomputes both totals from the links, for graph changes the deltas above don't cover
+	static void update_package_state(const std::string& tx_id);
+
+	// For txs leaving the pool other than by confirming, which the fee estimator must stop timing
+	static void drop_entry(const std::string& tx_id);
+	// tx_ids must include every descendant of each tx in it. Children go first, so each removal
+	// only takes one tx out of its ancestors' totals.
+	static void drop_entries(std::vector<std::string> tx_ids);
+
+	static uint64_t estimate_entry_memory_usage(const std::string& tx_id, const MempoolEntry& entry);
+	// A parent/child link is an id in each of the two entries' link sets
+	static uint64_t get_link_memory_usage(const std::string& tx_id);
 
 	static bool violates_chain_limits(const std::shared_ptr<Tx>& tx);
 
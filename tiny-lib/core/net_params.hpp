@@ -23,12 +23,18 @@ public:
 	static constexpr uint32_t HALVE_SUBSIDY_AFTER_BLOCKS_NUM = 210000;
 
 	static constexpr int64_t LOCKTIME_THRESHOLD = 500000000;
+	static constexpr uint32_t MEDIAN_TIME_PAST_BLOCKS = 11;
 
 	static constexpr uint32_t MAX_ORPHAN_BLOCKS = 50;
 	static constexpr int64_t ORPHAN_BLOCK_EXPIRE_SECS = 60 * 60;
 
+	static constexpr uint32_t MAX_ORPHAN_TXS = 100;
+	static constexpr uint64_t MAX_ORPHAN_TXS_SIZE_BYTES = 5 * 1024 * 1024;
+	static constexpr int64_t ORPHAN_TX_EXPIRE_SECS = 20 * 60;
+
 	static constexpr uint64_t INCREMENTAL_RELAY_FEE = 1000;
 
+	// Cap on the estimated heap usage of the mempool, which is several times its serialized size
 	static constexpr uint64_t MAX_MEMPOOL_SIZE_BYTES = 300 * 1024 * 1024;
 
 	static constexpr uint32_t MAX_ANCESTOR_COUNT = 25;
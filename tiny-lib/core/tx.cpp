@@ -9,6 +9,7 @@
 #include "crypto/sig_cache.hpp"
 #include "util/exceptions.hpp"
 #include "util/log.hpp"
+#include "util/memory_usage.hpp"
 #include "core/mempool.hpp"
 #include "net/msg_serializer.hpp"
 #include "core/net_params.hpp"
@@ -74,11 +75,29 @@ std::string Tx::id() const
 	std::scoped_lock lock(cached_id_mutex_);
 
 	if (cached_id_.empty())
-		cached_id_ = Utils::byte_array_to_hex_string(SHA256::double_hash_binary(serialize().get_buffer()));
+		cached_id_ = Utils::byte_array_to_hex_string(SHA256::double_hash(serialize_legacy().get_buffer()));
 
 	return cached_id_;
 }
 
+size_t Tx::get_memory_usage() const
+{
+	std::scoped_lock lock(cached_id_mutex_);
+
+	size_t usage = MemoryUsage::shared_usage<Tx>() + MemoryUsage::dynamic_usage(cached_id_) +
+		MemoryUsage::dynamic_usage(tx_ins) + MemoryUsage::dynamic_usage(tx_outs);
+	for (const auto& tx_in : tx_ins)
+	{
+		usage += MemoryUsage::shared_usage<TxIn>() + MemoryUsage::dynamic_usage(tx_in->unlock_sig) +
+			MemoryUsage::dynamic_usage(tx_in->unlock_pub_key);
+		if (tx_in->to_spend != nullptr)
+			usage += MemoryUsage::shared_usage<TxOutPoint>() + MemoryUsage::dynamic_usage(tx_in->to_spend->tx_id);
+	}
+	usage += tx_outs.size() * MemoryUsage::shared_usage<TxOut>();
+
+	return usage;
+}
+
 void Tx::validate_basics(bool coinbase /*= false*/) const
 {
 	if (tx_outs.empty() || (tx_ins.empty() && !coinbase))
@@ -198,12 +217,18 @@ void Tx::validate(const ValidateRequest& req) const
 {
 	validate_basics(req.as_coinbase);
 
+	const auto context = req.context ? *req.context : Chain::get_validation_context();
+
 	if (!req.as_coinbase)
 	{
-		check_lock_time(Chain::get_current_height(), Chain::get_median_time_past(11));
-		check_sequence_locks(Chain::get_current_height(), Chain::get_median_time_past(11));
+		check_lock_time(context.height, context.median_time_past);
+		check_sequence_locks(context.height, context.median_time_past);
 	}
 
+	std::vector<uint8_t> serialized_tx_outs;
+	if (!req.skip_sig_validation)
+		serialized_tx_outs = MsgSerializer::serialize_tx_outs(tx_outs);
+
 	uint64_t available_to_spend = 0;
 	for (uint32_t i = 0; i < tx_ins.size(); i++)
 	{
@@ -228,14 +253,14 @@ void Tx::validate(const ValidateRequest& req) const
 					std::make_shared<Tx>(*this));
 		}
 
-		if (utxo->is_coinbase && Chain::get_current_height() - utxo->height < NetParams::COINBASE_MATURITY)
+		if (utxo->is_coinbase && context.height - utxo->height < NetParams::COINBASE_MATURITY)
 			throw TxValidationException("Coinbase UTXO not ready for spending");
 
 		if (!req.skip_sig_validation)
 		{
 			try
 			{
-				validate_signature_for_spend(tx_in, utxo);
+				validate_signature_for_spend(tx_in, utxo, serialized_tx_outs);
 			}
 			catch (const TxUnlockException& ex)
 			{
@@ -266,6 +291,9 @@ BinaryBuffer Tx::serialize() const
 {
 	BinaryBuffer buffer;
 
+	buffer.write_size(SERIALIZATION_MARKER);
+	buffer.write(SERIALIZATION_VERSION);
+
 	buffer.write_size(static_cast<uint32_t>(tx_ins.size()));
 	for (const auto& tx_in : tx_ins)
 		buffer.write_raw(tx_in->serialize().get_buffer());
@@ -279,12 +307,40 @@ BinaryBuffer Tx::serialize() const
 	return buffer;
 }
 
+BinaryBuffer Tx::serialize_legacy() const
+{
+	BinaryBuffer buffer;
+
+	buffer.write_size(static_cast<uint32_t>(tx_ins.size()));
+	for (const auto& tx_in : tx_ins)
+		buffer.write_raw(tx_in->serialize().get_buffer());
+
+	buffer.write_size(static_cast<uint32_t>(tx_outs.size()));
+	for (const auto& tx_out : tx_outs)
+		buffer.write_raw(tx_out->serialize_legacy().get_buffer());
+
+	buffer.write(lock_time);
+
+	return buffer;
+}
+
 bool Tx::deserialize(BinaryBuffer& buffer)
 {
 	uint32_t tx_ins_size = 0;
 	if (!buffer.read_size(tx_ins_size))
 		return false;
 
+	const bool legacy = tx_ins_size != SERIALIZATION_MARKER;
+	if (!legacy)
+	{
+		uint8_t version = 0;
+		if (!buffer.read(version) || version != SERIALIZATION_VERSION)
+			return false;
+
+		if (!buffer.read_size(tx_ins_size))
+			return false;
+	}
+
 	std::vector<std::shared_ptr<TxIn>> new_tx_ins;
 	new_tx_ins.reserve(tx_ins_size);
 	for (uint32_t i = 0; i < tx_ins_size; i++)
@@ -304,7 +360,7 @@ bool Tx::deserialize(BinaryBuffer& buffer)
 	for (uint32_t i = 0; i < tx_outs_size; i++)
 	{
 		auto tx_out = std::make_shared<TxOut>();
-		if (!tx_out->deserialize(buffer))
+		if (!(legacy ? tx_out->deserialize_legacy(buffer) : tx_out->deserialize(buffer)))
 			return false;
 		new_tx_outs.push_back(std::move(tx_out));
 	}
@@ -369,13 +425,36 @@ bool Tx::operator==(const Tx& obj) const
 	return true;
 }
 
-void Tx::validate_signature_for_spend(const std::shared_ptr<TxIn>& tx_in, const std::shared_ptr<UTXO>& utxo) const
+bool Tx::check_signatures(const std::vector<std::shared_ptr<UTXO>>& utxos) const
+{
+	const auto serialized_tx_outs = MsgSerializer::serialize_tx_outs(tx_outs);
+
+	for (uint32_t i = 0; i < tx_ins.size() && i < utxos.size(); i++)
+	{
+		if (utxos[i] == nullptr)
+			continue;
+
+		try
+		{
+			validate_signature_for_spend(tx_ins[i], utxos[i], serialized_tx_outs);
+		}
+		catch (const TxUnlockException&)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Tx::validate_signature_for_spend(const std::shared_ptr<TxIn>& tx_in, const std::shared_ptr<UTXO>& utxo,
+	const std::vector<uint8_t>& serialized_tx_outs) const
 {
-	const auto pub_key_as_addr = Wallet::pub_key_to_address(tx_in->unlock_pub_key);
-	if (pub_key_as_addr != utxo->tx_out->to_address)
+	if (utxo->tx_out->to_pub_key_hash != Wallet::pub_key_to_hash(tx_in->unlock_pub_key))
 		throw TxUnlockException("Public key does not match");
 
-	const auto spend_msg = MsgSerializer::build_spend_msg(tx_in->to_spend, tx_in->unlock_pub_key, tx_in->sequence, tx_outs);
+	const auto spend_msg = MsgSerializer::build_spend_msg(tx_in->to_spend, tx_in->unlock_pub_key, tx_in->sequence,
+		serialized_tx_outs);
 
 	if (SigCache::contains(tx_in->unlock_sig, spend_msg, tx_in->unlock_pub_key))
 		return;
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -16,6 +17,11 @@ class UnspentTxOut;
 class Tx : public ISerializable, public IDeserializable
 {
 public:
+	// serialize() starts with a zero input count followed by this version byte, which a legacy
+	// encoding can never produce for a valid tx (every tx, coinbase included, has an input)
+	static constexpr uint32_t SERIALIZATION_MARKER = 0;
+	static constexpr uint8_t SERIALIZATION_VERSION = 1;
+
 	Tx() = default;
 	Tx(const std::vector<std::shared_ptr<TxIn>>& tx_ins, const std::vector<std::shared_ptr<TxOut>>& tx_outs,
 		int64_t lock_time);
@@ -35,10 +41,23 @@ public:
 
 	std::string id() const;
 
+	// Estimated heap memory held by the tx, its inputs and outputs, assuming they were make_shared
+	size_t get_memory_usage() const;
+
 	void validate_basics(bool coinbase = false) const;
 
+	// Chain state that lock-time checks are evaluated against, taken once and shared by every
+	// tx validated against the same tip
+	struct ValidationContext
+	{
+		int64_t height = 0;
+		int64_t median_time_past = 0;
+	};
+
 	struct ValidateRequest
 	{
+		// Snapshot of the current tip if empty
+		std::optional<ValidationContext> context;
 		bool as_coinbase = false;
 		bool allow_utxo_from_mempool = true;
 		bool skip_sig_validation = false;
@@ -46,20 +65,29 @@ public:
 	};
 
 	void validate(const ValidateRequest& req) const;
+	// Checks the signature of every input given a utxo (nullptr entries are skipped), filling the
+	// signature cache so a later validate does not repeat the work. Safe to run in parallel.
+	bool check_signatures(const std::vector<std::shared_ptr<UnspentTxOut>>& utxos) const;
 
 	bool is_final() const;
 	void check_lock_time(int64_t block_height, int64_t block_mtp) const;
 	void check_sequence_locks(int64_t block_height, int64_t block_mtp) const;
 
+	// Compact encoding with binary destinations, used on the wire and on disk
 	BinaryBuffer serialize() const override;
+	// Accepts both the compact and the legacy encoding
 	bool deserialize(BinaryBuffer& buffer) override;
+	// Original encoding with Base58 destinations, which defines the tx id
+	BinaryBuffer serialize_legacy() const;
 
 	static std::shared_ptr<Tx> create_coinbase(const std::string& pay_to_addr, uint64_t value, int64_t height);
 
 	bool operator==(const Tx& obj) const;
 
 private:
-	void validate_signature_for_spend(const std::shared_ptr<TxIn>& tx_in, const std::shared_ptr<UnspentTxOut>& utxo) const;
+	// serialized_tx_outs is MsgSerializer::serialize_tx_outs(tx_outs), shared by all inputs
+	void validate_signature_for_spend(const std::shared_ptr<TxIn>& tx_in, const std::shared_ptr<UnspentTxOut>& utxo,
+		const std::vector<uint8_t>& serialized_tx_outs) const;
 
 	mutable std::string cached_id_;
 	mutable std::mutex cached_id_mutex_;
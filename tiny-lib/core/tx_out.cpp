@@ -1,20 +1,69 @@
 #include "core/tx_out.hpp"
 
-TxOut::TxOut(uint64_t value, std::string to_address)
-	: value(value), to_address(std::move(to_address))
+#include <stdexcept>
+
+#include "wallet/wallet.hpp"
+
+TxOut::TxOut(uint64_t value, const PubKeyHash& to_pub_key_hash)
+	: value(value), to_pub_key_hash(to_pub_key_hash)
 {}
 
+TxOut::TxOut(uint64_t value, const std::string& to_address)
+	: value(value)
+{
+	const auto pub_key_hash = Wallet::address_to_pub_key_hash(to_address);
+	if (!pub_key_hash)
+		throw std::invalid_argument("Invalid address: " + to_address);
+
+	to_pub_key_hash = *pub_key_hash;
+}
+
+TxOut::TxOut(uint64_t value, const char* to_address)
+	: TxOut(value, std::string(to_address))
+{}
+
+std::string TxOut::to_address() const
+{
+	return Wallet::pub_key_hash_to_address(to_pub_key_hash);
+}
+
 BinaryBuffer TxOut::serialize() const
 {
 	BinaryBuffer buffer;
 
 	buffer.write(value);
-	buffer.write(to_address);
+	buffer.write_raw(to_pub_key_hash);
 
 	return buffer;
 }
 
 bool TxOut::deserialize(BinaryBuffer& buffer)
+{
+	uint64_t new_value = 0;
+	if (!buffer.read(new_value))
+		return false;
+
+	PubKeyHash new_to_pub_key_hash;
+	if (!buffer.read_raw(new_to_pub_key_hash))
+		return false;
+
+	value = new_value;
+	to_pub_key_hash = new_to_pub_key_hash;
+
+	return true;
+}
+
+BinaryBuffer TxOut::serialize_legacy() const
+{
+	BinaryBuffer buffer;
+
+	buffer.write(value);
+	buffer.write(to_address());
+
+	return buffer;
+}
+
+bool TxOut::deserialize_legacy(BinaryBuffer& buffer)
 {
 	uint64_t new_value = 0;
 	if (!buffer.read(new_value))
@@ -24,8 +73,12 @@ bool TxOut::deserialize(BinaryBuffer& buffer)
 	if (!buffer.read(new_to_address))
 		return false;
 
+	const auto new_to_pub_key_hash = Wallet::address_to_pub_key_hash(new_to_address);
+	if (!new_to_pub_key_hash)
+		return false;
+
 	value = new_value;
-	to_address = std::move(new_to_address);
+	to_pub_key_hash = *new_to_pub_key_hash;
 
 	return true;
 }
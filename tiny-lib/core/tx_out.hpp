@@ -5,24 +5,39 @@
 
 #include "util/i_deserializable.hpp"
 #include "util/i_serializable.hpp"
+#include "crypto/ripemd160.hpp"
 
 class TxOut : public ISerializable, public IDeserializable
 {
 public:
+	using PubKeyHash = RIPEMD160::Hash;
+
 	TxOut() = default;
-	TxOut(uint64_t value, std::string to_address);
+	TxOut(uint64_t value, const PubKeyHash& to_pub_key_hash);
+	// Throws std::invalid_argument if the address is not a valid P2PKH address
+	TxOut(uint64_t value, const std::string& to_address);
+	TxOut(uint64_t value, const char* to_address);
 
 	uint64_t value = 0;
-	std::string to_address;
+	PubKeyHash to_pub_key_hash{};
+
+	// Base58Check form of to_pub_key_hash, for display and for the legacy encoding
+	std::string to_address() const;
 
+	// Compact encoding: value followed by the raw 20-byte pub key hash
 	BinaryBuffer serialize() const override;
 	bool deserialize(BinaryBuffer& buffer) override;
 
+	// Original encoding with the destination as a length-prefixed Base58 string. Tx ids and
+	// spend messages are still computed over it so existing chains and signatures stay valid.
+	BinaryBuffer serialize_legacy() const;
+	bool deserialize_legacy(BinaryBuffer& buffer);
+
 	bool operator==(const TxOut& obj) const;
 
 private:
 	auto tied() const
 	{
-		return std::tie(value, to_address);
+		return std::tie(value, to_pub_key_hash);
 	}
 };
@@ -1,57 +1,128 @@
 #include "crypto/base58.hpp"
 
 #include <algorithm>
-#include <openssl/bn.h>
+#include <cstring>
 
-std::string Base58::encode(const std::vector<uint8_t>& buffer)
+#include "crypto/sha256.hpp"
+
+std::string Base58::encode(std::span<const uint8_t> buffer)
 {
-	auto bn_ctx = BN_CTX_new();
-	auto bn = BN_new();
-	auto bn00 = BN_new();
-	auto bn58 = BN_new();
-	auto dv = BN_new();
-	auto rem = BN_new();
-
-	auto cleanup = [&]()
-	{
-		BN_free(rem);
-		BN_free(dv);
-		BN_free(bn58);
-		BN_free(bn00);
-		BN_free(bn);
-		BN_CTX_free(bn_ctx);
-	};
-
-	if (!BN_bin2bn(buffer.data(), static_cast<int>(buffer.size()), bn)
-		|| !BN_set_word(bn58, 58))
+	size_t zeros = 0;
+	while (zeros < buffer.size() && buffer[zeros] == 0x00)
+		zeros++;
+
+	// log(256) / log(58) ~ 1.37, the digits are accumulated big-endian in place
+	const size_t max_digits = (buffer.size() - zeros) * 138 / 100 + 1;
+	std::string result(zeros + max_digits, '\0');
+	auto* digits = reinterpret_cast<uint8_t*>(result.data()) + zeros;
+
+	size_t length = 0;
+	for (size_t i = zeros; i < buffer.size(); i++)
 	{
-		cleanup();
-		return {};
+		uint32_t carry = buffer[i];
+		size_t j = 0;
+		for (auto it = max_digits; (carry != 0 || j < length) && it > 0; it--, j++)
+		{
+			carry += 256 * static_cast<uint32_t>(digits[it - 1]);
+			digits[it - 1] = static_cast<uint8_t>(carry % 58);
+			carry /= 58;
+		}
+		length = j;
 	}
-	BN_zero(bn00);
 
-	std::string result;
-	while (BN_cmp(bn, bn00) > 0)
+	result.erase(zeros, max_digits - length);
+	std::fill_n(result.begin(), zeros, '1');
+	std::transform(result.begin() + zeros, result.end(), result.begin() + zeros,
+		[](char digit) { return table[static_cast<uint8_t>(digit)]; });
+
+	return result;
+}
+
+std::string Base58::encode_check(std::span<const uint8_t> payload)
+{
+	const auto checksum = SHA256::double_hash(payload);
+
+	std::vector<uint8_t> data;
+	data.reserve(payload.size() + CHECKSUM_SIZE);
+	data.insert(data.end(), payload.begin(), payload.end());
+	data.insert(data.end(), checksum.begin(), checksum.begin() + CHECKSUM_SIZE);
+
+	return encode(data);
+}
+
+bool Base58::decode(std::string_view str, std::vector<uint8_t>& out)
+{
+	size_t zeros = 0;
+	while (zeros < str.size() && str[zeros] == table[0])
+		zeros++;
+
+	// log(58) / log(256) ~ 0.733, the value is accumulated big-endian in place
+	std::vector<uint8_t> bytes((str.size() - zeros) * 733 / 1000 + 1);
+
+	size_t length = 0;
+	for (size_t i = zeros; i < str.size(); i++)
 	{
-		if (!BN_div(dv, rem, bn, bn58, bn_ctx) || BN_copy(bn, dv) == nullptr)
+		const auto digit = reverse_table[static_cast<uint8_t>(str[i])];
+		if (digit < 0)
+			return false;
+
+		uint32_t carry = static_cast<uint32_t>(digit);
+		size_t j = 0;
+		for (auto it = bytes.size(); (carry != 0 || j < length) && it > 0; it--, j++)
 		{
-			cleanup();
-			return {};
+			carry += 58 * static_cast<uint32_t>(bytes[it - 1]);
+			bytes[it - 1] = static_cast<uint8_t>(carry & 0xFF);
+			carry >>= 8;
 		}
-		const auto base58char = table[BN_get_word(rem)];
-		result += base58char;
+		length = j;
 	}
 
-	cleanup();
+	out.assign(zeros, 0x00);
+	out.insert(out.end(), bytes.end() - static_cast<std::ptrdiff_t>(length), bytes.end());
+
+	return true;
+}
+
+bool Base58::decode(std::string_view str, std::span<uint8_t> out)
+{
+	std::fill(out.begin(), out.end(), 0x00);
+
+	size_t zeros = 0;
+	while (zeros < str.size() && str[zeros] == table[0])
+		zeros++;
 
-	for (const auto& byte : buffer)
+	for (size_t i = zeros; i < str.size(); i++)
 	{
-		if (byte != 0x00)
-			break;
-		result += '1';
+		const auto digit = reverse_table[static_cast<uint8_t>(str[i])];
+		if (digit < 0)
+			return false;
+
+		uint32_t carry = static_cast<uint32_t>(digit);
+		for (size_t j = out.size(); j > 0; j--)
+		{
+			carry += 58 * static_cast<uint32_t>(out[j - 1]);
+			out[j - 1] = static_cast<uint8_t>(carry & 0xFF);
+			carry >>= 8;
+		}
+		if (carry != 0)
+			return false;
 	}
 
-	std::ranges::reverse(result);
+	// Each leading '1' stands for exactly one leading zero byte
+	size_t leading_zero_bytes = 0;
+	while (leading_zero_bytes < out.size() && out[leading_zero_bytes] == 0x00)
+		leading_zero_bytes++;
 
-	return result;
+	return leading_zero_bytes == zeros;
+}
+
+bool Base58::has_valid_checksum(std::span<const uint8_t> data)
+{
+	if (data.size() < CHECKSUM_SIZE)
+		return false;
+
+	const auto payload = data.first(data.size() - CHECKSUM_SIZE);
+	const auto checksum = SHA256::double_hash(payload);
+
+	return std::memcmp(checksum.data(), data.data() + payload.size(), CHECKSUM_SIZE) == 0;
 }
@@ -1,13 +1,47 @@
 #pragma once
+#include <array>
 #include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Base58
 {
 public:
-	static std::string encode(const std::vector<uint8_t>& buffer);
+	static constexpr size_t CHECKSUM_SIZE = 4;
+
+	static std::string encode(std::span<const uint8_t> buffer);
+	// Appends the first four bytes of SHA256d(payload) before encoding
+	static std::string encode_check(std::span<const uint8_t> payload);
+
+	static bool decode(std::string_view str, std::vector<uint8_t>& out);
+	// Decodes into exactly out.size() bytes, failing if the value has a different length
+	static bool decode(std::string_view str, std::span<uint8_t> out);
+
+	template <size_t N>
+	static bool decode_check(std::string_view str, std::array<uint8_t, N>& payload)
+	{
+		std::array<uint8_t, N + CHECKSUM_SIZE> decoded;
+		if (!decode(str, decoded) || !has_valid_checksum(decoded))
+			return false;
+
+		std::copy(decoded.begin(), decoded.begin() + N, payload.begin());
+
+		return true;
+	}
 
 private:
 	static constexpr char table[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+	static constexpr std::array<int8_t, 256> reverse_table = []
+	{
+		std::array<int8_t, 256> reverse{};
+		reverse.fill(-1);
+		for (int8_t i = 0; i < 58; i++)
+			reverse[static_cast<uint8_t>(table[i])] = i;
+		return reverse;
+	}();
+
+	static bool has_valid_checksum(std::span<const uint8_t> data);
 };
@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <openssl/evp.h>
 
+#include "crypto/hmac_sha512.hpp"
 #include "crypto/sha256.hpp"
 #include "crypto/ripemd160.hpp"
 
@@ -34,10 +35,23 @@ void Crypto::init()
 		cleanup();
 		throw std::runtime_error("Failed to load RIPEMD160");
 	}
+	HMACSHA512::mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+	if (HMACSHA512::mac == nullptr)
+	{
+		cleanup();
+		throw std::runtime_error("Failed to load HMAC");
+	}
 }
 
+// Pooled contexts are freed by their thread_local owners as each thread exits, which for the main
+// thread is before any atexit handler, this one included, gets to run
 void Crypto::cleanup()
 {
+	if (HMACSHA512::mac != nullptr)
+	{
+		EVP_MAC_free(HMACSHA512::mac);
+		HMACSHA512::mac = nullptr;
+	}
 	if (RIPEMD160::md != nullptr)
 	{
 		EVP_MD_free(RIPEMD160::md);
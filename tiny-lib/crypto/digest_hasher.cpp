@@ -0,0 +1,54 @@
+#include "crypto/digest_hasher.hpp"
+
+#include <stdexcept>
+
+thread_local std::vector<DigestHasher::CtxPtr> DigestHasher::ctx_pool;
+
+DigestHasher::DigestHasher(const EVP_MD* md)
+	: md(md)
+{
+	if (!ctx_pool.empty())
+	{
+		ctx = std::move(ctx_pool.back());
+		ctx_pool.pop_back();
+	}
+	else
+	{
+		ctx.reset(EVP_MD_CTX_new());
+		if (ctx == nullptr)
+			throw std::runtime_error("Failed to allocate digest context");
+	}
+}
+
+DigestHasher::~DigestHasher()
+{
+	if (ctx_pool.size() < MAX_POOLED_CTXS)
+		ctx_pool.push_back(std::move(ctx));
+}
+
+void DigestHasher::update(std::span<const uint8_t> data)
+{
+	if (!initialized)
+		init();
+
+	if (!EVP_DigestUpdate(ctx.get(), data.data(), data.size()))
+		throw std::runtime_error("Digest update failed");
+}
+
+void DigestHasher::finalize(uint8_t* out)
+{
+	if (!initialized)
+		init();
+
+	initialized = false;
+	if (!EVP_DigestFinal_ex(ctx.get(), out, nullptr))
+		throw std::runtime_error("Digest finalization failed");
+}
+
+void DigestHasher::init()
+{
+	if (!EVP_DigestInit_ex(ctx.get(), md, nullptr))
+		throw std::runtime_error("Digest initialization failed");
+
+	initialized = true;
+}
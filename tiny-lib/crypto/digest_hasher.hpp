@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <openssl/evp.h>
+
+// Incremental EVP digest whose EVP_MD_CTX is borrowed from a per-thread pool, so hashing
+// does not allocate once the pool is warm. Instances must stay on the thread that created them.
+class DigestHasher
+{
+public:
+	explicit DigestHasher(const EVP_MD* md);
+	~DigestHasher();
+
+	DigestHasher(const DigestHasher&) = delete;
+	DigestHasher& operator=(const DigestHasher&) = delete;
+
+	void update(std::span<const uint8_t> data);
+
+	// Writes the digest to out and leaves the hasher ready for the next message
+	void finalize(uint8_t* out);
+
+	static constexpr size_t MAX_POOLED_CTXS = 8;
+
+private:
+	using CtxPtr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+
+	const EVP_MD* md;
+	CtxPtr ctx{ nullptr, EVP_MD_CTX_free };
+	bool initialized = false;
+
+	static thread_local std::vector<CtxPtr> ctx_pool;
+
+	void init();
+};
@@ -4,6 +4,11 @@
 #include <openssl/core_names.h>
 #include <openssl/ec.h>
 
+#include "crypto/pub_key_cache.hpp"
+#include "crypto/secp256k1.hpp"
+
+thread_local std::unordered_map<EVP_PKEY*, ECDSA::VerifyCtx> ECDSA::verify_ctxs;
+
 std::pair<std::vector<uint8_t>, std::vector<uint8_t>> ECDSA::generate()
 {
 	EVP_PKEY* ec_key = nullptr;
@@ -85,8 +90,14 @@ std::pair<std::vector<uint8_t>, std::vector<uint8_t>> ECDSA::generate()
 	return { priv_key_buffer, pub_key_buffer };
 }
 
-std::vector<uint8_t> ECDSA::get_pub_key_from_priv_key(const std::vector<uint8_t>& priv_key)
+std::vector<uint8_t> ECDSA::get_pub_key_from_priv_key(const std::vector<uint8_t>& priv_key,
+	Engine engine /*= DEFAULT_PRIV_KEY_ENGINE*/)
 {
+	if (engine == Engine::Native)
+	{
+		return Secp256k1::get_pub_key(priv_key);
+	}
+
 	auto ec_key = create_key(priv_key, true);
 	if (ec_key == nullptr)
 	{
@@ -116,8 +127,14 @@ std::vector<uint8_t> ECDSA::get_pub_key_from_priv_key(const std::vector<uint8_t>
 	return pub_key_buffer;
 }
 
-std::vector<uint8_t> ECDSA::sign_msg(const std::vector<uint8_t>& msg, const std::vector<uint8_t>& priv_key)
+std::vector<uint8_t> ECDSA::sign_msg(const std::vector<uint8_t>& msg, const std::vector<uint8_t>& priv_key,
+	Engine engine /*= DEFAULT_PRIV_KEY_ENGINE*/)
 {
+	if (engine == Engine::Native)
+	{
+		return Secp256k1::sign(msg, priv_key);
+	}
+
 	auto ec_key = create_key(priv_key, true);
 	if (ec_key == nullptr)
 	{
@@ -158,41 +175,76 @@ std::vector<uint8_t> ECDSA::sign_msg(const std::vector<uint8_t>& msg, const std:
 }
 
 bool ECDSA::verify_sig(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& msg,
-	const std::vector<uint8_t>& pub_key)
+	const std::vector<uint8_t>& pub_key, Engine engine /*= DEFAULT_ENGINE*/)
 {
-	auto ec_key = create_key(pub_key);
+	if (engine == Engine::Native)
+	{
+		return Secp256k1::verify(sig, msg, pub_key);
+	}
+
+	const auto ec_key = get_verify_key(pub_key);
 	if (ec_key == nullptr)
 	{
 		return false;
 	}
 
-	auto p_ctx = EVP_PKEY_CTX_new_from_pkey(nullptr, ec_key, nullptr);
+	auto p_ctx = get_verify_ctx(ec_key);
 	if (p_ctx == nullptr)
 	{
-		EVP_PKEY_free(ec_key);
-
 		return false;
 	}
 
-	if (!EVP_PKEY_verify_init(p_ctx))
+	return EVP_PKEY_verify(p_ctx, sig.data(), sig.size(), msg.data(), msg.size()) == 1;
+}
+
+std::shared_ptr<EVP_PKEY> ECDSA::get_verify_key(const std::vector<uint8_t>& pub_key)
+{
+	auto cached_key = PubKeyCache::get(pub_key);
+	if (cached_key != nullptr)
 	{
-		EVP_PKEY_free(ec_key);
-		EVP_PKEY_CTX_free(p_ctx);
+		return cached_key;
+	}
 
-		return false;
+	auto ec_key = create_key(pub_key);
+	if (ec_key == nullptr)
+	{
+		return nullptr;
 	}
-	if (!EVP_PKEY_verify(p_ctx, sig.data(), sig.size(), msg.data(), msg.size()))
+
+	std::shared_ptr<EVP_PKEY> key(ec_key, EVP_PKEY_free);
+	PubKeyCache::add(pub_key, key);
+
+	return key;
+}
+
+EVP_PKEY_CTX* ECDSA::get_verify_ctx(const std::shared_ptr<EVP_PKEY>& key)
+{
+	const auto it = verify_ctxs.find(key.get());
+	if (it != verify_ctxs.end())
 	{
-		EVP_PKEY_free(ec_key);
-		EVP_PKEY_CTX_free(p_ctx);
+		return it->second.ctx.get();
+	}
 
-		return false;
+	VerifyCtx verify_ctx;
+	verify_ctx.key = key;
+	verify_ctx.ctx.reset(EVP_PKEY_CTX_new_from_pkey(nullptr, key.get(), nullptr));
+	if (verify_ctx.ctx == nullptr)
+	{
+		return nullptr;
 	}
 
-	EVP_PKEY_free(ec_key);
-	EVP_PKEY_CTX_free(p_ctx);
+	if (EVP_PKEY_verify_init(verify_ctx.ctx.get()) != 1)
+	{
+		return nullptr;
+	}
+
+	if (verify_ctxs.size() >= MAX_THREAD_VERIFY_CTXS)
+		verify_ctxs.clear();
+
+	auto p_ctx = verify_ctx.ctx.get();
+	verify_ctxs.emplace(key.get(), std::move(verify_ctx));
 
-	return true;
+	return p_ctx;
 }
 
 OSSL_PARAM_BLD* ECDSA::create_param_build()
@@ -229,7 +281,7 @@ BIGNUM* ECDSA::add_priv_key_param(OSSL_PARAM_BLD* param_bld, const std::vector<u
 
 bool ECDSA::add_pub_key_param(OSSL_PARAM_BLD* param_bld, const std::vector<uint8_t>& pub_key)
 {
-	return OSSL_PARAM_BLD_push_octet_string(param_bld, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY, pub_key.data(),
+	return OSSL_PARAM_BLD_push_octet_string(param_bld, OSSL_PKEY_PARAM_PUB_KEY, pub_key.data(),
 		pub_key.size());
 }
 
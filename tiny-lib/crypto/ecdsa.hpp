@@ -1,5 +1,7 @@
 #pragma once
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -9,14 +11,48 @@
 class ECDSA
 {
 public:
+	enum class Engine
+	{
+		OpenSSL,
+		Native
+	};
+
+#ifdef TINY_COIN_NATIVE_SECP256K1
+	static constexpr Engine DEFAULT_ENGINE = Engine::Native;
+#else
+	static constexpr Engine DEFAULT_ENGINE = Engine::OpenSSL;
+#endif
+	// Operations on private keys stay on OpenSSL whatever the build, see sign_msg
+	static constexpr Engine DEFAULT_PRIV_KEY_ENGINE = Engine::OpenSSL;
+
 	static std::pair<std::vector<uint8_t>, std::vector<uint8_t>> generate();
-	static std::vector<uint8_t> get_pub_key_from_priv_key(const std::vector<uint8_t>& priv_key);
+	static std::vector<uint8_t> get_pub_key_from_priv_key(const std::vector<uint8_t>& priv_key,
+		Engine engine = DEFAULT_PRIV_KEY_ENGINE);
 
-	static std::vector<uint8_t> sign_msg(const std::vector<uint8_t>& msg, const std::vector<uint8_t>& priv_key);
+	// The OpenSSL (3.x) EVP path is constant time in the secret values: k * G runs on a Montgomery
+	// ladder, k is inverted by Fermat exponentiation with BN_mod_exp_mont_consttime and s is computed
+	// with fixed-width Montgomery arithmetic. The native engine is not, as its generator
+	// multiplication indexes tables by, and skips on, digits of the nonce, so it only signs when
+	// asked for explicitly.
+	static std::vector<uint8_t> sign_msg(const std::vector<uint8_t>& msg, const std::vector<uint8_t>& priv_key,
+		Engine engine = DEFAULT_PRIV_KEY_ENGINE);
 	static bool verify_sig(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& msg,
-		const std::vector<uint8_t>& pub_key);
+		const std::vector<uint8_t>& pub_key, Engine engine = DEFAULT_ENGINE);
+
+	static constexpr uint32_t MAX_THREAD_VERIFY_CTXS = 64;
 
 private:
+	struct VerifyCtx
+	{
+		std::shared_ptr<EVP_PKEY> key;
+		std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> ctx{ nullptr, EVP_PKEY_CTX_free };
+	};
+
+	static thread_local std::unordered_map<EVP_PKEY*, VerifyCtx> verify_ctxs;
+
+	static std::shared_ptr<EVP_PKEY> get_verify_key(const std::vector<uint8_t>& pub_key);
+	static EVP_PKEY_CTX* get_verify_ctx(const std::shared_ptr<EVP_PKEY>& key);
+
 	static OSSL_PARAM_BLD* create_param_build();
 	static BIGNUM* add_priv_key_param(OSSL_PARAM_BLD* param_bld, const std::vector<uint8_t>& priv_key);
 	static bool add_pub_key_param(OSSL_PARAM_BLD* param_bld, const std::vector<uint8_t>& pub_key);
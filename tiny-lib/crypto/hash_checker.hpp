@@ -1,13 +1,14 @@
 #pragma once
 #include <cstdint>
+#include <span>
 #include <string>
-#include <vector>
 
 #include "util/uint256_t.hpp"
 
 class HashChecker
 {
 public:
+	// hash is the hex form of a digest, as returned by Block::id
 	static bool is_valid(const std::string& hash, const uint256_t& target_hash);
-	static bool is_valid(const std::vector<uint8_t>& hash_bytes, const uint256_t& target_hash);
+	static bool is_valid(std::span<const uint8_t, uint256_t::BYTE_SIZE> hash_bytes, const uint256_t& target_hash);
 };
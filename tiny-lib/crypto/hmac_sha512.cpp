@@ -1,53 +1,64 @@
 #include "crypto/hmac_sha512.hpp"
 
+#include <stdexcept>
+
 #include <openssl/core_names.h>
-#include <openssl/evp.h>
 #include <openssl/params.h>
 
-std::vector<uint8_t> HMACSHA512::hash(const std::vector<uint8_t>& key, const std::vector<uint8_t>& data)
-{
-    auto* mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
-    if (mac == nullptr)
-        return {};
+EVP_MAC* HMACSHA512::mac = nullptr;
+thread_local std::vector<std::unique_ptr<EVP_MAC_CTX, decltype(&EVP_MAC_CTX_free)>> HMACSHA512::ctx_pool;
 
-    auto* ctx = EVP_MAC_CTX_new(mac);
-    if (ctx == nullptr)
+HMACSHA512::Hasher::Hasher(std::span<const uint8_t> key)
+{
+    if (!ctx_pool.empty())
     {
-        EVP_MAC_free(mac);
-        return {};
+        ctx = std::move(ctx_pool.back());
+        ctx_pool.pop_back();
     }
-
-    char digest_name[] = "SHA512";
-    OSSL_PARAM params[] = {
-        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest_name, 0),
-        OSSL_PARAM_construct_end()
-    };
-
-    if (!EVP_MAC_init(ctx, key.data(), key.size(), params))
+    else
     {
-        EVP_MAC_CTX_free(ctx);
-        EVP_MAC_free(mac);
-        return {};
-    }
+        ctx.reset(EVP_MAC_CTX_new(mac));
+        if (ctx == nullptr)
+            throw std::runtime_error("Failed to allocate HMAC-SHA512 context");
 
-    if (!EVP_MAC_update(ctx, data.data(), data.size()))
-    {
-        EVP_MAC_CTX_free(ctx);
-        EVP_MAC_free(mac);
-        return {};
+        char digest_name[] = "SHA512";
+        const OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest_name, 0),
+            OSSL_PARAM_construct_end()
+        };
+        if (!EVP_MAC_CTX_set_params(ctx.get(), params))
+            throw std::runtime_error("Failed to configure HMAC-SHA512 context");
     }
 
-    std::vector<uint8_t> result(64);
-    size_t out_len = 64;
-    if (!EVP_MAC_final(ctx, result.data(), &out_len, result.size()))
-    {
-        EVP_MAC_CTX_free(ctx);
-        EVP_MAC_free(mac);
-        return {};
-    }
+    if (!EVP_MAC_init(ctx.get(), key.data(), key.size(), nullptr))
+        throw std::runtime_error("HMAC-SHA512 initialization failed");
+}
 
-    EVP_MAC_CTX_free(ctx);
-    EVP_MAC_free(mac);
+HMACSHA512::Hasher::~Hasher()
+{
+    if (ctx != nullptr && ctx_pool.size() < MAX_POOLED_CTXS)
+        ctx_pool.push_back(std::move(ctx));
+}
+
+HMACSHA512::Hasher& HMACSHA512::Hasher::update(std::span<const uint8_t> data)
+{
+    if (!EVP_MAC_update(ctx.get(), data.data(), data.size()))
+        throw std::runtime_error("HMAC-SHA512 update failed");
+
+    return *this;
+}
 
-    return result;
+HMACSHA512::Hash HMACSHA512::Hasher::finalize()
+{
+    Hash hash;
+    size_t out_len = 0;
+    if (!EVP_MAC_final(ctx.get(), hash.data(), &out_len, hash.size()) || out_len != hash.size())
+        throw std::runtime_error("HMAC-SHA512 finalization failed");
+
+    return hash;
+}
+
+HMACSHA512::Hash HMACSHA512::hash(std::span<const uint8_t> key, std::span<const uint8_t> data)
+{
+    return Hasher(key).update(data).finalize();
 }
@@ -1,9 +1,42 @@
 #pragma once
+#include <array>
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
 
+#include <openssl/evp.h>
+
 class HMACSHA512
 {
+    friend class Crypto;
+
 public:
-    static std::vector<uint8_t> hash(const std::vector<uint8_t>& key, const std::vector<uint8_t>& data);
+    static constexpr size_t HASH_SIZE = 64;
+    using Hash = std::array<uint8_t, HASH_SIZE>;
+
+    // Incremental HMAC over a MAC context borrowed from a per-thread pool
+    class Hasher
+    {
+    public:
+        explicit Hasher(std::span<const uint8_t> key);
+        ~Hasher();
+
+        Hasher(const Hasher&) = delete;
+        Hasher& operator=(const Hasher&) = delete;
+
+        Hasher& update(std::span<const uint8_t> data);
+        Hash finalize();
+
+    private:
+        std::unique_ptr<EVP_MAC_CTX, decltype(&EVP_MAC_CTX_free)> ctx{ nullptr, EVP_MAC_CTX_free };
+    };
+
+    static Hash hash(std::span<const uint8_t> key, std::span<const uint8_t> data);
+
+    static constexpr size_t MAX_POOLED_CTXS = 8;
+
+private:
+    static EVP_MAC* mac;
+    static thread_local std::vector<std::unique_ptr<EVP_MAC_CTX, decltype(&EVP_MAC_CTX_free)>> ctx_pool;
 };
@@ -0,0 +1,79 @@
+#include "crypto/pub_key_cache.hpp"
+
+PubKeyCache::LruList PubKeyCache::lru_;
+std::unordered_map<std::string, PubKeyCache::LruList::iterator> PubKeyCache::index_;
+std::mutex PubKeyCache::mutex_;
+
+std::atomic<uint64_t> PubKeyCache::hits_ = 0;
+std::atomic<uint64_t> PubKeyCache::misses_ = 0;
+
+std::shared_ptr<EVP_PKEY> PubKeyCache::get(const std::vector<uint8_t>& pub_key)
+{
+	const std::string key(pub_key.begin(), pub_key.end());
+
+	std::scoped_lock lock(mutex_);
+
+	const auto it = index_.find(key);
+	if (it == index_.end())
+	{
+		++misses_;
+
+		return nullptr;
+	}
+
+	lru_.splice(lru_.begin(), lru_, it->second);
+	++hits_;
+
+	return it->second->second;
+}
+
+void PubKeyCache::add(const std::vector<uint8_t>& pub_key, const std::shared_ptr<EVP_PKEY>& key)
+{
+	std::string cache_key(pub_key.begin(), pub_key.end());
+
+	std::scoped_lock lock(mutex_);
+
+	const auto it = index_.find(cache_key);
+	if (it != index_.end())
+	{
+		lru_.splice(lru_.begin(), lru_, it->second);
+
+		return;
+	}
+
+	lru_.emplace_front(std::move(cache_key), key);
+	index_.emplace(lru_.front().first, lru_.begin());
+
+	while (lru_.size() > MAX_ENTRIES)
+	{
+		index_.erase(lru_.back().first);
+		lru_.pop_back();
+	}
+}
+
+uint64_t PubKeyCache::get_hits()
+{
+	return hits_;
+}
+
+uint64_t PubKeyCache::get_misses()
+{
+	return misses_;
+}
+
+size_t PubKeyCache::size()
+{
+	std::scoped_lock lock(mutex_);
+
+	return lru_.size();
+}
+
+void PubKeyCache::clear()
+{
+	std::scoped_lock lock(mutex_);
+
+	index_.clear();
+	lru_.clear();
+	hits_ = 0;
+	misses_ = 0;
+}
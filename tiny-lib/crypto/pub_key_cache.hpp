@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <openssl/evp.h>
+
+class PubKeyCache
+{
+public:
+	static constexpr uint32_t MAX_ENTRIES = 10000;
+
+	static std::shared_ptr<EVP_PKEY> get(const std::vector<uint8_t>& pub_key);
+	static void add(const std::vector<uint8_t>& pub_key, const std::shared_ptr<EVP_PKEY>& key);
+
+	static uint64_t get_hits();
+	static uint64_t get_misses();
+	static size_t size();
+
+	static void clear();
+
+private:
+	using LruList = std::list<std::pair<std::string, std::shared_ptr<EVP_PKEY>>>;
+
+	static LruList lru_;
+	static std::unordered_map<std::string, LruList::iterator> index_;
+	static std::mutex mutex_;
+
+	static std::atomic<uint64_t> hits_;
+	static std::atomic<uint64_t> misses_;
+};
@@ -1,24 +1,35 @@
 #include "crypto/ripemd160.hpp"
 
-#include <memory>
+EVP_MD* RIPEMD160::md = nullptr;
 
-#include <openssl/ripemd.h>
+// Static initializers such as the genesis block index hash before Crypto::init has fetched md
+RIPEMD160::Hasher::Hasher()
+	: digest(md != nullptr ? md : EVP_ripemd160())
+{}
 
-EVP_MD* RIPEMD160::md = nullptr;
+RIPEMD160::Hasher& RIPEMD160::Hasher::update(std::span<const uint8_t> data)
+{
+	digest.update(data);
 
-std::vector<uint8_t> RIPEMD160::hash_binary(const std::vector<uint8_t>& buffer)
+	return *this;
+}
+
+RIPEMD160::Hash RIPEMD160::Hasher::finalize()
 {
-	std::vector<uint8_t> hash(RIPEMD160_DIGEST_LENGTH);
-
-	std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> md_ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-	if (!md_ctx)
-		return {};
-	if (!EVP_DigestInit_ex(md_ctx.get(), md, nullptr))
-		return {};
-	if (!EVP_DigestUpdate(md_ctx.get(), buffer.data(), buffer.size()))
-		return {};
-	if (!EVP_DigestFinal_ex(md_ctx.get(), hash.data(), nullptr))
-		return {};
+	Hash hash;
+	digest.finalize(hash.data());
 
 	return hash;
 }
+
+RIPEMD160::Hash RIPEMD160::hash(std::span<const uint8_t> data)
+{
+	return Hasher().update(data).finalize();
+}
+
+std::vector<uint8_t> RIPEMD160::hash_binary(const std::vector<uint8_t>& buffer)
+{
+	const auto hash = RIPEMD160::hash(buffer);
+
+	return { hash.begin(), hash.end() };
+}
@@ -1,14 +1,35 @@
 #pragma once
+#include <array>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #include <openssl/evp.h>
 
+#include "crypto/digest_hasher.hpp"
+
 class RIPEMD160
 {
 	friend class Crypto;
 
 public:
+	static constexpr size_t HASH_SIZE = 20;
+	using Hash = std::array<uint8_t, HASH_SIZE>;
+
+	class Hasher
+	{
+	public:
+		Hasher();
+
+		Hasher& update(std::span<const uint8_t> data);
+		Hash finalize();
+
+	private:
+		DigestHasher digest;
+	};
+
+	static Hash hash(std::span<const uint8_t> data);
+
 	static std::vector<uint8_t> hash_binary(const std::vector<uint8_t>& buffer);
 
 private:
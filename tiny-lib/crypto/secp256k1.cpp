@@ -0,0 +1,880 @@
+#include "crypto/secp256k1.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <span>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#include "crypto/sha256.hpp"
+
+namespace
+{
+	// 256-bit values as four little-endian 64-bit limbs
+	using Limbs = std::array<uint64_t, 4>;
+
+	struct AffinePoint
+	{
+		Limbs x{};
+		Limbs y{};
+	};
+
+	struct JacobianPoint
+	{
+		Limbs x{};
+		Limbs y{};
+		Limbs z{};
+		bool infinity = true;
+	};
+}
+
+static constexpr Limbs ONE{ 1, 0, 0, 0 };
+static constexpr Limbs SEVEN{ 7, 0, 0, 0 };
+
+static constexpr Limbs P{ 0xFFFFFFFEFFFFFC2FULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL,
+	0xFFFFFFFFFFFFFFFFULL };
+static constexpr Limbs P_MINUS_2{ 0xFFFFFFFEFFFFFC2DULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL,
+	0xFFFFFFFFFFFFFFFFULL };
+static constexpr Limbs P_PLUS_1_DIV_4{ 0xFFFFFFFFBFFFFF0CULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL,
+	0x3FFFFFFFFFFFFFFFULL };
+// 2^256 - p
+static constexpr uint64_t P_COMPLEMENT = 0x1000003D1ULL;
+
+static constexpr Limbs N{ 0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL,
+	0xFFFFFFFFFFFFFFFFULL };
+static constexpr Limbs N_MINUS_2{ 0xBFD25E8CD036413FULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL,
+	0xFFFFFFFFFFFFFFFFULL };
+static constexpr Limbs N_HALF{ 0xDFE92F46681B20A0ULL, 0x5D576E7357A4501DULL, 0xFFFFFFFFFFFFFFFFULL,
+	0x7FFFFFFFFFFFFFFFULL };
+// 2^256 - n, only the low three limbs are non-zero
+static constexpr Limbs N_COMPLEMENT{ 0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 0x1ULL, 0x0ULL };
+
+static constexpr AffinePoint G{
+	{ 0x59F2815B16F81798ULL, 0x029BFCDB2DCE28D9ULL, 0x55A06295CE870B07ULL, 0x79BE667EF9DCBBACULL },
+	{ 0x9C47D08FFB10D4B8ULL, 0xFD17B448A6855419ULL, 0x5DA4FBFC0E1108A8ULL, 0x483ADA7726A3C465ULL }
+};
+
+// Endomorphism lambda * (x, y) = (beta * x, y) and the lattice basis used to split scalars,
+// see "Faster Point Multiplication on Elliptic Curves with Efficient Endomorphisms" (GLV)
+static constexpr Limbs BETA{ 0xC1396C28719501EEULL, 0x9CF0497512F58995ULL, 0x6E64479EAC3434E9ULL,
+	0x7AE96A2B657C0710ULL };
+static constexpr Limbs MINUS_LAMBDA{ 0xE0CFC810B51283CFULL, 0xA880B9FC8EC739C2ULL, 0x5AD9E3FD77ED9BA4ULL,
+	0xAC9C52B33FA3CF1FULL };
+static constexpr Limbs MINUS_B1{ 0x6F547FA90ABFE4C3ULL, 0xE4437ED6010E8828ULL, 0x0ULL, 0x0ULL };
+static constexpr Limbs MINUS_B2{ 0xD765CDA83DB1562CULL, 0x8A280AC50774346DULL, 0xFFFFFFFFFFFFFFFEULL,
+	0xFFFFFFFFFFFFFFFFULL };
+static constexpr Limbs G1{ 0xE893209A45DBB031ULL, 0x3DAA8A1471E8CA7FULL, 0xE86C90E49284EB15ULL,
+	0x3086D221A7D46BCDULL };
+static constexpr Limbs G2{ 0x1571B4AE8AC47F71ULL, 0x221208AC9DF506C6ULL, 0x6F547FA90ABFE4C4ULL,
+	0xE4437ED6010E8828ULL };
+
+// Generator multiples d * 16^w * G for every 4-bit window w and non-zero digit d
+static constexpr size_t GEN_WINDOW_BITS = 4;
+static constexpr size_t GEN_WINDOWS = 256 / GEN_WINDOW_BITS;
+static constexpr size_t GEN_WINDOW_SIZE = (1 << GEN_WINDOW_BITS) - 1;
+using GeneratorTable = std::array<std::array<AffinePoint, GEN_WINDOW_SIZE>, GEN_WINDOWS>;
+
+// Odd multiples P, 3P, ..., 15P used by the width-5 NAF during verification
+static constexpr size_t WNAF_WINDOW_BITS = 5;
+static constexpr size_t WNAF_TABLE_SIZE = 1 << (WNAF_WINDOW_BITS - 2);
+using WnafTable = std::array<JacobianPoint, WNAF_TABLE_SIZE>;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static uint64_t mul_wide(uint64_t a, uint64_t b, uint64_t& hi)
+{
+	return _umul128(a, b, &hi);
+}
+#else
+__extension__ typedef unsigned __int128 u128;
+
+static uint64_t mul_wide(uint64_t a, uint64_t b, uint64_t& hi)
+{
+	const u128 product = static_cast<u128>(a) * b;
+	hi = static_cast<uint64_t>(product >> 64);
+	return static_cast<uint64_t>(product);
+}
+#endif
+
+static uint64_t add_with_carry(uint64_t a, uint64_t b, uint64_t& carry)
+{
+	const uint64_t sum = a + carry;
+	uint64_t carry_out = sum < carry;
+	const uint64_t result = sum + b;
+	carry_out += result < b;
+	carry = carry_out;
+	return result;
+}
+
+static uint64_t sub_with_borrow(uint64_t a, uint64_t b, uint64_t& borrow)
+{
+	const uint64_t diff = a - b;
+	uint64_t borrow_out = a < b;
+	const uint64_t result = diff - borrow;
+	borrow_out += diff < borrow;
+	borrow = borrow_out;
+	return result;
+}
+
+static bool is_zero(const Limbs& a)
+{
+	return (a[0] | a[1] | a[2] | a[3]) == 0;
+}
+
+static int compare(const Limbs& a, const Limbs& b)
+{
+	for (size_t i = 4; i-- > 0;)
+	{
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+static uint64_t add_limbs(Limbs& r, const Limbs& a, const Limbs& b)
+{
+	uint64_t carry = 0;
+	for (size_t i = 0; i < 4; i++)
+		r[i] = add_with_carry(a[i], b[i], carry);
+	return carry;
+}
+
+static uint64_t sub_limbs(Limbs& r, const Limbs& a, const Limbs& b)
+{
+	uint64_t borrow = 0;
+	for (size_t i = 0; i < 4; i++)
+		r[i] = sub_with_borrow(a[i], b[i], borrow);
+	return borrow;
+}
+
+static void mul_limbs(const Limbs& a, const Limbs& b, uint64_t (&t)[8])
+{
+	std::fill(std::begin(t), std::end(t), 0);
+	for (size_t i = 0; i < 4; i++)
+	{
+		uint64_t carry = 0;
+		for (size_t j = 0; j < 4; j++)
+		{
+			uint64_t hi;
+			uint64_t lo = mul_wide(a[i], b[j], hi);
+			lo += t[i + j];
+			hi += lo < t[i + j];
+			lo += carry;
+			hi += lo < carry;
+			t[i + j] = lo;
+			carry = hi;
+		}
+		t[i + 4] = carry;
+	}
+}
+
+static Limbs limbs_from_bytes(const uint8_t* bytes)
+{
+	Limbs r{};
+	for (size_t i = 0; i < 32; i++)
+		r[3 - i / 8] |= static_cast<uint64_t>(bytes[i]) << (56 - 8 * (i % 8));
+	return r;
+}
+
+static void limbs_to_bytes(const Limbs& a, uint8_t* bytes)
+{
+	for (size_t i = 0; i < 32; i++)
+		bytes[i] = static_cast<uint8_t>(a[3 - i / 8] >> (56 - 8 * (i % 8)));
+}
+
+// Reads up to 32 big-endian bytes, left-padding shorter inputs with zeros
+static bool limbs_from_short_bytes(const uint8_t* bytes, size_t size, Limbs& out)
+{
+	if (size > 32)
+		return false;
+
+	uint8_t padded[32] = {};
+	if (size > 0)
+		std::memcpy(padded + 32 - size, bytes, size);
+	out = limbs_from_bytes(padded);
+	return true;
+}
+
+// Field arithmetic modulo p = 2^256 - 2^32 - 977, results are always fully reduced
+
+static Limbs fe_reduce_wide(const uint64_t (&t)[8])
+{
+	Limbs r;
+	uint64_t carry = 0;
+	for (size_t i = 0; i < 4; i++)
+	{
+		uint64_t hi;
+		uint64_t lo = mul_wide(t[i + 4], P_COMPLEMENT, hi);
+		lo += t[i];
+		hi += lo < t[i];
+		lo += carry;
+		hi += lo < carry;
+		r[i] = lo;
+		carry = hi;
+	}
+
+	uint64_t hi;
+	const uint64_t lo = mul_wide(carry, P_COMPLEMENT, hi);
+	if (add_limbs(r, r, { lo, hi, 0, 0 }))
+		add_limbs(r, r, { P_COMPLEMENT, 0, 0, 0 });
+
+	if (compare(r, P) >= 0)
+		sub_limbs(r, r, P);
+	return r;
+}
+
+static Limbs fe_add(const Limbs& a, const Limbs& b)
+{
+	Limbs r;
+	if (add_limbs(r, a, b) || compare(r, P) >= 0)
+		sub_limbs(r, r, P);
+	return r;
+}
+
+static Limbs fe_sub(const Limbs& a, const Limbs& b)
+{
+	Limbs r;
+	if (sub_limbs(r, a, b))
+		add_limbs(r, r, P);
+	return r;
+}
+
+static Limbs fe_neg(const Limbs& a)
+{
+	return fe_sub({}, a);
+}
+
+static Limbs fe_mul(const Limbs& a, const Limbs& b)
+{
+	uint64_t t[8];
+	mul_limbs(a, b, t);
+	return fe_reduce_wide(t);
+}
+
+static Limbs fe_sqr(const Limbs& a)
+{
+	return fe_mul(a, a);
+}
+
+static Limbs fe_pow(const Limbs& a, const Limbs& exp)
+{
+	Limbs r = ONE;
+	for (size_t i = 256; i-- > 0;)
+	{
+		r = fe_sqr(r);
+		if ((exp[i / 64] >> (i % 64)) & 1)
+			r = fe_mul(r, a);
+	}
+	return r;
+}
+
+static Limbs fe_inv(const Limbs& a)
+{
+	return fe_pow(a, P_MINUS_2);
+}
+
+// Scalar arithmetic modulo the group order n
+
+static Limbs sc_reduce_wide(const uint64_t (&t)[8])
+{
+	uint64_t w[8];
+	std::copy(std::begin(t), std::end(t), w);
+
+	// Fold the upper half back in as hi * (2^256 - n) until it fits in 256 bits
+	while ((w[4] | w[5] | w[6] | w[7]) != 0)
+	{
+		uint64_t u[8] = { w[0], w[1], w[2], w[3], 0, 0, 0, 0 };
+		for (size_t i = 0; i < 4; i++)
+		{
+			uint64_t carry = 0;
+			for (size_t j = 0; j < 3; j++)
+			{
+				uint64_t hi;
+				uint64_t lo = mul_wide(w[i + 4], N_COMPLEMENT[j], hi);
+				lo += u[i + j];
+				hi += lo < u[i + j];
+				lo += carry;
+				hi += lo < carry;
+				u[i + j] = lo;
+				carry = hi;
+			}
+			for (size_t k = i + 3; carry != 0 && k < 8; k++)
+			{
+				u[k] += carry;
+				carry = u[k] < carry;
+			}
+		}
+		std::copy(std::begin(u), std::end(u), w);
+	}
+
+	Limbs r{ w[0], w[1], w[2], w[3] };
+	while (compare(r, N) >= 0)
+		sub_limbs(r, r, N);
+	return r;
+}
+
+static Limbs sc_add(const Limbs& a, const Limbs& b)
+{
+	Limbs r;
+	if (add_limbs(r, a, b) || compare(r, N) >= 0)
+		sub_limbs(r, r, N);
+	return r;
+}
+
+static Limbs sc_neg(const Limbs& a)
+{
+	if (is_zero(a))
+		return a;
+
+	Limbs r;
+	sub_limbs(r, N, a);
+	return r;
+}
+
+static Limbs sc_mul(const Limbs& a, const Limbs& b)
+{
+	uint64_t t[8];
+	mul_limbs(a, b, t);
+	return sc_reduce_wide(t);
+}
+
+static Limbs sc_inv(const Limbs& a)
+{
+	Limbs r = ONE;
+	for (size_t i = 256; i-- > 0;)
+	{
+		r = sc_mul(r, r);
+		if ((N_MINUS_2[i / 64] >> (i % 64)) & 1)
+			r = sc_mul(r, a);
+	}
+	return r;
+}
+
+// Returns round(a * b / 2^384)
+static Limbs sc_mul_shift_384(const Limbs& a, const Limbs& b)
+{
+	uint64_t t[8];
+	mul_limbs(a, b, t);
+
+	Limbs r{ t[6], t[7], 0, 0 };
+	add_limbs(r, r, { t[5] >> 63, 0, 0, 0 });
+	return r;
+}
+
+static Limbs msg_to_scalar(const std::vector<uint8_t>& msg)
+{
+	Limbs e;
+	limbs_from_short_bytes(msg.data(), std::min<size_t>(msg.size(), 32), e);
+	if (compare(e, N) >= 0)
+		sub_limbs(e, e, N);
+	return e;
+}
+
+static bool parse_priv_key(const std::vector<uint8_t>& priv_key, Limbs& out)
+{
+	if (!limbs_from_short_bytes(priv_key.data(), priv_key.size(), out))
+		return false;
+
+	return !is_zero(out) && compare(out, N) < 0;
+}
+
+// Point arithmetic on y^2 = x^3 + 7 in Jacobian coordinates (x = X / Z^2, y = Y / Z^3)
+
+static JacobianPoint to_jacobian(const AffinePoint& a)
+{
+	return { a.x, a.y, ONE, false };
+}
+
+static bool to_affine(const JacobianPoint& a, AffinePoint& out)
+{
+	if (a.infinity)
+		return false;
+
+	const auto z_inv = fe_inv(a.z);
+	const auto z_inv2 = fe_sqr(z_inv);
+	out.x = fe_mul(a.x, z_inv2);
+	out.y = fe_mul(a.y, fe_mul(z_inv2, z_inv));
+	return true;
+}
+
+static JacobianPoint point_double(const JacobianPoint& a)
+{
+	if (a.infinity || is_zero(a.y))
+		return {};
+
+	const auto xx = fe_sqr(a.x);
+	const auto yy = fe_sqr(a.y);
+	const auto yyyy = fe_sqr(yy);
+
+	auto d = fe_sub(fe_sub(fe_sqr(fe_add(a.x, yy)), xx), yyyy);
+	d = fe_add(d, d);
+	const auto e = fe_add(fe_add(xx, xx), xx);
+
+	auto yyyy8 = fe_add(yyyy, yyyy);
+	yyyy8 = fe_add(yyyy8, yyyy8);
+	yyyy8 = fe_add(yyyy8, yyyy8);
+
+	JacobianPoint r;
+	r.infinity = false;
+	r.x = fe_sub(fe_sqr(e), fe_add(d, d));
+	r.y = fe_sub(fe_mul(e, fe_sub(d, r.x)), yyyy8);
+	const auto yz = fe_mul(a.y, a.z);
+	r.z = fe_add(yz, yz);
+	return r;
+}
+
+static JacobianPoint finish_add(const JacobianPoint& a, const Limbs& u1, const Limbs& u2, const Limbs& s1,
+	const Limbs& s2, const Limbs& z1z2)
+{
+	const auto h = fe_sub(u2, u1);
+	const auto r = fe_sub(s2, s1);
+	if (is_zero(h))
+		return is_zero(r) ? point_double(a) : JacobianPoint{};
+
+	const auto hh = fe_sqr(h);
+	const auto hhh = fe_mul(h, hh);
+	const auto v = fe_mul(u1, hh);
+
+	JacobianPoint out;
+	out.infinity = false;
+	out.x = fe_sub(fe_sub(fe_sqr(r), hhh), fe_add(v, v));
+	out.y = fe_sub(fe_mul(r, fe_sub(v, out.x)), fe_mul(s1, hhh));
+	out.z = fe_mul(z1z2, h);
+	return out;
+}
+
+static JacobianPoint point_add(const JacobianPoint& a, const JacobianPoint& b)
+{
+	if (a.infinity)
+		return b;
+	if (b.infinity)
+		return a;
+
+	const auto z1z1 = fe_sqr(a.z);
+	const auto z2z2 = fe_sqr(b.z);
+	const auto u1 = fe_mul(a.x, z2z2);
+	const auto u2 = fe_mul(b.x, z1z1);
+	const auto s1 = fe_mul(a.y, fe_mul(b.z, z2z2));
+	const auto s2 = fe_mul(b.y, fe_mul(a.z, z1z1));
+
+	return finish_add(a, u1, u2, s1, s2, fe_mul(a.z, b.z));
+}
+
+static JacobianPoint point_add_affine(const JacobianPoint& a, const AffinePoint& b)
+{
+	if (a.infinity)
+		return to_jacobian(b);
+
+	const auto z1z1 = fe_sqr(a.z);
+	const auto u2 = fe_mul(b.x, z1z1);
+	const auto s2 = fe_mul(b.y, fe_mul(a.z, z1z1));
+
+	return finish_add(a, a.x, u2, a.y, s2, a.z);
+}
+
+static std::unique_ptr<GeneratorTable> build_generator_table()
+{
+	std::vector<JacobianPoint> points(GEN_WINDOWS * GEN_WINDOW_SIZE);
+	auto base = to_jacobian(G);
+	for (size_t w = 0; w < GEN_WINDOWS; w++)
+	{
+		points[w * GEN_WINDOW_SIZE] = base;
+		for (size_t d = 1; d < GEN_WINDOW_SIZE; d++)
+			points[w * GEN_WINDOW_SIZE + d] = point_add(points[w * GEN_WINDOW_SIZE + d - 1], base);
+
+		for (size_t i = 0; i < GEN_WINDOW_BITS; i++)
+			base = point_double(base);
+	}
+
+	// Normalize every point with a single inversion (Montgomery's batch inversion trick)
+	std::vector<Limbs> prefix(points.size());
+	Limbs acc = ONE;
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		prefix[i] = acc;
+		acc = fe_mul(acc, points[i].z);
+	}
+
+	auto inv = fe_inv(acc);
+	auto table = std::make_unique<GeneratorTable>();
+	for (size_t i = points.size(); i-- > 0;)
+	{
+		const auto z_inv = fe_mul(inv, prefix[i]);
+		inv = fe_mul(inv, points[i].z);
+
+		const auto z_inv2 = fe_sqr(z_inv);
+		auto& entry = (*table)[i / GEN_WINDOW_SIZE][i % GEN_WINDOW_SIZE];
+		entry.x = fe_mul(points[i].x, z_inv2);
+		entry.y = fe_mul(points[i].y, fe_mul(z_inv2, z_inv));
+	}
+
+	return table;
+}
+
+static const GeneratorTable& get_generator_table()
+{
+	static const auto table = build_generator_table();
+	return *table;
+}
+
+static JacobianPoint mul_gen(const Limbs& k)
+{
+	const auto& table = get_generator_table();
+
+	JacobianPoint r;
+	for (size_t w = 0; w < GEN_WINDOWS; w++)
+	{
+		const auto bit = w * GEN_WINDOW_BITS;
+		const auto digit = (k[bit / 64] >> (bit % 64)) & GEN_WINDOW_SIZE;
+		if (digit != 0)
+			r = point_add_affine(r, table[w][digit - 1]);
+	}
+	return r;
+}
+
+// Splits k into k1 + k2 * lambda (mod n) with k1 and k2 of roughly 128 bits each (possibly negated)
+static void split_lambda(const Limbs& k, Limbs& k1, Limbs& k2)
+{
+	const auto c1 = sc_mul(sc_mul_shift_384(k, G1), MINUS_B1);
+	const auto c2 = sc_mul(sc_mul_shift_384(k, G2), MINUS_B2);
+	k2 = sc_add(c1, c2);
+	k1 = sc_add(sc_mul(k2, MINUS_LAMBDA), k);
+}
+
+// Width-5 non-adjacent form; k must be well below 2^255 so intermediate additions cannot overflow
+static size_t to_wnaf(Limbs k, std::array<int, 257>& wnaf)
+{
+	wnaf.fill(0);
+
+	size_t len = 0;
+	while (!is_zero(k))
+	{
+		if (k[0] & 1)
+		{
+			constexpr uint64_t WINDOW_MASK = (1 << WNAF_WINDOW_BITS) - 1;
+			auto digit = static_cast<int>(k[0] & WINDOW_MASK);
+			if (digit >= 1 << (WNAF_WINDOW_BITS - 1))
+				digit -= 1 << WNAF_WINDOW_BITS;
+
+			if (digit > 0)
+				sub_limbs(k, k, { static_cast<uint64_t>(digit), 0, 0, 0 });
+			else
+				add_limbs(k, k, { static_cast<uint64_t>(-digit), 0, 0, 0 });
+			wnaf[len] = digit;
+		}
+
+		for (size_t i = 0; i < 3; i++)
+			k[i] = (k[i] >> 1) | (k[i + 1] << 63);
+		k[3] >>= 1;
+		len++;
+	}
+	return len;
+}
+
+static void add_wnaf_digit(JacobianPoint& r, const WnafTable& table, int digit)
+{
+	if (digit > 0)
+	{
+		r = point_add(r, table[digit / 2]);
+	}
+	else if (digit < 0)
+	{
+		auto point = table[-digit / 2];
+		point.y = fe_neg(point.y);
+		r = point_add(r, point);
+	}
+}
+
+// Computes na * a + ng * G, using the endomorphism for a and the precomputed table for G
+static JacobianPoint ecmult(const AffinePoint& a, const Limbs& na, const Limbs& ng)
+{
+	Limbs k1, k2;
+	split_lambda(na, k1, k2);
+	const bool negate_k1 = compare(k1, N_HALF) > 0;
+	const bool negate_k2 = compare(k2, N_HALF) > 0;
+	if (negate_k1)
+		k1 = sc_neg(k1);
+	if (negate_k2)
+		k2 = sc_neg(k2);
+
+	WnafTable table;
+	WnafTable table_lambda;
+	table[0] = to_jacobian(a);
+	const auto twice = point_double(table[0]);
+	for (size_t i = 1; i < WNAF_TABLE_SIZE; i++)
+		table[i] = point_add(table[i - 1], twice);
+
+	for (size_t i = 0; i < WNAF_TABLE_SIZE; i++)
+	{
+		table_lambda[i] = table[i];
+		table_lambda[i].x = fe_mul(table[i].x, BETA);
+		if (negate_k1)
+			table[i].y = fe_neg(table[i].y);
+		if (negate_k2)
+			table_lambda[i].y = fe_neg(table_lambda[i].y);
+	}
+
+	std::array<int, 257> wnaf1;
+	std::array<int, 257> wnaf2;
+	const auto len = std::max(to_wnaf(k1, wnaf1), to_wnaf(k2, wnaf2));
+
+	JacobianPoint r;
+	for (size_t i = len; i-- > 0;)
+	{
+		r = point_double(r);
+		add_wnaf_digit(r, table, wnaf1[i]);
+		add_wnaf_digit(r, table_lambda, wnaf2[i]);
+	}
+
+	return point_add(r, mul_gen(ng));
+}
+
+static bool parse_pub_key(const std::vector<uint8_t>& pub_key, AffinePoint& out)
+{
+	if (pub_key.size() == 33 && (pub_key[0] == 0x02 || pub_key[0] == 0x03))
+	{
+		const auto x = limbs_from_bytes(pub_key.data() + 1);
+		if (compare(x, P) >= 0)
+			return false;
+
+		const auto rhs = fe_add(fe_mul(fe_sqr(x), x), SEVEN);
+		auto y = fe_pow(rhs, P_PLUS_1_DIV_4);
+		if (fe_sqr(y) != rhs)
+			return false;
+		if ((y[0] & 1) != (pub_key[0] & 1))
+			y = fe_neg(y);
+
+		out = { x, y };
+		return true;
+	}
+
+	// Hybrid 0x06/0x07 keys are uncompressed ones whose prefix also carries the parity of y. OpenSSL
+	// accepts them, so rejecting them here would split verification between the engines.
+	if (pub_key.size() == 65 && (pub_key[0] == 0x04 || pub_key[0] == 0x06 || pub_key[0] == 0x07))
+	{
+		const auto x = limbs_from_bytes(pub_key.data() + 1);
+		const auto y = limbs_from_bytes(pub_key.data() + 33);
+		if (compare(x, P) >= 0 || compare(y, P) >= 0)
+			return false;
+		if (pub_key[0] != 0x04 && (y[0] & 1) != (pub_key[0] & 1))
+			return false;
+		if (fe_sqr(y) != fe_add(fe_mul(fe_sqr(x), x), SEVEN))
+			return false;
+
+		out = { x, y };
+		return true;
+	}
+
+	return false;
+}
+
+static bool parse_der_int(const std::vector<uint8_t>& sig, size_t& pos, Limbs& out)
+{
+	if (pos + 2 > sig.size() || sig[pos] != 0x02)
+		return false;
+
+	const size_t len = sig[pos + 1];
+	pos += 2;
+	if (len == 0 || pos + len > sig.size())
+		return false;
+
+	const uint8_t* bytes = sig.data() + pos;
+	if (bytes[0] & 0x80)
+		return false;
+	if (len > 1 && bytes[0] == 0x00 && !(bytes[1] & 0x80))
+		return false;
+
+	const size_t skip = bytes[0] == 0x00 ? 1 : 0;
+	if (!limbs_from_short_bytes(bytes + skip, len - skip, out))
+		return false;
+
+	pos += len;
+	return true;
+}
+
+// Strict DER, matching what OpenSSL accepts: no excess padding, no negative values, no trailing data
+static bool parse_der_sig(const std::vector<uint8_t>& sig, Limbs& r, Limbs& s)
+{
+	if (sig.size() < 8 || sig.size() > 72 || sig[0] != 0x30 || sig[1] != sig.size() - 2)
+		return false;
+
+	size_t pos = 2;
+	return parse_der_int(sig, pos, r) && parse_der_int(sig, pos, s) && pos == sig.size();
+}
+
+static void append_der_int(std::vector<uint8_t>& out, const Limbs& value)
+{
+	uint8_t bytes[33] = {};
+	limbs_to_bytes(value, bytes + 1);
+
+	size_t start = 1;
+	while (start < 32 && bytes[start] == 0x00)
+		start++;
+	if (bytes[start] & 0x80)
+		start--;
+
+	out.push_back(0x02);
+	out.push_back(static_cast<uint8_t>(sizeof(bytes) - start));
+	out.insert(out.end(), bytes + start, bytes + sizeof(bytes));
+}
+
+static SHA256::Hash hmac_sha256(const SHA256::Hash& key, std::span<const uint8_t> data,
+	std::span<const uint8_t> suffix = {})
+{
+	constexpr size_t BLOCK_SIZE = 64;
+
+	std::array<uint8_t, BLOCK_SIZE> inner_pad;
+	std::array<uint8_t, BLOCK_SIZE> outer_pad;
+	inner_pad.fill(0x36);
+	outer_pad.fill(0x5c);
+	for (size_t i = 0; i < key.size(); i++)
+	{
+		inner_pad[i] ^= key[i];
+		outer_pad[i] ^= key[i];
+	}
+
+	const auto inner_hash = SHA256::Hasher().update(inner_pad).update(data).update(suffix).finalize();
+
+	return SHA256::Hasher().update(outer_pad).update(inner_hash).finalize();
+}
+
+namespace
+{
+	// RFC 6979 section 3.2 nonce derivation with HMAC-SHA256
+	class NonceGenerator
+	{
+	public:
+		NonceGenerator(const Limbs& priv_key, const Limbs& msg)
+		{
+			k.fill(0x00);
+			v.fill(0x01);
+
+			std::array<uint8_t, 64> seed;
+			limbs_to_bytes(priv_key, seed.data());
+			limbs_to_bytes(msg, seed.data() + 32);
+
+			reseed(0x00, seed);
+			reseed(0x01, seed);
+		}
+
+		Limbs next()
+		{
+			while (true)
+			{
+				if (retry)
+					reseed(0x00, {});
+				retry = true;
+
+				v = hmac_sha256(k, v);
+				const auto candidate = limbs_from_bytes(v.data());
+				if (!is_zero(candidate) && compare(candidate, N) < 0)
+					return candidate;
+			}
+		}
+
+	private:
+		SHA256::Hash k;
+		SHA256::Hash v;
+		bool retry = false;
+
+		void reseed(uint8_t tag, std::span<const uint8_t> seed)
+		{
+			std::array<uint8_t, SHA256::HASH_SIZE + 1> data;
+			std::copy(v.begin(), v.end(), data.begin());
+			data.back() = tag;
+
+			k = hmac_sha256(k, data, seed);
+			v = hmac_sha256(k, v);
+		}
+	};
+}
+
+std::vector<uint8_t> Secp256k1::get_pub_key(const std::vector<uint8_t>& priv_key)
+{
+	Limbs d;
+	if (!parse_priv_key(priv_key, d))
+		return {};
+
+	AffinePoint point;
+	if (!to_affine(mul_gen(d), point))
+		return {};
+
+	std::vector<uint8_t> pub_key(33);
+	pub_key[0] = static_cast<uint8_t>(0x02 | (point.y[0] & 1));
+	limbs_to_bytes(point.x, pub_key.data() + 1);
+
+	return pub_key;
+}
+
+std::vector<uint8_t> Secp256k1::sign(const std::vector<uint8_t>& msg, const std::vector<uint8_t>& priv_key)
+{
+	Limbs d;
+	if (!parse_priv_key(priv_key, d))
+		return {};
+
+	const auto e = msg_to_scalar(msg);
+	NonceGenerator nonces(d, e);
+	while (true)
+	{
+		const auto k = nonces.next();
+
+		AffinePoint point;
+		if (!to_affine(mul_gen(k), point))
+			continue;
+
+		auto r = point.x;
+		if (compare(r, N) >= 0)
+			sub_limbs(r, r, N);
+		if (is_zero(r))
+			continue;
+
+		auto s = sc_mul(sc_inv(k), sc_add(e, sc_mul(r, d)));
+		if (is_zero(s))
+			continue;
+		if (compare(s, N_HALF) > 0)
+			s = sc_neg(s);
+
+		std::vector<uint8_t> sig{ 0x30, 0x00 };
+		append_der_int(sig, r);
+		append_der_int(sig, s);
+		sig[1] = static_cast<uint8_t>(sig.size() - 2);
+
+		return sig;
+	}
+}
+
+bool Secp256k1::verify(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& msg,
+	const std::vector<uint8_t>& pub_key)
+{
+	Limbs r, s;
+	if (!parse_der_sig(sig, r, s))
+		return false;
+	if (is_zero(r) || is_zero(s) || compare(r, N) >= 0 || compare(s, N) >= 0)
+		return false;
+
+	AffinePoint q;
+	if (!parse_pub_key(pub_key, q))
+		return false;
+
+	const auto w = sc_inv(s);
+	const auto u1 = sc_mul(msg_to_scalar(msg), w);
+	const auto u2 = sc_mul(r, w);
+
+	const auto point = ecmult(q, u2, u1);
+	if (point.infinity)
+		return false;
+
+	// Compare x = X / Z^2 against r (or r + n) without leaving Jacobian coordinates
+	const auto zz = fe_sqr(point.z);
+	if (fe_mul(r, zz) == point.x)
+		return true;
+
+	Limbs r_plus_n;
+	if (add_limbs(r_plus_n, r, N) || compare(r_plus_n, P) >= 0)
+		return false;
+
+	return fe_mul(r_plus_n, zz) == point.x;
+}
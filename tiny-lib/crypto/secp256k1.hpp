@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// In-tree secp256k1 engine used by ECDSA to verify when built with TINY_COIN_NATIVE_SECP256K1.
+// Keys and signatures use the same encodings as the OpenSSL path: 33-byte compressed
+// public keys (65-byte uncompressed and hybrid keys are accepted for verification) and DER signatures.
+// Nothing here is constant time, so get_pub_key and sign leak the secret through timing.
+class Secp256k1
+{
+public:
+	static std::vector<uint8_t> get_pub_key(const std::vector<uint8_t>& priv_key);
+
+	// Signs with an RFC 6979 deterministic nonce and always produces a low-S signature
+	static std::vector<uint8_t> sign(const std::vector<uint8_t>& msg, const std::vector<uint8_t>& priv_key);
+	static bool verify(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& msg,
+		const std::vector<uint8_t>& pub_key);
+};
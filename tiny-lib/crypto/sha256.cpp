@@ -1,51 +1,57 @@
 #include "crypto/sha256.hpp"
 
-#include <memory>
+EVP_MD* SHA256::md = nullptr;
 
-#include <openssl/sha.h>
+// Static initializers such as the genesis block index hash before Crypto::init has fetched md
+SHA256::Hasher::Hasher()
+	: digest(md != nullptr ? md : EVP_sha256())
+{}
 
-EVP_MD* SHA256::md = nullptr;
+SHA256::Hasher& SHA256::Hasher::update(std::span<const uint8_t> data)
+{
+	digest.update(data);
 
-std::vector<uint8_t> SHA256::hash_binary(const std::vector<uint8_t>& buffer)
+	return *this;
+}
+
+SHA256::Hash SHA256::Hasher::finalize()
 {
-	std::vector<uint8_t> hash(SHA256_DIGEST_LENGTH);
-
-	std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> md_ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-	if (!md_ctx)
-		return {};
-	if (!EVP_DigestInit_ex(md_ctx.get(), md, nullptr))
-		return {};
-	if (!EVP_DigestUpdate(md_ctx.get(), buffer.data(), buffer.size()))
-		return {};
-	unsigned int md_len = 0;
-	if (!EVP_DigestFinal_ex(md_ctx.get(), hash.data(), &md_len))
-		return {};
+	Hash hash;
+	digest.finalize(hash.data());
 
 	return hash;
 }
 
-std::vector<uint8_t> SHA256::double_hash_binary(const std::vector<uint8_t>& buffer)
+SHA256::Hash SHA256::Hasher::finalize_double()
 {
-	std::vector<uint8_t> hash(SHA256_DIGEST_LENGTH);
-
-	std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> md_ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
-	if (!md_ctx)
-		return {};
-
-	if (!EVP_DigestInit_ex(md_ctx.get(), md, nullptr))
-		return {};
-	if (!EVP_DigestUpdate(md_ctx.get(), buffer.data(), buffer.size()))
-		return {};
-	unsigned int md_len = 0;
-	if (!EVP_DigestFinal_ex(md_ctx.get(), hash.data(), &md_len))
-		return {};
-
-	if (!EVP_DigestInit_ex(md_ctx.get(), md, nullptr))
-		return {};
-	if (!EVP_DigestUpdate(md_ctx.get(), hash.data(), md_len))
-		return {};
-	if (!EVP_DigestFinal_ex(md_ctx.get(), hash.data(), &md_len))
-		return {};
+	Hash hash;
+	digest.finalize(hash.data());
+	digest.update(hash);
+	digest.finalize(hash.data());
 
 	return hash;
 }
+
+SHA256::Hash SHA256::hash(std::span<const uint8_t> data)
+{
+	return Hasher().update(data).finalize();
+}
+
+SHA256::Hash SHA256::double_hash(std::span<const uint8_t> data)
+{
+	return Hasher().update(data).finalize_double();
+}
+
+std::vector<uint8_t> SHA256::hash_binary(const std::vector<uint8_t>& buffer)
+{
+	const auto hash = SHA256::hash(buffer);
+
+	return { hash.begin(), hash.end() };
+}
+
+std::vector<uint8_t> SHA256::double_hash_binary(const std::vector<uint8_t>& buffer)
+{
+	const auto hash = double_hash(buffer);
+
+	return { hash.begin(), hash.end() };
+}
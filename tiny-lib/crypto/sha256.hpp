@@ -1,14 +1,38 @@
 #pragma once
+#include <array>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 #include <openssl/evp.h>
 
+#include "crypto/digest_hasher.hpp"
+
 class SHA256
 {
 	friend class Crypto;
 
 public:
+	static constexpr size_t HASH_SIZE = 32;
+	using Hash = std::array<uint8_t, HASH_SIZE>;
+
+	class Hasher
+	{
+	public:
+		Hasher();
+
+		Hasher& update(std::span<const uint8_t> data);
+		Hash finalize();
+		// SHA256(SHA256(data)), as used for block, tx and message ids
+		Hash finalize_double();
+
+	private:
+		DigestHasher digest;
+	};
+
+	static Hash hash(std::span<const uint8_t> data);
+	static Hash double_hash(std::span<const uint8_t> data);
+
 	static std::vector<uint8_t> hash_binary(const std::vector<uint8_t>& buffer);
 	static std::vector<uint8_t> double_hash_binary(const std::vector<uint8_t>& buffer);
 
@@ -9,13 +9,11 @@ std::mutex SigCache::mutex_;
 std::string SigCache::make_key(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& msg,
     const std::vector<uint8_t>& pub_key)
 {
-    std::vector<uint8_t> preimage;
-    preimage.reserve(sig.size() + msg.size() + pub_key.size());
-    preimage.insert(preimage.end(), sig.begin(), sig.end());
-    preimage.insert(preimage.end(), msg.begin(), msg.end());
-    preimage.insert(preimage.end(), pub_key.begin(), pub_key.end());
-
-    return Utils::byte_array_to_hex_string(SHA256::hash_binary(preimage));
+    return Utils::byte_array_to_hex_string(SHA256::Hasher()
+        .update(sig)
+        .update(msg)
+        .update(pub_key)
+        .finalize());
 }
 
 bool SigCache::contains(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& msg,
@@ -54,6 +54,7 @@ void CpuMiningBackend::mine_chunk(const std::vector<uint8_t>& prefix_bytes_in,
     const uint32_t nonce_offset = static_cast<uint32_t>(prefix_bytes.size());
     prefix_bytes.resize(nonce_offset + sizeof(uint64_t));
 
+    SHA256::Hasher hasher;
     uint64_t i = 0;
     uint64_t local_hash_count = 0;
     while (true)
@@ -67,7 +68,7 @@ void CpuMiningBackend::mine_chunk(const std::vector<uint8_t>& prefix_bytes_in,
             std::memcpy(prefix_bytes.data() + nonce_offset, &current_nonce, sizeof(uint64_t));
         }
 
-        const auto hash = SHA256::double_hash_binary(prefix_bytes);
+        const auto hash = hasher.update(prefix_bytes).finalize_double();
 
         bool valid = false;
         for (size_t b = 0; b < 32; b++)
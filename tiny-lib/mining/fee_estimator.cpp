@@ -1,21 +1,45 @@
 #include "mining/fee_estimator.hpp"
 
 #include <algorithm>
-#include <ranges>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <optional>
 
 #include "core/mempool.hpp"
-#include "core/unspent_tx_out.hpp"
-#include "mining/pow.hpp"
+#include "mining/fee_rate_histogram.hpp"
 #include "util/log.hpp"
 
 std::recursive_mutex FeeEstimator::mutex;
 std::deque<FeeEstimator::BlockFeeData> FeeEstimator::block_fee_history;
 
-void FeeEstimator::record_block(const std::shared_ptr<Block>& block)
+std::vector<FeeEstimator::BucketStats> FeeEstimator::buckets;
+
+std::unordered_map<std::string, FeeEstimator::TrackedTx> FeeEstimator::tracked_txs;
+uint32_t FeeEstimator::blocks_recorded = 0;
+
+void FeeEstimator::track_tx(const std::string& tx_id, uint64_t fee_rate)
+{
+    std::scoped_lock lock(mutex);
+
+    init_buckets();
+
+    tracked_txs[tx_id] = TrackedTx{ FeeRateHistogram::find_bucket(fee_rate), fee_rate, blocks_recorded };
+}
+
+void FeeEstimator::untrack_tx(const std::string& tx_id)
 {
     std::scoped_lock lock(mutex);
 
-    const auto block_id = block->id();
+    tracked_txs.erase(tx_id);
+}
+
+void FeeEstimator::record_block(const std::string& block_id,
+    const std::vector<std::pair<std::string, uint64_t>>& tx_fee_rates)
+{
+    std::scoped_lock lock(mutex);
+
+    init_buckets();
 
     for (const auto& existing : block_fee_history)
     {
@@ -23,31 +47,56 @@ void FeeEstimator::record_block(const std::shared_ptr<Block>& block)
             return;
     }
 
+    blocks_recorded++;
+
+    scale_buckets(DECAY);
+
     BlockFeeData data;
     data.block_id = block_id;
 
-    for (const auto& tx : block->txs)
+    for (const auto& [tx_id, fee_rate] : tx_fee_rates)
     {
-        if (tx->is_coinbase())
+        const auto tracked_it = tracked_txs.find(tx_id);
+        if (tracked_it != tracked_txs.end())
+        {
+            data.confirmations.push_back({ tracked_it->second.bucket, tracked_it->second.fee_rate,
+                std::max(blocks_recorded - tracked_it->second.entry_block, 1u) });
+            tracked_txs.erase(tracked_it);
+
             continue;
+        }
 
-        const uint64_t fee = PoW::calculate_fees(tx);
-        const uint32_t tx_size = tx->serialize().get_size();
-        if (tx_size == 0)
+        // Never seen in our mempool, so counted as confirming in the first block. Txs paying no fee
+        // say nothing about the market.
+        if (fee_rate == 0)
             continue;
 
-        const uint64_t fee_rate = fee / tx_size;
-        data.fee_rates.push_back(fee_rate);
+        data.confirmations.push_back({ FeeRateHistogram::find_bucket(fee_rate), fee_rate, 1 });
+    }
+
+    for (const auto& confirmation : data.confirmations)
+        add_confirmation(confirmation, 1.0);
+
+    for (auto it = tracked_txs.begin(); it != tracked_txs.end();)
+    {
+        if (blocks_recorded - it->second.entry_block > MAX_CONFIRM_BLOCKS)
+        {
+            buckets[it->second.bucket].failed_count += 1.0;
+            data.expired.emplace_back(it->first, it->second);
+            it = tracked_txs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
     }
 
-    std::ranges::sort(data.fee_rates);
+    LOG_TRACE("Fee estimator recorded block {} with {} confirmations", block_id, data.confirmations.size());
 
     block_fee_history.push_back(std::move(data));
 
     while (block_fee_history.size() > MAX_HISTORY_BLOCKS)
         block_fee_history.pop_front();
-
-    LOG_TRACE("Fee estimator recorded block {} with {} transactions", block_id, data.fee_rates.size());
 }
 
 void FeeEstimator::unrecord_block(const std::string& block_id)
@@ -56,14 +105,35 @@ void FeeEstimator::unrecord_block(const std::string& block_id)
 
     for (auto it = block_fee_history.begin(); it != block_fee_history.end(); ++it)
     {
-        if (it->block_id == block_id)
+        if (it->block_id != block_id)
+            continue;
+
+        if (std::next(it) == block_fee_history.end())
+        {
+            // Reverses record_block step by step
+            for (const auto& [tx_id, tracked] : it->expired)
+            {
+                buckets[tracked.bucket].failed_count -= 1.0;
+                tracked_txs.emplace(tx_id, tracked);
+            }
+            for (const auto& confirmation : it->confirmations)
+                add_confirmation(confirmation, -1.0);
+            scale_buckets(1.0 / DECAY);
+            blocks_recorded--;
+        }
+        else
         {
-            block_fee_history.erase(it);
+            // Each later block decayed the block's confirmations once more
+            const double weight = std::pow(DECAY, static_cast<double>(std::distance(it, block_fee_history.end()) - 1));
+            for (const auto& confirmation : it->confirmations)
+                add_confirmation(confirmation, -weight);
+        }
 
-            LOG_TRACE("Fee estimator removed block {}", block_id);
+        block_fee_history.erase(it);
 
-            return;
-        }
+        LOG_TRACE("Fee estimator removed block {}", block_id);
+
+        return;
     }
 }
 
@@ -71,75 +141,57 @@ uint64_t FeeEstimator::estimate_fee_rate(uint32_t target_blocks)
 {
     std::scoped_lock lock(mutex);
 
-    std::vector<uint64_t> all_rates;
-    for (const auto& block_data : block_fee_history)
-    {
-        all_rates.insert(all_rates.end(), block_data.fee_rates.begin(), block_data.fee_rates.end());
-    }
+    init_buckets();
 
-    const auto mempool_rates = collect_mempool_fee_rates();
+    const size_t target_idx = std::clamp(target_blocks, 1u, MAX_CONFIRM_BLOCKS) - 1;
 
-    if (all_rates.empty() && mempool_rates.empty())
+    // Buckets are grouped from the highest fee rate down until a group holds enough txs. The
+    // estimate is the average fee rate of the lowest group whose txs mostly confirmed in time.
+    double group_count = 0;
+    double group_fee_rate_sum = 0;
+    double group_confirmed = 0;
+    double group_failed = 0;
+    std::optional<uint64_t> estimate;
+    for (size_t i = buckets.size(); i-- > 0;)
     {
-        LOG_TRACE("No fee data available, returning default fee rate {}", DEFAULT_FEE_RATE);
+        const auto& bucket = buckets[i];
+        group_count += bucket.tx_count;
+        group_fee_rate_sum += bucket.fee_rate_sum;
+        group_confirmed += bucket.confirmed_within[target_idx];
+        group_failed += bucket.failed_count;
 
-        return DEFAULT_FEE_RATE;
-    }
+        if (group_count + group_failed < SUFFICIENT_TXS)
+            continue;
 
-    std::ranges::sort(all_rates);
+        if (group_confirmed / (group_count + group_failed) < SUCCESS_THRESHOLD)
+            break;
 
-    uint64_t block_estimate = DEFAULT_FEE_RATE;
-    if (!all_rates.empty())
-    {
-        double p;
-        if (target_blocks <= 1)
-            p = 0.85;
-        else if (target_blocks <= 3)
-            p = 0.60;
-        else if (target_blocks <= 6)
-            p = 0.35;
-        else
-            p = 0.10;
+        if (group_count >= SUFFICIENT_TXS)
+            estimate = static_cast<uint64_t>(group_fee_rate_sum / group_count);
 
-        block_estimate = percentile(all_rates, p);
+        group_count = 0;
+        group_fee_rate_sum = 0;
+        group_confirmed = 0;
+        group_failed = 0;
     }
 
-    uint64_t mempool_estimate = 0;
-    if (!mempool_rates.empty())
+    if (!estimate)
     {
-        double mempool_percentile;
-        if (target_blocks <= 1)
-            mempool_percentile = 0.90;
-        else if (target_blocks <= 3)
-            mempool_percentile = 0.50;
-        else
-            mempool_percentile = 0.25;
+        LOG_TRACE("No fee data available, returning default fee rate {}", DEFAULT_FEE_RATE);
 
-        auto sorted_mempool = mempool_rates;
-        std::ranges::sort(sorted_mempool);
-        mempool_estimate = percentile(sorted_mempool, mempool_percentile);
+        return DEFAULT_FEE_RATE;
     }
 
-    uint64_t estimate = std::max(block_estimate, mempool_estimate);
-    estimate = std::max(estimate, MIN_RELAY_FEE_RATE);
+    const uint64_t result = std::max(*estimate, MIN_RELAY_FEE_RATE);
 
-    LOG_TRACE("Fee estimate for {} block target: {} coins/byte (block={}, mempool={})",
-        target_blocks, estimate, block_estimate, mempool_estimate);
+    LOG_TRACE("Fee estimate for {} block target: {} coins/byte", target_blocks, result);
 
-    return estimate;
+    return result;
 }
 
 uint64_t FeeEstimator::get_mempool_fee_rate_percentile(double p)
 {
-    std::scoped_lock lock(mutex);
-
-    auto rates = collect_mempool_fee_rates();
-    if (rates.empty())
-        return DEFAULT_FEE_RATE;
-
-    std::ranges::sort(rates);
-
-    return percentile(rates, p);
+    return Mempool::fee_histogram.get_percentile(p).value_or(DEFAULT_FEE_RATE);
 }
 
 void FeeEstimator::reset()
@@ -147,44 +199,34 @@ void FeeEstimator::reset()
     std::scoped_lock lock(mutex);
 
     block_fee_history.clear();
+    buckets.assign(FeeRateHistogram::get_bucket_bounds().size(), BucketStats());
+    tracked_txs.clear();
+    blocks_recorded = 0;
 }
 
-uint64_t FeeEstimator::percentile(const std::vector<uint64_t>& sorted_rates, double p)
+void FeeEstimator::init_buckets()
 {
-    if (sorted_rates.empty())
-        return 0;
-
-    if (sorted_rates.size() == 1)
-        return sorted_rates[0];
-
-    const double index = p * static_cast<double>(sorted_rates.size() - 1);
-    const auto lower = static_cast<size_t>(index);
-    const auto upper = lower + 1;
-
-    if (upper >= sorted_rates.size())
-        return sorted_rates.back();
-
-    const double fraction = index - static_cast<double>(lower);
-
-    return static_cast<uint64_t>(
-        static_cast<double>(sorted_rates[lower]) * (1.0 - fraction) +
-        static_cast<double>(sorted_rates[upper]) * fraction);
+    if (buckets.empty())
+        buckets.resize(FeeRateHistogram::get_bucket_bounds().size());
 }
 
-std::vector<uint64_t> FeeEstimator::collect_mempool_fee_rates()
+void FeeEstimator::scale_buckets(double factor)
 {
-    std::scoped_lock lock(Mempool::mutex);
-
-    std::vector<uint64_t> rates;
-    rates.reserve(Mempool::map.size());
-
-    for (const auto& [tx_id, entry] : Mempool::map)
+    for (auto& bucket : buckets)
     {
-        if (entry.serialized_size == 0)
-            continue;
-
-        rates.push_back(entry.fee_rate);
+        bucket.tx_count *= factor;
+        bucket.fee_rate_sum *= factor;
+        bucket.failed_count *= factor;
+        for (auto& count : bucket.confirmed_within)
+            count *= factor;
     }
+}
 
-    return rates;
+void FeeEstimator::add_confirmation(const Confirmation& confirmation, double weight)
+{
+    auto& bucket = buckets[confirmation.bucket];
+    bucket.tx_count += weight;
+    bucket.fee_rate_sum += weight * static_cast<double>(confirmation.fee_rate);
+    for (uint32_t i = confirmation.blocks_waited - 1; i < MAX_CONFIRM_BLOCKS; i++)
+        bucket.confirmed_within[i] += weight;
 }
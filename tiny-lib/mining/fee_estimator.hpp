@@ -1,13 +1,16 @@
 #pragma once
+#include <array>
 #include <cstdint>
 #include <deque>
-#include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-#include "core/block.hpp"
-
+// Confirmation-based fee estimator. Fee rates are grouped into the FeeRateHistogram buckets and
+// for each bucket decaying averages track how many txs confirmed within 1..MAX_CONFIRM_BLOCKS
+// blocks of entering the mempool, so an estimate is a single pass over the buckets.
 class FeeEstimator
 {
 public:
@@ -15,26 +18,78 @@ public:
     static constexpr uint64_t DEFAULT_FEE_RATE = 100;
     static constexpr uint64_t MIN_RELAY_FEE_RATE = 1;
 
+    static constexpr uint32_t MAX_CONFIRM_BLOCKS = 25;
+    // Share of a bucket's txs that must have confirmed within the target for its fee rate to qualify
+    static constexpr double SUCCESS_THRESHOLD = 0.85;
+    // Weight left to a data point after each further block
+    static constexpr double DECAY = 0.998;
+    static constexpr double SUFFICIENT_TXS = 0.5;
+
     static std::recursive_mutex mutex;
 
-    static void record_block(const std::shared_ptr<Block>& block);
+    // Starts timing a tx that just entered the mempool
+    static void track_tx(const std::string& tx_id, uint64_t fee_rate);
+    // Stops timing a tx that left the mempool without confirming, so it doesn't count as a failure
+    static void untrack_tx(const std::string& tx_id);
+
+    // Takes the ids and fee rates of the block's non-coinbase txs. The fees have to be worked out
+    // while the txs' inputs are still in the UTXO set, so Chain::connect_block collects them.
+    static void record_block(const std::string& block_id,
+        const std::vector<std::pair<std::string, uint64_t>>& tx_fee_rates);
+    // Undoes record_block. For the most recent block that includes its decay, the txs it expired and
+    // the block count, so the estimator is back where it was. Older blocks only lose their confirmations.
     static void unrecord_block(const std::string& block_id);
 
     static uint64_t estimate_fee_rate(uint32_t target_blocks = 3);
 
+    // From the mempool's fee rate histogram, without taking the mempool lock
     static uint64_t get_mempool_fee_rate_percentile(double p);
 
     static void reset();
 
 private:
+    struct TrackedTx
+    {
+        size_t bucket = 0;
+        uint64_t fee_rate = 0;
+        uint32_t entry_block = 0;
+    };
+
+    struct Confirmation
+    {
+        size_t bucket = 0;
+        uint64_t fee_rate = 0;
+        uint32_t blocks_waited = 0;
+    };
+
+    // Kept so a disconnected block's confirmations can be taken out again
     struct BlockFeeData
     {
         std::string block_id;
-        std::vector<uint64_t> fee_rates;
+        std::vector<Confirmation> confirmations;
+        // Txs the block counted as failed, put back to tracking if it is the tip being disconnected
+        std::vector<std::pair<std::string, TrackedTx>> expired;
+    };
+
+    struct BucketStats
+    {
+        double tx_count = 0;
+        double fee_rate_sum = 0;
+        // Txs that left tracking without confirming within MAX_CONFIRM_BLOCKS
+        double failed_count = 0;
+        // [n] counts txs that confirmed within n + 1 blocks
+        std::array<double, MAX_CONFIRM_BLOCKS> confirmed_within{};
     };
 
     static std::deque<BlockFeeData> block_fee_history;
 
-    static uint64_t percentile(const std::vector<uint64_t>& sorted_rates, double p);
-    static std::vector<uint64_t> collect_mempool_fee_rates();
+    static std::vector<BucketStats> buckets;
+
+    static std::unordered_map<std::string, TrackedTx> tracked_txs;
+    static uint32_t blocks_recorded;
+
+    static void init_buckets();
+
+    static void add_confirmation(const Confirmation& confirmation, double weight);
+    static void scale_buckets(double factor);
 };
@@ -0,0 +1,155 @@
+#include "mining/fee_rate_histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+FeeRateHistogram::FeeRateHistogram()
+    : tree_(get_bucket_bounds().size() + 1, 0), counts_(get_bucket_bounds().size(), 0),
+    fee_rate_sums_(get_bucket_bounds().size(), 0)
+{}
+
+FeeRateHistogram::FeeRateHistogram(const std::vector<Bucket>& buckets)
+    : FeeRateHistogram()
+{
+    if (!are_valid_buckets(buckets))
+        throw std::runtime_error("Invalid fee rate histogram buckets");
+
+    for (const auto& bucket : buckets)
+    {
+        update(bucket.idx, static_cast<int64_t>(bucket.tx_count));
+        fee_rate_sums_[bucket.idx] = bucket.fee_rate_sum;
+    }
+}
+
+bool FeeRateHistogram::are_valid_buckets(const std::vector<Bucket>& buckets)
+{
+    std::vector<bool> seen(get_bucket_bounds().size(), false);
+    // Counts go through update as signed deltas
+    uint64_t tx_count = 0;
+    for (const auto& bucket : buckets)
+    {
+        if (bucket.idx >= seen.size() || seen[bucket.idx])
+            return false;
+        seen[bucket.idx] = true;
+
+        if (bucket.tx_count == 0 ||
+            bucket.tx_count > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) - tx_count)
+            return false;
+        tx_count += bucket.tx_count;
+    }
+
+    return true;
+}
+
+const std::vector<uint64_t>& FeeRateHistogram::get_bucket_bounds()
+{
+    static const std::vector<uint64_t> bounds = []
+    {
+        std::vector<uint64_t> result;
+        for (double bound = static_cast<double>(MIN_BUCKET_FEE_RATE); bound < static_cast<double>(MAX_BUCKET_FEE_RATE);
+            bound *= BUCKET_SPACING)
+        {
+            const auto rounded = static_cast<uint64_t>(bound);
+            if (result.empty() || rounded > result.back())
+                result.push_back(rounded);
+        }
+        result.push_back(std::numeric_limits<uint64_t>::max());
+
+        return result;
+    }();
+
+    return bounds;
+}
+
+size_t FeeRateHistogram::find_bucket(uint64_t fee_rate)
+{
+    const auto& bounds = get_bucket_bounds();
+
+    return static_cast<size_t>(std::ranges::lower_bound(bounds, fee_rate) - bounds.begin());
+}
+
+void FeeRateHistogram::add(uint64_t fee_rate)
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto bucket = find_bucket(fee_rate);
+    update(bucket, 1);
+    fee_rate_sums_[bucket] += fee_rate;
+}
+
+void FeeRateHistogram::remove(uint64_t fee_rate)
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto bucket = find_bucket(fee_rate);
+    if (counts_[bucket] == 0)
+        return;
+
+    update(bucket, -1);
+    fee_rate_sums_[bucket] -= std::min(fee_rate, fee_rate_sums_[bucket]);
+}
+
+void FeeRateHistogram::clear()
+{
+    std::scoped_lock lock(mutex_);
+
+    std::ranges::fill(tree_, 0);
+    std::ranges::fill(counts_, 0);
+    std::ranges::fill(fee_rate_sums_, 0);
+    tx_count_ = 0;
+}
+
+uint64_t FeeRateHistogram::get_tx_count() const
+{
+    std::scoped_lock lock(mutex_);
+
+    return tx_count_;
+}
+
+std::optional<uint64_t> FeeRateHistogram::get_percentile(double p) const
+{
+    std::scoped_lock lock(mutex_);
+
+    if (tx_count_ == 0)
+        return std::nullopt;
+
+    // 1-based rank of the wanted tx, then the first bucket whose prefix count reaches it
+    const auto rank = static_cast<uint64_t>(std::clamp(p, 0.0, 1.0) * static_cast<double>(tx_count_ - 1)) + 1;
+
+    size_t pos = 0;
+    uint64_t remaining = rank;
+    for (size_t step = std::bit_floor(tree_.size() - 1); step > 0; step >>= 1)
+    {
+        if (pos + step < tree_.size() && tree_[pos + step] < remaining)
+        {
+            pos += step;
+            remaining -= tree_[pos];
+        }
+    }
+
+    return fee_rate_sums_[pos] / counts_[pos];
+}
+
+std::vector<FeeRateHistogram::Bucket> FeeRateHistogram::get_buckets() const
+{
+    std::scoped_lock lock(mutex_);
+
+    std::vector<Bucket> buckets;
+    for (size_t i = 0; i < counts_.size(); i++)
+    {
+        if (counts_[i] != 0)
+            buckets.push_back({ static_cast<uint32_t>(i), counts_[i], fee_rate_sums_[i] });
+    }
+
+    return buckets;
+}
+
+void FeeRateHistogram::update(size_t bucket, int64_t delta)
+{
+    counts_[bucket] += delta;
+    tx_count_ += delta;
+    for (size_t i = bucket + 1; i < tree_.size(); i += i & (~i + 1))
+        tree_[i] += delta;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Count of txs per exponentially spaced fee rate bucket, kept in a Fenwick tree so that adding,
+// removing and percentile queries are all O(log buckets). Guarded by its own mutex, so readers
+// never wait on the owner's lock.
+class FeeRateHistogram
+{
+public:
+    static constexpr double BUCKET_SPACING = 1.1;
+    static constexpr uint64_t MIN_BUCKET_FEE_RATE = 1;
+    static constexpr uint64_t MAX_BUCKET_FEE_RATE = 10000000;
+
+    struct Bucket
+    {
+        uint32_t idx = 0;
+        uint64_t tx_count = 0;
+        uint64_t fee_rate_sum = 0;
+    };
+
+    FeeRateHistogram();
+    // Throws std::runtime_error unless are_valid_buckets(buckets)
+    explicit FeeRateHistogram(const std::vector<Bucket>& buckets);
+
+    // Buckets as get_buckets returns them: indices in range and distinct, counts non-zero and
+    // summing to no more than a histogram can hold
+    static bool are_valid_buckets(const std::vector<Bucket>& buckets);
+
+    // Upper bound of every bucket, the last one open ended
+    static const std::vector<uint64_t>& get_bucket_bounds();
+    static size_t find_bucket(uint64_t fee_rate);
+
+    void add(uint64_t fee_rate);
+    void remove(uint64_t fee_rate);
+    void clear();
+
+    uint64_t get_tx_count() const;
+
+    // Average fee rate of the bucket holding the tx at share p of the way up, empty without txs
+    std::optional<uint64_t> get_percentile(double p) const;
+
+    // Non-empty buckets only
+    std::vector<Bucket> get_buckets() const;
+
+private:
+    mutable std::mutex mutex_;
+
+    std::vector<uint64_t> tree_;
+    std::vector<uint64_t> counts_;
+    std::vector<uint64_t> fee_rate_sums_;
+    uint64_t tx_count_ = 0;
+
+    void update(size_t bucket, int64_t delta);
+};
@@ -18,7 +18,7 @@ std::shared_ptr<MerkleNode> MerkleTree::get_root(const std::vector<std::string>&
 	for (const auto& l : leaves)
 	{
 		auto node = std::make_shared<MerkleNode>(
-			Utils::byte_array_to_hex_string(SHA256::double_hash_binary(Utils::string_to_byte_array(l))));
+			Utils::byte_array_to_hex_string(SHA256::double_hash(Utils::string_to_byte_array(l))));
 
 		nodes.push_back(node);
 	}
@@ -79,12 +79,10 @@ std::shared_ptr<MerkleNode> MerkleTree::find_root(const std::vector<std::shared_
 	new_level.reserve(chunks.size());
 	for (const auto& chunk : chunks)
 	{
-		auto combined_bytes = Utils::hex_string_to_byte_array(chunk[0]->value);
-		auto right_bytes = Utils::hex_string_to_byte_array(chunk[1]->value);
-		combined_bytes.insert(combined_bytes.end(), right_bytes.begin(), right_bytes.end());
-
-		std::string combined_hash = Utils::byte_array_to_hex_string(
-			SHA256::double_hash_binary(combined_bytes));
+		std::string combined_hash = Utils::byte_array_to_hex_string(SHA256::Hasher()
+			.update(Utils::hex_string_to_byte_array(chunk[0]->value))
+			.update(Utils::hex_string_to_byte_array(chunk[1]->value))
+			.finalize_double());
 
 		auto node = std::make_shared<MerkleNode>(std::move(combined_hash), chunk);
 
@@ -1,19 +1,18 @@
 #include "mining/pow.hpp"
 
+#include <array>
 #include <cstring>
 #include <stdexcept>
 #include <limits>
 #include <boost/endian/conversion.hpp>
-#include <boost/multiprecision/cpp_int.hpp>
 
 #include "core/chain.hpp"
-#include "net/get_block_msg.hpp"
+#include "net/block_sync.hpp"
 #include "crypto/hash_checker.hpp"
 #include "util/log.hpp"
 #include "core/mempool.hpp"
 #include "mining/merkle_tree.hpp"
 #include "mining/mining_backend_factory.hpp"
-#include "net/net_client.hpp"
 #include "core/net_params.hpp"
 #include "crypto/sha256.hpp"
 #include "util/utils.hpp"
@@ -31,11 +30,9 @@ IMiningBackend& PoW::get_backend()
 
 std::vector<uint8_t> PoW::target_to_bytes(const uint256_t& target)
 {
-	std::vector<uint8_t> bytes;
-	boost::multiprecision::export_bits(target, std::back_inserter(bytes), 8, true);
-	if (bytes.size() < 32)
-		bytes.insert(bytes.begin(), 32 - bytes.size(), 0);
-	return bytes;
+	const auto bytes = target.to_be_bytes();
+
+	return { bytes.begin(), bytes.end() };
 }
 
 uint8_t PoW::get_next_work_required(const std::string& prev_block_hash)
@@ -50,28 +47,42 @@ uint8_t PoW::get_next_work_required(const std::string& prev_block_hash)
 	std::scoped_lock lock(Chain::mutex);
 	const auto& period_start_block = Chain::active_chain[std::max(
 		prev_block_height - (NetParams::DIFFICULTY_PERIOD_IN_BLOCKS - 1), 0LL)];
-	int64_t actual_time_taken = prev_block->timestamp - period_start_block->timestamp;
 
+	return calculate_next_work_required(prev_block->bits, prev_block->timestamp - period_start_block->timestamp);
+}
+
+uint8_t PoW::calculate_next_work_required(uint8_t prev_bits, int64_t actual_time_taken)
+{
 	constexpr int64_t target_secs = NetParams::DIFFICULTY_PERIOD_IN_SECS_TARGET;
 	if (actual_time_taken < target_secs / 4)
 		actual_time_taken = target_secs / 4;
 	if (actual_time_taken > target_secs * 4)
 		actual_time_taken = target_secs * 4;
 
-	const uint256_t old_target = uint256_t(1) << (std::numeric_limits<uint8_t>::max() - prev_block->bits);
-	const uint256_t new_target = old_target * actual_time_taken / target_secs;
+	const uint256_t old_target = get_target(prev_bits);
+	const uint256_t new_target = old_target * static_cast<uint64_t>(actual_time_taken) / target_secs;
 
+	const uint32_t new_target_msb = new_target.is_zero() ? 0 : new_target.bit_length() - 1;
 	const auto new_bits = static_cast<uint8_t>(
-		std::numeric_limits<uint8_t>::max() - static_cast<uint8_t>(msb(new_target)));
+		std::numeric_limits<uint8_t>::max() - static_cast<uint8_t>(new_target_msb));
 
 	return new_bits;
 }
 
-uint256_t PoW::get_block_work(uint8_t bits)
+const uint256_t& PoW::get_block_work(uint8_t bits)
 {
-	const uint256_t target = uint256_t(1) << (std::numeric_limits<uint8_t>::max() - bits);
+	static const auto work_table = []()
+	{
+		std::array<uint256_t, std::numeric_limits<uint8_t>::max() + 1> table;
+		for (uint32_t i = 0; i < table.size(); i++)
+		{
+			const uint256_t target = get_target(static_cast<uint8_t>(i));
+			table[i] = (~target / (target + 1)) + 1;
+		}
+		return table;
+	}();
 
-	return (~target / (target + 1)) + 1;
+	return work_table[bits];
 }
 
 std::shared_ptr<Block> PoW::assemble_and_solve_block(const std::string& pay_coinbase_to_address)
@@ -91,10 +102,17 @@ std::shared_ptr<Block> PoW::assemble_and_solve_block(const std::string& pay_coin
 	auto block = std::make_shared<Block>(0, prev_block_hash, "", Utils::get_unix_timestamp(),
 		get_next_work_required(prev_block_hash), 0, txs);
 
+	uint64_t fees;
 	if (block->txs.empty())
-		block = Mempool::select_from_mempool(block);
-
-	const uint64_t fees = calculate_fees(block);
+	{
+		auto block_template = Mempool::get_block_template();
+		block->txs = std::move(block_template.txs);
+		fees = block_template.fees;
+	}
+	else
+	{
+		fees = calculate_fees(block);
+	}
 	uint64_t chain_height;
 	{
 		std::scoped_lock lock(Chain::mutex);
@@ -120,8 +138,7 @@ std::shared_ptr<Block> PoW::mine(const std::shared_ptr<Block>& block)
 
 	auto new_block = std::make_shared<Block>(*block);
 	new_block->nonce = 0;
-	const uint256_t target_hash = uint256_t(1) << (std::numeric_limits<uint8_t>::max() - new_block->bits);
-	const auto target_bytes = target_to_bytes(target_hash);
+	const auto target_bytes = target_to_bytes(get_target(new_block->bits));
 
 	const auto header_prefix = new_block->header_prefix();
 	const auto prefix_bytes = header_prefix.get_buffer();
@@ -163,84 +180,24 @@ void PoW::mine_forever()
 {
 	Chain::load_from_disk();
 
-	std::string tip_id;
+	if (Chain::get_current_height() != 0)
 	{
-		std::scoped_lock lock(Chain::mutex);
-		if (!Chain::active_chain.empty())
-			tip_id = Chain::active_chain.back()->id();
-	}
-
-	if (!tip_id.empty())
-	{
-		constexpr int64_t STALL_TIMEOUT_SECS = 30;
-		constexpr uint32_t MAX_RETRIES = 3;
-		constexpr int64_t PROGRESS_LOG_INTERVAL_SECS = 10;
-
-		uint32_t retry = 0;
-		while (retry < MAX_RETRIES && !Chain::initial_block_download_complete)
+		if (BlockSync::run_initial_block_download())
 		{
-			if (!NetClient::send_msg_random(GetBlockMsg(tip_id)))
-			{
-				LOG_WARN("No peers available for initial block sync, retrying ({}/{})", retry + 1, MAX_RETRIES);
-				std::this_thread::sleep_for(std::chrono::seconds(5));
-				++retry;
-				continue;
-			}
-
-			LOG_INFO("Starting initial block sync (attempt {}/{})", retry + 1, MAX_RETRIES);
-
-			uint32_t last_known_height = Chain::get_current_height();
-			auto last_progress_time = Utils::get_unix_timestamp();
-			auto last_log_time = last_progress_time;
-
-			while (!Chain::initial_block_download_complete)
-			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-				const uint32_t current_height = Chain::get_current_height();
-				const auto now = Utils::get_unix_timestamp();
-
-				if (current_height > last_known_height)
-				{
-					last_known_height = current_height;
-					last_progress_time = now;
-				}
-
-				if (now - last_log_time >= PROGRESS_LOG_INTERVAL_SECS)
-				{
-					LOG_INFO("Sync in progress, current chain height: {}", current_height);
-					last_log_time = now;
-				}
-
-				if (now - last_progress_time >= STALL_TIMEOUT_SECS)
-				{
-					LOG_WARN("Sync stalled at height {} for {} seconds",
-						current_height, STALL_TIMEOUT_SECS);
-					break;
-				}
-			}
-
-			if (Chain::initial_block_download_complete)
-				break;
-
-			++retry;
-
-			{
-				std::scoped_lock lock(Chain::mutex);
-				if (!Chain::active_chain.empty())
-					tip_id = Chain::active_chain.back()->id();
-			}
+			Chain::save_to_disk();
 		}
-
-		if (!Chain::initial_block_download_complete)
+		else
 		{
-			LOG_ERROR("Initial block sync failed after {} retries, resetting chain", MAX_RETRIES);
+			LOG_ERROR("Initial block sync failed after {} retries, resetting chain", BlockSync::MAX_RETRIES);
 			Chain::reset();
-			Chain::initial_block_download_complete = true;
 		}
+		Chain::initial_block_download_complete = true;
 	}
 
+	Mempool::load_from_disk();
+
 	const auto [priv_key, pub_key, my_address] = Wallet::init_wallet();
+	auto last_mempool_save = Utils::get_unix_timestamp();
 	while (true)
 	{
 		const auto block = assemble_and_solve_block(my_address);
@@ -250,6 +207,12 @@ void PoW::mine_forever()
 			Chain::connect_block(block);
 			Chain::save_to_disk();
 		}
+
+		if (const auto now = Utils::get_unix_timestamp(); now - last_mempool_save >= Mempool::SAVE_INTERVAL_SECS)
+		{
+			Mempool::save_to_disk();
+			last_mempool_save = now;
+		}
 	}
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <atomic>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -16,8 +17,17 @@ public:
 	static std::atomic_bool mine_interrupt;
 
 	static uint8_t get_next_work_required(const std::string& prev_block_hash);
+	// Retarget at a period boundary, actual_time_taken being the span of the period that just ended
+	static uint8_t calculate_next_work_required(uint8_t prev_bits, int64_t actual_time_taken);
 
-	static uint256_t get_block_work(uint8_t bits);
+	// bits is the number of leading zero bits a block id needs, i.e. the target is 2^(255 - bits)
+	static constexpr uint256_t get_target(uint8_t bits)
+	{
+		return uint256_t(1) << (std::numeric_limits<uint8_t>::max() - bits);
+	}
+
+	// Expected number of hashes for a target, looked up from a table built on first use
+	static const uint256_t& get_block_work(uint8_t bits);
 
 	static std::shared_ptr<Block> assemble_and_solve_block(const std::string& pay_coinbase_to_address);
 	static std::shared_ptr<Block> assemble_and_solve_block(const std::string& pay_coinbase_to_address,
@@ -0,0 +1,537 @@
+#include "net/block_sync.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "core/chain.hpp"
+#include "core/net_params.hpp"
+#include "crypto/hash_checker.hpp"
+#include "mining/pow.hpp"
+#include "net/get_blocks_msg.hpp"
+#include "net/get_headers_msg.hpp"
+#include "net/net_client.hpp"
+#include "util/exceptions.hpp"
+#include "util/log.hpp"
+#include "util/random.hpp"
+#include "util/utils.hpp"
+
+std::recursive_mutex BlockSync::mutex;
+std::condition_variable_any BlockSync::progress_cv;
+std::mutex BlockSync::connect_mutex;
+
+std::deque<std::shared_ptr<Block>> BlockSync::headers;
+size_t BlockSync::headers_connected = 0;
+uint256_t BlockSync::headers_work;
+std::unordered_map<std::string, int64_t> BlockSync::header_heights;
+
+std::unordered_map<std::string, std::shared_ptr<Block>> BlockSync::downloaded_blocks;
+std::unordered_map<std::string, BlockSync::BlockRequest> BlockSync::blocks_in_flight;
+
+std::shared_ptr<Connection> BlockSync::headers_con;
+int64_t BlockSync::headers_requested_at = 0;
+bool BlockSync::headers_synced = false;
+
+int64_t BlockSync::last_progress_time = 0;
+
+bool BlockSync::run_initial_block_download()
+{
+	constexpr int64_t PROGRESS_LOG_INTERVAL_SECS = 10;
+
+	std::unique_lock lock(mutex);
+
+	headers_con = nullptr;
+	headers_synced = false;
+	last_progress_time = Utils::get_unix_timestamp();
+	auto last_log_time = last_progress_time;
+
+	uint32_t retry = 0;
+	auto retry_progress_time = last_progress_time;
+	while (!headers_synced || get_pending_header_count() != 0)
+	{
+		// Retries only count towards the limit while no peer is delivering anything
+		if (last_progress_time != retry_progress_time)
+			retry = 0;
+
+		const auto peers = get_peers();
+		const auto now = Utils::get_unix_timestamp();
+
+		if (peers.empty())
+		{
+			LOG_WARN("No peers available for initial block sync, retrying ({}/{})", retry + 1, MAX_RETRIES);
+			if (++retry >= MAX_RETRIES)
+				return false;
+
+			progress_cv.wait_for(lock, std::chrono::seconds(5));
+			last_progress_time = Utils::get_unix_timestamp();
+			retry_progress_time = last_progress_time;
+
+			continue;
+		}
+
+		Requests requests;
+		if (!headers_synced && (headers_con == nullptr || now - headers_requested_at >= REQUEST_TIMEOUT_SECS))
+			request_headers(peers[Random::get_int(0, static_cast<int64_t>(peers.size()) - 1)], requests);
+		schedule_downloads(peers, now, requests);
+
+		if (now - last_progress_time >= STALL_TIMEOUT_SECS)
+		{
+			LOG_WARN("Sync stalled at height {} for {} seconds ({}/{})", Chain::get_current_height(),
+				STALL_TIMEOUT_SECS, retry + 1, MAX_RETRIES);
+			if (++retry >= MAX_RETRIES)
+				return false;
+
+			headers_con = nullptr;
+			headers_synced = false;
+			last_progress_time = now;
+			retry_progress_time = now;
+		}
+
+		lock.unlock();
+		send_requests(requests);
+		lock.lock();
+
+		if (now - last_log_time >= PROGRESS_LOG_INTERVAL_SECS)
+		{
+			LOG_INFO("Sync in progress, current chain height: {}, {} header(s) pending", Chain::get_current_height(),
+				get_pending_header_count());
+			last_log_time = now;
+		}
+
+		progress_cv.wait_for(lock, std::chrono::seconds(1));
+	}
+
+	LOG_INFO("Initial block download complete");
+
+	return true;
+}
+
+std::vector<std::string> BlockSync::get_locator()
+{
+	std::scoped_lock lock(mutex, Chain::mutex);
+
+	if (Chain::active_chain.empty())
+		return {};
+
+	int64_t anchor_height = get_headers_anchor_height();
+	int64_t tip_height = anchor_height + static_cast<int64_t>(headers.size());
+	if (anchor_height == -1)
+	{
+		anchor_height = static_cast<int64_t>(Chain::active_chain.size()) - 1;
+		tip_height = anchor_height;
+	}
+
+	const auto get_id = [anchor_height](int64_t height)
+	{
+		return height <= anchor_height ? Chain::active_chain[height]->id() : headers[height - anchor_height - 1]->id();
+	};
+
+	std::vector<std::string> locator;
+	int64_t step = 1;
+	for (int64_t height = tip_height; height > 0; height -= step)
+	{
+		locator.push_back(get_id(height));
+		if (locator.size() >= 10)
+			step *= 2;
+	}
+	locator.push_back(get_id(0));
+
+	return locator;
+}
+
+bool BlockSync::accept_headers(const std::vector<std::shared_ptr<Block>>& new_headers)
+{
+	std::scoped_lock lock(mutex, Chain::mutex);
+
+	// Peers answer a locator from the last block they share with us, skip what is already known
+	size_t first_new = 0;
+	for (; first_new < new_headers.size(); first_new++)
+	{
+		const auto block_id = new_headers[first_new]->id();
+		if (Chain::locate_block_in_active_chain(block_id).second == -1 && find_pending_header(block_id) == -1)
+			break;
+	}
+	if (first_new == new_headers.size())
+		return true;
+
+	const auto& fork_block_id = new_headers[first_new]->prev_block_hash;
+
+	// The candidate header chain is the first kept_count pending headers followed by the new ones
+	int64_t anchor_height = -1;
+	size_t kept_count = 0;
+	if (const auto fork_idx = find_pending_header(fork_block_id); fork_idx != -1)
+	{
+		anchor_height = get_headers_anchor_height();
+		kept_count = static_cast<size_t>(fork_idx) + 1;
+	}
+	if (anchor_height == -1)
+	{
+		kept_count = 0;
+		anchor_height = Chain::locate_block_in_active_chain(fork_block_id).second;
+	}
+	if (anchor_height == -1)
+	{
+		LOG_WARN("Headers do not connect to a known block {}", fork_block_id);
+
+		return false;
+	}
+
+	std::vector<std::shared_ptr<Block>> extension;
+	const auto get_ancestor = [anchor_height, kept_count, &extension](int64_t height) -> const std::shared_ptr<Block>&
+	{
+		if (height <= anchor_height)
+			return Chain::active_chain[height];
+
+		const auto idx = static_cast<size_t>(height - anchor_height - 1);
+		return idx < kept_count ? headers[idx] : extension[idx - kept_count];
+	};
+
+	// Extending the pending tip adds to its work, forking below it sums the kept headers again
+	const bool extends_tip = kept_count != 0 && kept_count == headers.size();
+	uint256_t candidate_work = headers_work;
+	if (!extends_tip)
+	{
+		candidate_work = Chain::get_chain_work_at_height(static_cast<uint32_t>(anchor_height));
+		for (size_t i = 0; i < kept_count; i++)
+			candidate_work += PoW::get_block_work(headers[i]->bits);
+	}
+
+	for (size_t i = first_new; i < new_headers.size(); i++)
+	{
+		const auto& header = new_headers[i];
+		const int64_t height = anchor_height + 1 + static_cast<int64_t>(kept_count + extension.size());
+
+		if (header->prev_block_hash != get_ancestor(height - 1)->id())
+		{
+			LOG_WARN("Header {} does not extend the header before it", header->id());
+
+			return false;
+		}
+
+		try
+		{
+			validate_header(header, height, get_ancestor);
+		}
+		catch (const BlockValidationException& ex)
+		{
+			LOG_ERROR(ex.what());
+
+			LOG_ERROR("Header {} failed validation", header->id());
+
+			return false;
+		}
+
+		extension.push_back(header);
+		candidate_work += PoW::get_block_work(header->bits);
+	}
+
+	const uint256_t active_chain_work = Chain::get_chain_work_at_height(Chain::get_current_height() - 1);
+	if (candidate_work <= active_chain_work || (!headers.empty() && candidate_work <= headers_work))
+		return true;
+
+	if (kept_count == headers.size())
+	{
+		// Nothing pending is dropped, so only the new headers need indexing
+		for (size_t i = 0; i < extension.size(); i++)
+			header_heights.emplace(extension[i]->id(), anchor_height + 1 + static_cast<int64_t>(kept_count + i));
+		headers.insert(headers.end(), extension.begin(), extension.end());
+	}
+	else
+	{
+		headers.erase(headers.begin() + static_cast<int64_t>(kept_count), headers.end());
+		headers.insert(headers.end(), extension.begin(), extension.end());
+		headers_connected = std::min(headers_connected, kept_count);
+		index_headers();
+
+		// Bodies of headers that are no longer on the best header chain will not be connected
+		std::erase_if(downloaded_blocks, [](const auto& entry) { return !header_heights.contains(entry.first); });
+		std::erase_if(blocks_in_flight, [](const auto& entry) { return !header_heights.contains(entry.first); });
+	}
+	headers_work = candidate_work;
+
+	LOG_INFO("Best header chain now at height {}", anchor_height + static_cast<int64_t>(headers.size()));
+
+	last_progress_time = Utils::get_unix_timestamp();
+	progress_cv.notify_all();
+
+	return true;
+}
+
+uint32_t BlockSync::accept_blocks(const std::vector<std::shared_ptr<Block>>& blocks)
+{
+	std::scoped_lock connect_lock(connect_mutex);
+
+	// Bodies stay buffered until connected, so they are not requested again in the meantime
+	std::vector<std::shared_ptr<Block>> to_connect;
+	{
+		std::scoped_lock lock(mutex);
+
+		const size_t window_end = std::min(headers.size(), headers_connected + DOWNLOAD_WINDOW);
+		for (const auto& block : blocks)
+		{
+			const auto block_id = block->id();
+			blocks_in_flight.erase(block_id);
+
+			// Block ids are header hashes, so a matching id means the body belongs to that header
+			const auto idx = find_pending_header(block_id);
+			if (idx >= static_cast<int64_t>(headers_connected) && idx < static_cast<int64_t>(window_end))
+				downloaded_blocks.emplace(block_id, block);
+		}
+
+		for (size_t i = headers_connected; i < headers.size(); i++)
+		{
+			const auto block_it = downloaded_blocks.find(headers[i]->id());
+			if (block_it == downloaded_blocks.end())
+				break;
+
+			to_connect.push_back(block_it->second);
+		}
+	}
+
+	size_t connect_count = 0;
+	for (; connect_count < to_connect.size(); connect_count++)
+	{
+		const auto& block = to_connect[connect_count];
+		if (Chain::connect_block(block) < 0 && std::get<0>(Chain::locate_block_in_all_chains(block->id())) == nullptr)
+			break;
+	}
+
+	std::scoped_lock lock(mutex);
+
+	// Headers may have been replaced meanwhile, only what still lines up with them moves forward
+	uint32_t connected = 0;
+	for (size_t i = 0; i < connect_count; i++)
+	{
+		const auto block_id = to_connect[i]->id();
+		downloaded_blocks.erase(block_id);
+		if (headers_connected < headers.size() && headers[headers_connected]->id() == block_id)
+		{
+			headers_connected++;
+			connected++;
+		}
+	}
+
+	if (connect_count < to_connect.size())
+	{
+		LOG_ERROR("Block {} failed validation, dropping the header chain it belongs to", to_connect[connect_count]->id());
+
+		headers.clear();
+		headers_connected = 0;
+		headers_work = 0;
+		header_heights.clear();
+		downloaded_blocks.clear();
+		blocks_in_flight.clear();
+		headers_con = nullptr;
+		headers_synced = false;
+	}
+
+	// Headers whose blocks made it into the active chain are no longer needed
+	size_t active_prefix = 0;
+	while (active_prefix < headers_connected &&
+		Chain::locate_block_in_active_chain(headers[active_prefix]->id()).second != -1)
+	{
+		header_heights.erase(headers[active_prefix]->id());
+		active_prefix++;
+	}
+	headers.erase(headers.begin(), headers.begin() + static_cast<int64_t>(active_prefix));
+	headers_connected -= active_prefix;
+
+	if (connected != 0)
+	{
+		last_progress_time = Utils::get_unix_timestamp();
+		progress_cv.notify_all();
+	}
+
+	return connected;
+}
+
+void BlockSync::handle_headers(const std::shared_ptr<Connection>& con,
+	const std::vector<std::shared_ptr<Block>>& new_headers)
+{
+	const bool valid = accept_headers(new_headers);
+
+	Requests requests;
+	{
+		std::scoped_lock lock(mutex);
+
+		if (con == headers_con)
+		{
+			headers_con = nullptr;
+			if (valid && new_headers.size() == MAX_HEADERS_PER_MSG)
+				request_headers(con, requests);
+			else if (valid)
+				headers_synced = true;
+		}
+
+		schedule_downloads(get_peers(), Utils::get_unix_timestamp(), requests);
+
+		progress_cv.notify_all();
+	}
+
+	send_requests(requests);
+}
+
+void BlockSync::handle_blocks(const std::vector<std::shared_ptr<Block>>& blocks)
+{
+	if (accept_blocks(blocks) != 0)
+		Chain::save_to_disk();
+
+	Requests requests;
+	{
+		std::scoped_lock lock(mutex);
+
+		schedule_downloads(get_peers(), Utils::get_unix_timestamp(), requests);
+
+		progress_cv.notify_all();
+	}
+
+	send_requests(requests);
+}
+
+size_t BlockSync::get_pending_header_count()
+{
+	std::scoped_lock lock(mutex);
+
+	return headers.size() - headers_connected;
+}
+
+void BlockSync::reset()
+{
+	std::scoped_lock lock(mutex);
+
+	headers.clear();
+	headers_connected = 0;
+	headers_work = 0;
+	header_heights.clear();
+	downloaded_blocks.clear();
+	blocks_in_flight.clear();
+	headers_con = nullptr;
+	headers_requested_at = 0;
+	headers_synced = false;
+	last_progress_time = 0;
+}
+
+int64_t BlockSync::get_headers_anchor_height()
+{
+	if (headers.empty())
+		return static_cast<int64_t>(Chain::get_current_height()) - 1;
+
+	return Chain::locate_block_in_active_chain(headers.front()->prev_block_hash).second;
+}
+
+int64_t BlockSync::find_pending_header(const std::string& block_id)
+{
+	const auto it = header_heights.find(block_id);
+	if (it == header_heights.end())
+		return -1;
+
+	return it->second - header_heights.at(headers.front()->id());
+}
+
+void BlockSync::index_headers()
+{
+	header_heights.clear();
+	header_heights.reserve(headers.size());
+
+	const auto anchor_height = get_headers_anchor_height();
+	for (size_t i = 0; i < headers.size(); i++)
+		header_heights.emplace(headers[i]->id(), anchor_height + 1 + static_cast<int64_t>(i));
+}
+
+void BlockSync::validate_header(const std::shared_ptr<Block>& header, int64_t height,
+	const std::function<const std::shared_ptr<Block>&(int64_t)>& get_ancestor)
+{
+	if (header->timestamp - Utils::get_unix_timestamp() > static_cast<int64_t>(NetParams::MAX_FUTURE_BLOCK_TIME_IN_SECS))
+		throw BlockValidationException("Block timestamp too far in future");
+
+	if (!HashChecker::is_valid(header->id(), PoW::get_target(header->bits)))
+		throw BlockValidationException("Block header does not satisfy bits");
+
+	const auto& prev_block = get_ancestor(height - 1);
+	uint8_t expected_bits = prev_block->bits;
+	if (height % NetParams::DIFFICULTY_PERIOD_IN_BLOCKS == 0)
+	{
+		const auto& period_start_block = get_ancestor(std::max<int64_t>(
+			height - NetParams::DIFFICULTY_PERIOD_IN_BLOCKS, 0));
+		expected_bits = PoW::calculate_next_work_required(prev_block->bits,
+			prev_block->timestamp - period_start_block->timestamp);
+	}
+	if (header->bits != expected_bits)
+		throw BlockValidationException("Bits incorrect");
+
+	const auto median_time_past = Chain::get_median_time_past_before(height,
+		[&get_ancestor](int64_t ancestor_height) { return get_ancestor(ancestor_height)->timestamp; });
+	if (header->timestamp <= median_time_past)
+		throw BlockValidationException("timestamp too old");
+}
+
+void BlockSync::request_headers(const std::shared_ptr<Connection>& con, Requests& requests)
+{
+	headers_con = con;
+	headers_requested_at = Utils::get_unix_timestamp();
+
+	requests.emplace_back(con, std::make_shared<GetHeadersMsg>(get_locator()));
+}
+
+void BlockSync::schedule_downloads(const std::vector<std::shared_ptr<Connection>>& peers, int64_t now,
+	Requests& requests)
+{
+	// Requests that timed out or went to a peer that disconnected are handed out again
+	std::erase_if(blocks_in_flight, [&peers, now](const auto& entry)
+	{
+		return now - entry.second.requested_at >= REQUEST_TIMEOUT_SECS ||
+			std::ranges::find(peers, entry.second.con) == peers.end();
+	});
+
+	if (peers.empty())
+		return;
+
+	std::unordered_map<std::shared_ptr<Connection>, uint32_t> peer_load;
+	for (const auto& peer : peers)
+		peer_load[peer] = 0;
+	for (const auto& [block_id, request] : blocks_in_flight)
+		peer_load[request.con]++;
+
+	std::unordered_map<std::shared_ptr<Connection>, std::vector<std::string>> batches;
+	const size_t window_end = std::min(headers.size(), headers_connected + DOWNLOAD_WINDOW);
+	for (size_t i = headers_connected; i < window_end; i++)
+	{
+		const auto block_id = headers[i]->id();
+		if (downloaded_blocks.contains(block_id) || blocks_in_flight.contains(block_id))
+			continue;
+
+		const auto peer_it = std::ranges::min_element(peer_load, {}, [](const auto& entry) { return entry.second; });
+		if (peer_it->second >= MAX_BLOCKS_IN_FLIGHT_PER_PEER)
+			break;
+		peer_it->second++;
+
+		const auto& peer = peer_it->first;
+		blocks_in_flight.emplace(block_id, BlockRequest{ peer, now });
+
+		auto& batch = batches[peer];
+		batch.push_back(block_id);
+		if (batch.size() == MAX_BLOCKS_PER_REQUEST)
+		{
+			requests.emplace_back(peer, std::make_shared<GetBlocksMsg>(batch));
+			batch.clear();
+		}
+	}
+
+	for (const auto& [peer, batch] : batches)
+	{
+		if (!batch.empty())
+			requests.emplace_back(peer, std::make_shared<GetBlocksMsg>(batch));
+	}
+}
+
+void BlockSync::send_requests(const Requests& requests)
+{
+	for (const auto& [con, msg] : requests)
+		NetClient::send_msg(con, *msg);
+}
+
+std::vector<std::shared_ptr<Connection>> BlockSync::get_peers()
+{
+	std::scoped_lock lock(NetClient::connections_mutex);
+
+	return NetClient::miner_connections;
+}
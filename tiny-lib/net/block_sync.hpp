@@ -0,0 +1,102 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core/block.hpp"
+#include "net/connection.hpp"
+#include "net/i_msg.hpp"
+#include "util/uint256_t.hpp"
+
+// Headers-first initial block download. The header chain is fetched and checked (linkage, PoW,
+// difficulty, timestamps) ahead of the bodies, which are then requested in parallel from all miner
+// peers and connected to the chain strictly in header order.
+class BlockSync
+{
+public:
+	static constexpr uint32_t MAX_HEADERS_PER_MSG = 2000;
+	// Keeps a BlocksMsg of maximum size blocks under the message payload limit
+	static constexpr uint32_t MAX_BLOCKS_PER_REQUEST = 4;
+	static constexpr uint32_t MAX_BLOCKS_IN_FLIGHT_PER_PEER = 16;
+	// How far past the first missing body downloads may run ahead
+	static constexpr uint32_t DOWNLOAD_WINDOW = 256;
+
+	static constexpr int64_t REQUEST_TIMEOUT_SECS = 10;
+	static constexpr int64_t STALL_TIMEOUT_SECS = 30;
+	static constexpr uint32_t MAX_RETRIES = 3;
+
+	// Blocks until the active chain has caught up with the best header chain known to peers.
+	// Returns false if no peer could be synced from.
+	static bool run_initial_block_download();
+
+	// Ids from the best known header back to genesis, one by one for the last 10, then doubling the step
+	static std::vector<std::string> get_locator();
+
+	// Checks headers and adopts them if the header chain they end has more work than both the
+	// active chain and the current pending header chain. Returns false on invalid or unconnected headers.
+	static bool accept_headers(const std::vector<std::shared_ptr<Block>>& new_headers);
+	// Buffers bodies of pending headers and connects every body now contiguous with the chain.
+	// Returns the number of blocks connected.
+	static uint32_t accept_blocks(const std::vector<std::shared_ptr<Block>>& blocks);
+
+	static void handle_headers(const std::shared_ptr<Connection>& con,
+		const std::vector<std::shared_ptr<Block>>& new_headers);
+	static void handle_blocks(const std::vector<std::shared_ptr<Block>>& blocks);
+
+	static size_t get_pending_header_count();
+
+	static void reset();
+
+private:
+	struct BlockRequest
+	{
+		std::shared_ptr<Connection> con;
+		int64_t requested_at;
+	};
+
+	// Requests are built under mutex and sent once it is released
+	using Requests = std::vector<std::pair<std::shared_ptr<Connection>, std::shared_ptr<IMsg>>>;
+
+	static std::recursive_mutex mutex;
+	static std::condition_variable_any progress_cv;
+	// Held across Chain::connect_block calls instead of mutex, so bodies still connect in header order
+	static std::mutex connect_mutex;
+
+	// Best header chain past the active chain, the first one's parent being in the active chain.
+	// The first headers_connected of them have had their blocks handed to Chain::connect_block.
+	static std::deque<std::shared_ptr<Block>> headers;
+	static size_t headers_connected;
+	static uint256_t headers_work;
+	// Height of each header in headers, to find one by id
+	static std::unordered_map<std::string, int64_t> header_heights;
+
+	static std::unordered_map<std::string, std::shared_ptr<Block>> downloaded_blocks;
+	static std::unordered_map<std::string, BlockRequest> blocks_in_flight;
+
+	static std::shared_ptr<Connection> headers_con;
+	static int64_t headers_requested_at;
+	static bool headers_synced;
+
+	static int64_t last_progress_time;
+
+	static int64_t get_headers_anchor_height();
+	// Index of the header in headers, -1 if it is not pending
+	static int64_t find_pending_header(const std::string& block_id);
+	static void index_headers();
+
+	static void validate_header(const std::shared_ptr<Block>& header, int64_t height,
+		const std::function<const std::shared_ptr<Block>&(int64_t)>& get_ancestor);
+
+	static void request_headers(const std::shared_ptr<Connection>& con, Requests& requests);
+	static void schedule_downloads(const std::vector<std::shared_ptr<Connection>>& peers, int64_t now,
+		Requests& requests);
+	static void send_requests(const Requests& requests);
+	static std::vector<std::shared_ptr<Connection>> get_peers();
+};
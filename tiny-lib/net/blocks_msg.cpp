@@ -0,0 +1,56 @@
+#include "net/blocks_msg.hpp"
+
+#include "net/block_sync.hpp"
+#include "util/log.hpp"
+
+BlocksMsg::BlocksMsg(const std::vector<std::shared_ptr<Block>>& blocks)
+	: blocks(blocks)
+{}
+
+void BlocksMsg::handle(const std::shared_ptr<Connection>& con)
+{
+	const auto& endpoint = con->socket.remote_endpoint();
+	LOG_TRACE("Received {} block(s) from {}:{}", blocks.size(), endpoint.address().to_string(),
+		endpoint.port());
+
+	BlockSync::handle_blocks(blocks);
+}
+
+BinaryBuffer BlocksMsg::serialize() const
+{
+	BinaryBuffer buffer;
+
+	buffer.write_size(static_cast<uint32_t>(blocks.size()));
+	for (const auto& block : blocks)
+		buffer.write_raw(block->serialize().get_buffer());
+
+	return buffer;
+}
+
+bool BlocksMsg::deserialize(BinaryBuffer& buffer)
+{
+	uint32_t blocks_size = 0;
+	if (!buffer.read_size(blocks_size))
+		return false;
+	if (blocks_size > BlockSync::MAX_BLOCKS_PER_REQUEST)
+		return false;
+
+	std::vector<std::shared_ptr<Block>> new_blocks;
+	new_blocks.reserve(blocks_size);
+	for (uint32_t i = 0; i < blocks_size; i++)
+	{
+		auto block = std::make_shared<Block>();
+		if (!block->deserialize(buffer))
+			return false;
+		new_blocks.push_back(std::move(block));
+	}
+
+	blocks = std::move(new_blocks);
+
+	return true;
+}
+
+Opcode BlocksMsg::get_opcode() const
+{
+	return Opcode::BlocksMsg;
+}
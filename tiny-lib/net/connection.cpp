@@ -1,5 +1,5 @@
 #include "net/connection.hpp"
 
 Connection::Connection(boost::asio::io_context& io_context)
-	: socket(io_context)
+	: strand(boost::asio::make_strand(io_context)), socket(strand)
 {}
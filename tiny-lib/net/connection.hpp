@@ -1,18 +1,34 @@
 #pragma once
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <boost/asio.hpp>
 
 #include "core/enums.hpp"
+#include "net/framed_msg.hpp"
 
 class Connection
 {
 public:
 	Connection(boost::asio::io_context& io_context);
 
+	// Runs every handler of this peer, so its reads, writes and messages are processed in order and
+	// never concurrently, while other peers are served by the other io threads
+	boost::asio::strand<boost::asio::io_context::executor_type> strand;
+	// Created on the strand so completion handlers are dispatched through it
 	boost::asio::ip::tcp::socket socket;
 	boost::asio::streambuf read_buffer;
 
+	// Guards the send queue and the write in progress
 	std::mutex write_mutex;
+	// Framed messages waiting for the write in progress to finish
+	std::deque<std::shared_ptr<const FramedMsg>> send_queue;
+	// Messages handed to the current async_write, kept alive until it completes
+	std::vector<std::shared_ptr<const FramedMsg>> writing;
+	// Bytes in send_queue and writing together
+	size_t queued_bytes = 0;
+	bool write_in_progress = false;
 
 	NodeType node_type = NodeType::Unspecified;
 };
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// A message ready for the wire, built once and shared read-only by the send queue of every peer it
+// goes to. The two parts are sent back to back with a gathered write.
+class FramedMsg
+{
+public:
+	// Magic, payload length, checksum and opcode
+	std::vector<uint8_t> header;
+	// The message as serialized, the rest of the payload
+	std::vector<uint8_t> body;
+
+	size_t size() const
+	{
+		return header.size() + body.size();
+	}
+};
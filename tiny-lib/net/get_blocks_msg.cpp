@@ -0,0 +1,68 @@
+#include "net/get_blocks_msg.hpp"
+
+#include "core/chain.hpp"
+#include "net/block_sync.hpp"
+#include "net/blocks_msg.hpp"
+#include "util/log.hpp"
+#include "net/net_client.hpp"
+
+GetBlocksMsg::GetBlocksMsg(const std::vector<std::string>& block_ids)
+	: block_ids(block_ids)
+{}
+
+void GetBlocksMsg::handle(const std::shared_ptr<Connection>& con)
+{
+	const auto& endpoint = con->socket.remote_endpoint();
+	LOG_TRACE("Received GetBlocksMsg from {}:{}", endpoint.address().to_string(), endpoint.port());
+
+	std::vector<std::shared_ptr<Block>> blocks;
+	blocks.reserve(block_ids.size());
+	for (const auto& block_id : block_ids)
+	{
+		const auto [block, height, chain_idx] = Chain::locate_block_in_all_chains(block_id);
+		if (block != nullptr)
+			blocks.push_back(block);
+	}
+
+	LOG_TRACE("Sending {} block(s) to {}:{}", blocks.size(), endpoint.address().to_string(), endpoint.port());
+	NetClient::send_msg(con, BlocksMsg(blocks));
+}
+
+BinaryBuffer GetBlocksMsg::serialize() const
+{
+	BinaryBuffer buffer;
+
+	buffer.write_size(static_cast<uint32_t>(block_ids.size()));
+	for (const auto& block_id : block_ids)
+		buffer.write(block_id);
+
+	return buffer;
+}
+
+bool GetBlocksMsg::deserialize(BinaryBuffer& buffer)
+{
+	uint32_t block_ids_size = 0;
+	if (!buffer.read_size(block_ids_size))
+		return false;
+	if (block_ids_size > BlockSync::MAX_BLOCKS_PER_REQUEST)
+		return false;
+
+	std::vector<std::string> new_block_ids;
+	new_block_ids.reserve(block_ids_size);
+	for (uint32_t i = 0; i < block_ids_size; i++)
+	{
+		std::string block_id;
+		if (!buffer.read(block_id))
+			return false;
+		new_block_ids.push_back(std::move(block_id));
+	}
+
+	block_ids = std::move(new_block_ids);
+
+	return true;
+}
+
+Opcode GetBlocksMsg::get_opcode() const
+{
+	return Opcode::GetBlocksMsg;
+}
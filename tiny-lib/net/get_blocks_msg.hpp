@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "net/i_msg.hpp"
+
+class GetBlocksMsg : public IMsg
+{
+public:
+	GetBlocksMsg() = default;
+	GetBlocksMsg(const std::vector<std::string>& block_ids);
+
+	~GetBlocksMsg() override = default;
+
+	std::vector<std::string> block_ids;
+
+	void handle(const std::shared_ptr<Connection>& con) override;
+	BinaryBuffer serialize() const override;
+	bool deserialize(BinaryBuffer& buffer) override;
+
+	Opcode get_opcode() const override;
+};
@@ -0,0 +1,27 @@
+#include "net/get_fee_histogram_msg.hpp"
+
+#include "core/mempool.hpp"
+#include "net/net_client.hpp"
+#include "net/send_fee_histogram_msg.hpp"
+
+void GetFeeHistogramMsg::handle(const std::shared_ptr<Connection>& con)
+{
+	NetClient::send_msg(con, SendFeeHistogramMsg(Mempool::fee_histogram.get_buckets()));
+}
+
+BinaryBuffer GetFeeHistogramMsg::serialize() const
+{
+	BinaryBuffer buffer;
+
+	return buffer;
+}
+
+bool GetFeeHistogramMsg::deserialize([[maybe_unused]] BinaryBuffer& buffer)
+{
+	return true;
+}
+
+Opcode GetFeeHistogramMsg::get_opcode() const
+{
+	return Opcode::GetFeeHistogramMsg;
+}
@@ -0,0 +1,87 @@
+#include "net/get_headers_msg.hpp"
+
+#include <algorithm>
+
+#include "core/chain.hpp"
+#include "net/block_sync.hpp"
+#include "net/headers_msg.hpp"
+#include "util/log.hpp"
+#include "net/net_client.hpp"
+
+GetHeadersMsg::GetHeadersMsg(const std::vector<std::string>& locator)
+	: locator(locator)
+{}
+
+void GetHeadersMsg::handle(const std::shared_ptr<Connection>& con)
+{
+	const auto& endpoint = con->socket.remote_endpoint();
+	LOG_TRACE("Received GetHeadersMsg from {}:{}", endpoint.address().to_string(), endpoint.port());
+
+	std::vector<std::shared_ptr<Block>> headers;
+
+	{
+		std::scoped_lock lock(Chain::mutex);
+
+		int64_t height = -1;
+		for (const auto& block_id : locator)
+		{
+			height = Chain::locate_block_in_active_chain(block_id).second;
+			if (height != -1)
+				break;
+		}
+		if (height == -1)
+			height = 1;
+		else
+			height += 1;
+
+		const auto chain_size = static_cast<int64_t>(Chain::active_chain.size());
+		const int64_t max_height = std::min(height + static_cast<int64_t>(BlockSync::MAX_HEADERS_PER_MSG),
+			chain_size);
+		if (height < max_height)
+			headers.reserve(static_cast<size_t>(max_height - height));
+		for (int64_t i = height; i < max_height; i++)
+			headers.push_back(Chain::active_chain[i]);
+	}
+
+	LOG_TRACE("Sending {} header(s) to {}:{}", headers.size(), endpoint.address().to_string(), endpoint.port());
+	NetClient::send_msg(con, HeadersMsg(headers));
+}
+
+BinaryBuffer GetHeadersMsg::serialize() const
+{
+	BinaryBuffer buffer;
+
+	buffer.write_size(static_cast<uint32_t>(locator.size()));
+	for (const auto& block_id : locator)
+		buffer.write(block_id);
+
+	return buffer;
+}
+
+bool GetHeadersMsg::deserialize(BinaryBuffer& buffer)
+{
+	uint32_t locator_size = 0;
+	if (!buffer.read_size(locator_size))
+		return false;
+	if (locator_size > MAX_LOCATOR_SIZE)
+		return false;
+
+	std::vector<std::string> new_locator;
+	new_locator.reserve(locator_size);
+	for (uint32_t i = 0; i < locator_size; i++)
+	{
+		std::string block_id;
+		if (!buffer.read(block_id))
+			return false;
+		new_locator.push_back(std::move(block_id));
+	}
+
+	locator = std::move(new_locator);
+
+	return true;
+}
+
+Opcode GetHeadersMsg::get_opcode() const
+{
+	return Opcode::GetHeadersMsg;
+}
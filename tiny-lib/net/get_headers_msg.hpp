@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "net/i_msg.hpp"
+
+class GetHeadersMsg : public IMsg
+{
+public:
+	GetHeadersMsg() = default;
+	GetHeadersMsg(const std::vector<std::string>& locator);
+
+	~GetHeadersMsg() override = default;
+
+	// Block ids from the requester's best tip back to genesis, see BlockSync::get_locator
+	std::vector<std::string> locator;
+
+	void handle(const std::shared_ptr<Connection>& con) override;
+	BinaryBuffer serialize() const override;
+	bool deserialize(BinaryBuffer& buffer) override;
+
+	Opcode get_opcode() const override;
+
+private:
+	static constexpr uint32_t MAX_LOCATOR_SIZE = 101;
+};
@@ -0,0 +1,56 @@
+#include "net/headers_msg.hpp"
+
+#include "net/block_sync.hpp"
+#include "util/log.hpp"
+
+HeadersMsg::HeadersMsg(const std::vector<std::shared_ptr<Block>>& headers)
+	: headers(headers)
+{}
+
+void HeadersMsg::handle(const std::shared_ptr<Connection>& con)
+{
+	const auto& endpoint = con->socket.remote_endpoint();
+	LOG_TRACE("Received {} header(s) from {}:{}", headers.size(), endpoint.address().to_string(),
+		endpoint.port());
+
+	BlockSync::handle_headers(con, headers);
+}
+
+BinaryBuffer HeadersMsg::serialize() const
+{
+	BinaryBuffer buffer;
+
+	buffer.write_size(static_cast<uint32_t>(headers.size()));
+	for (const auto& header : headers)
+		buffer.write_raw(header->header().get_buffer());
+
+	return buffer;
+}
+
+bool HeadersMsg::deserialize(BinaryBuffer& buffer)
+{
+	uint32_t headers_size = 0;
+	if (!buffer.read_size(headers_size))
+		return false;
+	if (headers_size > BlockSync::MAX_HEADERS_PER_MSG)
+		return false;
+
+	std::vector<std::shared_ptr<Block>> new_headers;
+	new_headers.reserve(headers_size);
+	for (uint32_t i = 0; i < headers_size; i++)
+	{
+		auto header = std::make_shared<Block>();
+		if (!header->deserialize_header(buffer))
+			return false;
+		new_headers.push_back(std::move(header));
+	}
+
+	headers = std::move(new_headers);
+
+	return true;
+}
+
+Opcode HeadersMsg::get_opcode() const
+{
+	return Opcode::HeadersMsg;
+}
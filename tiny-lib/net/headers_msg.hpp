@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+
+#include "core/block.hpp"
+#include "net/i_msg.hpp"
+
+// Carries only block headers, the blocks on the receiving side have no txs
+class HeadersMsg : public IMsg
+{
+public:
+	HeadersMsg() = default;
+	HeadersMsg(const std::vector<std::shared_ptr<Block>>& headers);
+
+	~HeadersMsg() override = default;
+
+	std::vector<std::shared_ptr<Block>> headers;
+
+	void handle(const std::shared_ptr<Connection>& con) override;
+	BinaryBuffer serialize() const override;
+	bool deserialize(BinaryBuffer& buffer) override;
+
+	Opcode get_opcode() const override;
+};
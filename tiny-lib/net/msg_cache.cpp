@@ -3,6 +3,7 @@
 std::shared_ptr<SendActiveChainMsg> MsgCache::send_active_chain_msg;
 std::shared_ptr<SendMempoolMsg> MsgCache::send_mempool_msg;
 std::shared_ptr<SendUTXOsMsg> MsgCache::send_utxos_msg;
+std::shared_ptr<SendFeeHistogramMsg> MsgCache::send_fee_histogram_msg;
 std::mutex MsgCache::mutex;
 
 void MsgCache::set_send_active_chain_msg(std::shared_ptr<SendActiveChainMsg> msg)
@@ -40,3 +41,15 @@ std::shared_ptr<SendUTXOsMsg> MsgCache::get_send_utxos_msg()
     std::scoped_lock lock(mutex);
     return send_utxos_msg;
 }
+
+void MsgCache::set_send_fee_histogram_msg(std::shared_ptr<SendFeeHistogramMsg> msg)
+{
+    std::scoped_lock lock(mutex);
+    send_fee_histogram_msg = std::move(msg);
+}
+
+std::shared_ptr<SendFeeHistogramMsg> MsgCache::get_send_fee_histogram_msg()
+{
+    std::scoped_lock lock(mutex);
+    return send_fee_histogram_msg;
+}
@@ -3,6 +3,7 @@
 #include <mutex>
 
 #include "net/send_active_chain_msg.hpp"
+#include "net/send_fee_histogram_msg.hpp"
 #include "net/send_mempool_msg.hpp"
 #include "net/send_utxos_msg.hpp"
 
@@ -18,12 +19,16 @@ public:
 	static void set_send_utxos_msg(std::shared_ptr<SendUTXOsMsg> msg);
 	static std::shared_ptr<SendUTXOsMsg> get_send_utxos_msg();
 
+	static void set_send_fee_histogram_msg(std::shared_ptr<SendFeeHistogramMsg> msg);
+	static std::shared_ptr<SendFeeHistogramMsg> get_send_fee_histogram_msg();
+
 	static constexpr uint16_t MAX_MSG_AWAIT_TIME_IN_SECS = 60;
 
 private:
 	static std::shared_ptr<SendActiveChainMsg> send_active_chain_msg;
 	static std::shared_ptr<SendMempoolMsg> send_mempool_msg;
 	static std::shared_ptr<SendUTXOsMsg> send_utxos_msg;
+	static std::shared_ptr<SendFeeHistogramMsg> send_fee_histogram_msg;
 
 	static std::mutex mutex;
 };
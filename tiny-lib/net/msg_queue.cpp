@@ -0,0 +1,277 @@
+#include "net/msg_queue.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "net/tx_info_msg.hpp"
+#include "util/log.hpp"
+
+std::mutex MsgQueue::mutex;
+std::condition_variable MsgQueue::cv;
+bool MsgQueue::running = false;
+std::vector<boost::thread> MsgQueue::workers;
+
+std::unordered_map<std::shared_ptr<Connection>, MsgQueue::PeerQueue> MsgQueue::peers;
+std::array<std::list<std::shared_ptr<Connection>>, MsgQueue::PRIORITY_COUNT> MsgQueue::ready;
+std::array<size_t, MsgQueue::PRIORITY_COUNT> MsgQueue::skips{};
+
+MsgQueue::Priority MsgQueue::get_priority(Opcode opcode)
+{
+	switch (opcode)
+	{
+		case Opcode::PeerHelloMsg:
+		case Opcode::PeerAddMsg:
+		case Opcode::SendActiveChainMsg:
+		case Opcode::SendMempoolMsg:
+		case Opcode::SendUTXOsMsg:
+		case Opcode::SendFeeHistogramMsg:
+			return Priority::Control;
+		case Opcode::BlockInfoMsg:
+		case Opcode::InvMsg:
+		case Opcode::HeadersMsg:
+		case Opcode::BlocksMsg:
+			return Priority::Block;
+		case Opcode::TxInfoMsg:
+			return Priority::Tx;
+		default:
+			return Priority::Request;
+	}
+}
+
+void MsgQueue::start(uint32_t worker_count)
+{
+	std::scoped_lock lock(mutex);
+
+	if (running)
+		return;
+
+	running = true;
+	worker_count = std::max(worker_count, 1u);
+	for (uint32_t i = 0; i < worker_count; i++)
+		workers.emplace_back(&MsgQueue::run_worker);
+}
+
+void MsgQueue::stop()
+{
+	{
+		std::scoped_lock lock(mutex);
+
+		running = false;
+	}
+	cv.notify_all();
+
+	for (auto& worker : workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+	workers.clear();
+
+	std::scoped_lock lock(mutex);
+
+	peers.clear();
+	for (auto& peers_ready : ready)
+		peers_ready.clear();
+	skips.fill(0);
+}
+
+bool MsgQueue::push(const std::shared_ptr<Connection>& con, std::unique_ptr<IMsg> msg, size_t size,
+	std::function<void()> resume_reading)
+{
+	const auto priority = static_cast<size_t>(get_priority(msg->get_opcode()));
+
+	std::scoped_lock lock(mutex);
+
+	auto& peer = peers[con];
+	if (peer.msgs[priority].empty())
+		ready[priority].push_back(con);
+	peer.msgs[priority].push_back(QueuedMsg{ std::move(msg), size });
+	peer.queued_bytes += size;
+	peer.pending_count++;
+
+	cv.notify_one();
+
+	if (peer.queued_bytes < MAX_QUEUED_BYTES_PER_PEER)
+		return true;
+
+	peer.resume_reading = std::move(resume_reading);
+
+	return false;
+}
+
+void MsgQueue::erase_peer(const std::shared_ptr<Connection>& con)
+{
+	std::scoped_lock lock(mutex);
+
+	const auto peer_it = peers.find(con);
+	if (peer_it == peers.end())
+		return;
+
+	auto& peer = peer_it->second;
+	for (size_t priority = 0; priority < PRIORITY_COUNT; priority++)
+	{
+		for (const auto& queued : peer.msgs[priority])
+		{
+			peer.queued_bytes -= queued.size;
+			peer.pending_count--;
+		}
+		peer.msgs[priority].clear();
+		ready[priority].remove(con);
+	}
+	peer.resume_reading = nullptr;
+
+	// A message being handled is accounted for when it finishes
+	if (!peer.busy)
+		peers.erase(peer_it);
+}
+
+size_t MsgQueue::get_pending_count()
+{
+	std::scoped_lock lock(mutex);
+
+	size_t pending_count = 0;
+	for (const auto& [con, peer] : peers)
+		pending_count += peer.pending_count;
+
+	return pending_count;
+}
+
+void MsgQueue::run_worker()
+{
+	while (true)
+	{
+		std::shared_ptr<Connection> con;
+		std::vector<QueuedMsg> batch;
+		{
+			std::unique_lock lock(mutex);
+
+			cv.wait(lock, [&con, &batch] { return !running || take_next(con, batch); });
+			if (!running)
+				return;
+		}
+
+		handle(con, batch);
+
+		finish(con, batch);
+	}
+}
+
+bool MsgQueue::take_next(std::shared_ptr<Connection>& con, std::vector<QueuedMsg>& batch)
+{
+	// The lowest overdue priority first, as it has waited the longest
+	for (size_t priority = PRIORITY_COUNT; priority-- > 0;)
+	{
+		if (skips[priority] >= MAX_PRIORITY_SKIPS && take_next(priority, con, batch))
+			return true;
+	}
+
+	for (size_t priority = 0; priority < PRIORITY_COUNT; priority++)
+	{
+		if (take_next(priority, con, batch))
+			return true;
+	}
+
+	return false;
+}
+
+bool MsgQueue::take_next(size_t priority, std::shared_ptr<Connection>& con, std::vector<QueuedMsg>& batch)
+{
+	const auto is_tx_info = [](const QueuedMsg& queued)
+	{
+		return dynamic_cast<const TxInfoMsg*>(queued.msg.get()) != nullptr;
+	};
+
+	auto& peers_ready = ready[priority];
+	for (auto it = peers_ready.begin(); it != peers_ready.end(); ++it)
+	{
+		auto& peer = peers.at(*it);
+		if (peer.busy)
+			continue;
+
+		auto& msgs = peer.msgs[priority];
+		con = *it;
+		do
+		{
+			batch.push_back(std::move(msgs.front()));
+			msgs.pop_front();
+		} while (!msgs.empty() && batch.size() < MAX_TX_BATCH && is_tx_info(batch.front()) &&
+			is_tx_info(msgs.front()));
+		peer.busy = true;
+
+		// The peer goes to the back of the line
+		if (msgs.empty())
+			peers_ready.erase(it);
+		else
+			peers_ready.splice(peers_ready.end(), peers_ready, it);
+
+		skips[priority] = 0;
+		for (size_t lower = priority + 1; lower < PRIORITY_COUNT; lower++)
+		{
+			if (!ready[lower].empty())
+				skips[lower]++;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void MsgQueue::handle(const std::shared_ptr<Connection>& con, const std::vector<QueuedMsg>& batch)
+{
+	const auto opcode = batch.front().msg->get_opcode();
+
+	try
+	{
+		if (batch.size() == 1)
+		{
+			batch.front().msg->handle(con);
+		}
+		else
+		{
+			std::vector<std::shared_ptr<Tx>> txs;
+			txs.reserve(batch.size());
+			for (const auto& queued : batch)
+				txs.push_back(static_cast<const TxInfoMsg&>(*queued.msg).tx);
+
+			TxInfoMsg::handle_batch(con, txs);
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		LOG_ERROR("Unable to handle opcode {}: {}", static_cast<OpcodeType>(opcode), ex.what());
+	}
+}
+
+void MsgQueue::finish(const std::shared_ptr<Connection>& con, const std::vector<QueuedMsg>& batch)
+{
+	std::function<void()> resume_reading;
+	{
+		std::scoped_lock lock(mutex);
+
+		const auto peer_it = peers.find(con);
+		if (peer_it != peers.end())
+		{
+			auto& peer = peer_it->second;
+			peer.busy = false;
+			for (const auto& queued : batch)
+				peer.queued_bytes -= queued.size;
+			peer.pending_count -= batch.size();
+
+			if (peer.resume_reading && peer.queued_bytes <= MAX_QUEUED_BYTES_PER_PEER / 2)
+			{
+				resume_reading = std::move(peer.resume_reading);
+				peer.resume_reading = nullptr;
+			}
+
+			if (peer.pending_count == 0)
+				peers.erase(peer_it);
+		}
+	}
+	// The peer's other messages may be taken now
+	cv.notify_all();
+
+	if (resume_reading)
+		resume_reading();
+}
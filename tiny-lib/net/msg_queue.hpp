@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+#include "net/connection.hpp"
+#include "net/i_msg.hpp"
+#include "net/opcodes.hpp"
+
+// Work queue between the io threads, which only frame and deserialize messages, and a pool of
+// workers that handle them. Messages are taken by priority, round robin between peers within a
+// priority, and a peer's messages are never handled concurrently. A priority passed over too many
+// times in a row is served next, so a flood of blocks or txs delays requests but cannot starve them.
+class MsgQueue
+{
+public:
+	// Lower is handled first
+	enum class Priority : uint8_t
+	{
+		// Handshake and replies someone is waiting on
+		Control,
+		Block,
+		Tx,
+		// Requests from peers, some of which serialize the whole chain or UTXO set
+		Request
+	};
+
+	static constexpr size_t PRIORITY_COUNT = 4;
+
+	// Reading from a peer is paused once this much of its traffic awaits handling
+	static constexpr size_t MAX_QUEUED_BYTES_PER_PEER = 8 * 1024 * 1024;
+	// TxInfoMsgs queued in a row by one peer are taken together, up to this many, and admitted as a batch
+	static constexpr size_t MAX_TX_BATCH = 64;
+	// Messages of a priority that waited while this many of higher ones were taken are taken next
+	static constexpr size_t MAX_PRIORITY_SKIPS = 16;
+
+	static Priority get_priority(Opcode opcode);
+
+	static void start(uint32_t worker_count);
+	// Joins the workers and drops whatever is still queued
+	static void stop();
+
+	// Returns false if the peer is now over MAX_QUEUED_BYTES_PER_PEER, in which case the caller
+	// should stop reading from it until resume_reading is called
+	static bool push(const std::shared_ptr<Connection>& con, std::unique_ptr<IMsg> msg, size_t size,
+		std::function<void()> resume_reading);
+
+	static void erase_peer(const std::shared_ptr<Connection>& con);
+
+	// Queued and in progress messages
+	static size_t get_pending_count();
+
+private:
+	struct QueuedMsg
+	{
+		std::unique_ptr<IMsg> msg;
+		size_t size = 0;
+	};
+
+	struct PeerQueue
+	{
+		std::array<std::deque<QueuedMsg>, PRIORITY_COUNT> msgs;
+		size_t queued_bytes = 0;
+		size_t pending_count = 0;
+		// A worker is handling one of its messages
+		bool busy = false;
+		// Set while reading is paused
+		std::function<void()> resume_reading;
+	};
+
+	static std::mutex mutex;
+	static std::condition_variable cv;
+	static bool running;
+	static std::vector<boost::thread> workers;
+
+	static std::unordered_map<std::shared_ptr<Connection>, PeerQueue> peers;
+	// Peers with messages of each priority, in the order they are served
+	static std::array<std::list<std::shared_ptr<Connection>>, PRIORITY_COUNT> ready;
+	// Messages taken ahead of each priority since it was last served
+	static std::array<size_t, PRIORITY_COUNT> skips;
+
+	static void run_worker();
+	// Called with the mutex held
+	static bool take_next(std::shared_ptr<Connection>& con, std::vector<QueuedMsg>& batch);
+	static bool take_next(size_t priority, std::shared_ptr<Connection>& con, std::vector<QueuedMsg>& batch);
+	static void handle(const std::shared_ptr<Connection>& con, const std::vector<QueuedMsg>& batch);
+	static void finish(const std::shared_ptr<Connection>& con, const std::vector<QueuedMsg>& batch);
+};
@@ -1,5 +1,7 @@
 #include "net/msg_serializer.hpp"
 
+#include <utility>
+
 #include "util/binary_buffer.hpp"
 #include "crypto/sha256.hpp"
 #include "core/tx_out.hpp"
@@ -9,16 +11,33 @@ std::vector<uint8_t> MsgSerializer::build_spend_msg(const std::shared_ptr<TxOutP
 	const std::vector<uint8_t>& pub_key, int32_t sequence,
 	const std::vector<std::shared_ptr<TxOut>>& tx_outs)
 {
-	BinaryBuffer spend_message;
-	spend_message.write_raw(to_spend->serialize().get_buffer());
-	spend_message.write(sequence);
-	spend_message.write(pub_key);
-	for (const auto& tx_out : tx_outs)
-	{
-		spend_message.write_raw(tx_out->serialize().get_buffer());
-	}
+	return build_spend_msg(to_spend, pub_key, sequence, serialize_tx_outs(tx_outs));
+}
+
+std::vector<uint8_t> MsgSerializer::build_spend_msg(const std::shared_ptr<TxOutPoint>& to_spend,
+	const std::vector<uint8_t>& pub_key, int32_t sequence,
+	const std::vector<uint8_t>& serialized_tx_outs)
+{
+	SHA256::Hasher hasher;
+	hasher.update(to_spend->serialize().get_buffer());
 
-	const auto& buffer = spend_message.get_buffer();
+	BinaryBuffer sequence_and_pub_key;
+	sequence_and_pub_key.write(sequence);
+	sequence_and_pub_key.write(pub_key);
+	hasher.update(sequence_and_pub_key.get_buffer());
+
+	hasher.update(serialized_tx_outs);
+
+	const auto hash = hasher.finalize_double();
+
+	return { hash.begin(), hash.end() };
+}
+
+std::vector<uint8_t> MsgSerializer::serialize_tx_outs(const std::vector<std::shared_ptr<TxOut>>& tx_outs)
+{
+	BinaryBuffer buffer;
+	for (const auto& tx_out : tx_outs)
+		buffer.write_raw(tx_out->serialize_legacy().get_buffer());
 
-	return SHA256::double_hash_binary(buffer);
+	return std::move(buffer.get_writable_buffer());
 }
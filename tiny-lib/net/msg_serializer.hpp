@@ -12,4 +12,11 @@ public:
 	static std::vector<uint8_t> build_spend_msg(const std::shared_ptr<TxOutPoint>& to_spend,
 		const std::vector<uint8_t>& pub_key, int32_t sequence,
 		const std::vector<std::shared_ptr<TxOut>>& tx_outs);
+	// Takes the outputs as encoded by serialize_tx_outs, so a tx with many inputs encodes them once
+	static std::vector<uint8_t> build_spend_msg(const std::shared_ptr<TxOutPoint>& to_spend,
+		const std::vector<uint8_t>& pub_key, int32_t sequence,
+		const std::vector<uint8_t>& serialized_tx_outs);
+
+	// Legacy encoding of every output, back to back, as covered by the spend message
+	static std::vector<uint8_t> serialize_tx_outs(const std::vector<std::shared_ptr<TxOut>>& tx_outs);
 };
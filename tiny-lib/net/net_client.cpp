@@ -3,20 +3,29 @@
 #include <algorithm>
 #include <cstring>
 #include <boost/bind/bind.hpp>
+#include <boost/endian/conversion.hpp>
 
 #include "util/binary_buffer.hpp"
 #include "net/block_info_msg.hpp"
+#include "net/blocks_msg.hpp"
 #include "net/get_active_chain_msg.hpp"
 #include "net/get_block_msg.hpp"
+#include "net/get_blocks_msg.hpp"
+#include "net/get_fee_histogram_msg.hpp"
+#include "net/get_headers_msg.hpp"
 #include "net/get_mempool_msg.hpp"
 #include "net/get_utxos_msg.hpp"
+#include "net/headers_msg.hpp"
 #include "net/i_msg.hpp"
 #include "net/inv_msg.hpp"
 #include "util/log.hpp"
+#include "core/mempool.hpp"
+#include "net/msg_queue.hpp"
 #include "net/peer_add_msg.hpp"
 #include "net/peer_hello_msg.hpp"
 #include "util/random.hpp"
 #include "net/send_active_chain_msg.hpp"
+#include "net/send_fee_histogram_msg.hpp"
 #include "net/send_mempool_msg.hpp"
 #include "net/send_utxos_msg.hpp"
 #include "crypto/sha256.hpp"
@@ -35,12 +44,36 @@ std::vector<std::shared_ptr<Connection>> NetClient::connections;
 std::vector<std::shared_ptr<Connection>> NetClient::miner_connections;
 
 boost::asio::io_context NetClient::io_context;
-boost::thread NetClient::io_thread;
+boost::thread_group NetClient::io_threads;
 boost::asio::ip::tcp::acceptor NetClient::acceptor = boost::asio::ip::tcp::acceptor(io_context);
 
-void NetClient::run_async()
+boost::asio::steady_timer NetClient::mempool_expiry_timer = boost::asio::steady_timer(io_context);
+
+void NetClient::run_async(uint32_t io_thread_count, uint32_t msg_worker_count)
+{
+	MsgQueue::start(msg_worker_count);
+
+	start_mempool_expiry_timer();
+
+	io_thread_count = std::max(io_thread_count, 1u);
+	for (uint32_t i = 0; i < io_thread_count; i++)
+		io_threads.create_thread(boost::bind(&boost::asio::io_context::run, &io_context));
+
+	LOG_INFO("Running network on {} io thread(s)", io_thread_count);
+}
+
+void NetClient::start_mempool_expiry_timer()
 {
-	io_thread = boost::thread(boost::bind(&boost::asio::io_context::run, &io_context));
+	mempool_expiry_timer.expires_after(std::chrono::seconds(MEMPOOL_EXPIRY_INTERVAL_SECS));
+	mempool_expiry_timer.async_wait([](const boost::system::error_code& err)
+	{
+		if (err)
+			return;
+
+		Mempool::expire_old_transactions();
+
+		start_mempool_expiry_timer();
+	});
 }
 
 void NetClient::stop()
@@ -62,8 +95,9 @@ void NetClient::stop()
 	}
 
 	io_context.stop();
-	if (io_thread.joinable())
-		io_thread.join();
+	io_threads.join_all();
+
+	MsgQueue::stop();
 
 	{
 		std::scoped_lock lock(connections_mutex);
@@ -92,7 +126,7 @@ void NetClient::connect(const std::string& address, uint16_t port)
 		connections.push_back(con);
 	}
 	send_msg(con, PeerHelloMsg());
-	do_async_read_header(con);
+	boost::asio::post(con->strand, [con] { do_async_read_header(con); });
 }
 
 void NetClient::listen_async(uint16_t port)
@@ -107,9 +141,7 @@ void NetClient::listen_async(uint16_t port)
 
 void NetClient::send_msg(const std::shared_ptr<Connection>& con, const IMsg& msg)
 {
-	const auto msg_buffer = prepare_send_buffer(msg);
-
-	write(con, msg_buffer);
+	write(con, frame_msg(msg));
 }
 
 bool NetClient::send_msg_random(const IMsg& msg)
@@ -125,13 +157,18 @@ bool NetClient::send_msg_random(const IMsg& msg)
 
 void NetClient::broadcast_msg(const IMsg& msg)
 {
-	const auto msg_buffer = prepare_send_buffer(msg);
+	const auto framed_msg = frame_msg(msg);
 
-	std::scoped_lock lock(connections_mutex);
+	std::vector<std::shared_ptr<Connection>> miner_connections_snapshot;
+	{
+		std::scoped_lock lock(connections_mutex);
+
+		miner_connections_snapshot = miner_connections;
+	}
 
-	for (auto& con : miner_connections)
+	for (const auto& con : miner_connections_snapshot)
 	{
-		write(con, msg_buffer);
+		write(con, framed_msg);
 	}
 }
 
@@ -169,7 +206,7 @@ void NetClient::handle_accept(std::shared_ptr<Connection> con, const boost::syst
 			connections.push_back(con);
 		}
 		send_msg(con, PeerHelloMsg());
-		do_async_read_header(con);
+		boost::asio::post(con->strand, [con] { do_async_read_header(con); });
 	}
 	else
 	{
@@ -256,14 +293,14 @@ void NetClient::handle_read_payload(std::shared_ptr<Connection> con, uint32_t pa
 				con->read_buffer.data());
 			con->read_buffer.consume(payload_length);
 
-			const auto hash = SHA256::double_hash_binary(buffer.get_buffer());
+			const auto hash = SHA256::double_hash(buffer.get_buffer());
 			if (std::memcmp(hash.data(), expected_checksum.data(), CHECKSUM_SIZE) != 0)
 			{
 				LOG_ERROR("Checksum mismatch, dropping message");
 			}
-			else
+			else if (!handle_msg(con, buffer))
 			{
-				handle_msg(con, buffer);
+				return;
 			}
 		}
 
@@ -279,14 +316,14 @@ void NetClient::handle_read_payload(std::shared_ptr<Connection> con, uint32_t pa
 	}
 }
 
-void NetClient::handle_msg(const std::shared_ptr<Connection>& con, BinaryBuffer& msg_buffer)
+bool NetClient::handle_msg(const std::shared_ptr<Connection>& con, BinaryBuffer& msg_buffer)
 {
 	OpcodeType opcode = 0;
 	if (!msg_buffer.read(opcode))
 	{
 		LOG_ERROR("No opcode");
 
-		return;
+		return true;
 	}
 	auto opcode2 = static_cast<Opcode>(opcode);
 
@@ -365,11 +402,47 @@ void NetClient::handle_msg(const std::shared_ptr<Connection>& con, BinaryBuffer&
 
 			break;
 		}
+		case Opcode::GetHeadersMsg:
+		{
+			msg = std::make_unique<GetHeadersMsg>();
+
+			break;
+		}
+		case Opcode::HeadersMsg:
+		{
+			msg = std::make_unique<HeadersMsg>();
+
+			break;
+		}
+		case Opcode::GetBlocksMsg:
+		{
+			msg = std::make_unique<GetBlocksMsg>();
+
+			break;
+		}
+		case Opcode::BlocksMsg:
+		{
+			msg = std::make_unique<BlocksMsg>();
+
+			break;
+		}
+		case Opcode::GetFeeHistogramMsg:
+		{
+			msg = std::make_unique<GetFeeHistogramMsg>();
+
+			break;
+		}
+		case Opcode::SendFeeHistogramMsg:
+		{
+			msg = std::make_unique<SendFeeHistogramMsg>();
+
+			break;
+		}
 		default:
 		{
 			LOG_ERROR("Unknown opcode {}", static_cast<OpcodeType>(opcode2));
 
-			return;
+			return true;
 		}
 	}
 
@@ -377,75 +450,152 @@ void NetClient::handle_msg(const std::shared_ptr<Connection>& con, BinaryBuffer&
 	{
 		LOG_ERROR("Unable to deserialize opcode {}", static_cast<OpcodeType>(opcode2));
 
-		return;
+		return true;
 	}
-	msg->handle(con);
+
+	auto resume_reading = [con] { boost::asio::post(con->strand, [con] { do_async_read_header(con); }); };
+	if (MsgQueue::push(con, std::move(msg), msg_buffer.get_size(), std::move(resume_reading)))
+		return true;
+
+	LOG_TRACE("Peer has over {} bytes of messages queued, pausing reads", MsgQueue::MAX_QUEUED_BYTES_PER_PEER);
+
+	return false;
 }
 
-BinaryBuffer NetClient::prepare_send_buffer(const IMsg& msg)
+std::shared_ptr<const FramedMsg> NetClient::frame_msg(const IMsg& msg)
 {
-	const auto serialized = msg.serialize();
-	const auto& serialized_msg = serialized.get_buffer();
+	auto serialized = msg.serialize();
 	const auto opcode = static_cast<OpcodeType>(msg.get_opcode());
-	const auto payload_length = static_cast<uint32_t>(sizeof(opcode) + serialized_msg.size());
 
-	std::vector<uint8_t> payload;
-	payload.reserve(payload_length);
-	payload.push_back(opcode);
-	payload.insert(payload.end(), serialized_msg.begin(), serialized_msg.end());
+	auto framed_msg = std::make_shared<FramedMsg>();
+	// Taken over rather than copied, the header being sent as a separate buffer
+	framed_msg->body = std::move(serialized.get_writable_buffer());
+
+	const auto payload_length = boost::endian::native_to_little(
+		static_cast<uint32_t>(sizeof(opcode) + framed_msg->body.size()));
+	const auto hash = SHA256::Hasher()
+		.update(std::span(&opcode, 1))
+		.update(framed_msg->body)
+		.finalize_double();
+
+	auto& header = framed_msg->header;
+	header.resize(HEADER_SIZE + sizeof(opcode));
+	std::memcpy(header.data(), magic.data(), MAGIC_SIZE);
+	std::memcpy(header.data() + MAGIC_SIZE, &payload_length, sizeof(payload_length));
+	std::memcpy(header.data() + MAGIC_SIZE + sizeof(payload_length), hash.data(), CHECKSUM_SIZE);
+	header[HEADER_SIZE] = opcode;
+
+	return framed_msg;
+}
+
+void NetClient::write(const std::shared_ptr<Connection>& con, const std::shared_ptr<const FramedMsg>& framed_msg)
+{
+	const auto msg_size = framed_msg->size();
+	{
+		std::scoped_lock lock(con->write_mutex);
+
+		if (con->queued_bytes + msg_size <= MAX_SEND_QUEUE_BYTES)
+		{
+			con->send_queue.push_back(framed_msg);
+			con->queued_bytes += msg_size;
+
+			if (!con->write_in_progress)
+			{
+				con->write_in_progress = true;
+				boost::asio::post(con->strand, [con] { start_write(con); });
+			}
+
+			return;
+		}
+	}
+
+	LOG_WARN("Peer send queue over {} bytes, disconnecting", MAX_SEND_QUEUE_BYTES);
+
+	remove_connection(con);
+}
 
-	const auto hash = SHA256::double_hash_binary(payload);
+void NetClient::start_write(const std::shared_ptr<Connection>& con)
+{
+	std::scoped_lock lock(con->write_mutex);
 
-	BinaryBuffer msg_buffer;
-	msg_buffer.reserve(static_cast<uint32_t>(HEADER_SIZE + payload_length));
-	msg_buffer.write_raw(std::vector<uint8_t>(magic.begin(), magic.end()));
-	msg_buffer.write(payload_length);
-	msg_buffer.write_raw(std::vector<uint8_t>(hash.begin(), hash.begin() + CHECKSUM_SIZE));
-	msg_buffer.write_raw(payload);
+	std::vector<boost::asio::const_buffer> buffers;
+	while (!con->send_queue.empty() && con->writing.size() < MAX_WRITE_BATCH)
+	{
+		con->writing.push_back(std::move(con->send_queue.front()));
+		con->send_queue.pop_front();
+	}
+	buffers.reserve(2 * con->writing.size());
+	for (const auto& framed_msg : con->writing)
+	{
+		buffers.emplace_back(boost::asio::buffer(framed_msg->header));
+		buffers.emplace_back(boost::asio::buffer(framed_msg->body));
+	}
 
-	return msg_buffer;
+	boost::asio::async_write(con->socket, buffers, [con](const boost::system::error_code& err, size_t)
+	{
+		handle_write(con, err);
+	});
 }
 
-void NetClient::write(const std::shared_ptr<Connection>& con, const BinaryBuffer& msg_buffer)
+void NetClient::handle_write(const std::shared_ptr<Connection>& con, const boost::system::error_code& err)
 {
-	boost::system::error_code err;
+	bool more_queued = false;
 	{
 		std::scoped_lock lock(con->write_mutex);
 
-		boost::asio::write(con->socket, boost::asio::buffer(msg_buffer.get_buffer()), err);
+		for (const auto& framed_msg : con->writing)
+			con->queued_bytes -= framed_msg->size();
+		con->writing.clear();
+
+		more_queued = !err && !con->send_queue.empty();
+		con->write_in_progress = more_queued;
 	}
-	if (err)
-	{
-		if (err != boost::asio::error::shut_down && err != boost::asio::error::connection_reset && err !=
-			boost::asio::error::operation_aborted)
-			LOG_ERROR(err.message());
 
-		remove_connection(con);
+	if (more_queued)
+	{
+		start_write(con);
+		return;
 	}
+	if (!err)
+		return;
+
+	if (err != boost::asio::error::shut_down && err != boost::asio::error::connection_reset && err !=
+		boost::asio::error::operation_aborted)
+		LOG_ERROR(err.message());
+
+	remove_connection(con);
 }
 
 void NetClient::remove_connection(const std::shared_ptr<Connection>& con)
 {
+	// Before taking connections_mutex, as admission holds the mempool lock while relaying
+	Mempool::erase_orphans_from_peer(con);
+	MsgQueue::erase_peer(con);
+
 	std::scoped_lock lock(connections_mutex);
 
 	const auto vec_it = std::find(connections.begin(), connections.end(), con);
 	if (vec_it != connections.end())
 	{
-		auto& soc = con->socket;
-
-		if (soc.is_open())
+		// On the strand, as the peer's handlers may be using the socket on another io thread
+		boost::asio::dispatch(con->strand, [con]
 		{
-			boost::system::error_code ec;
-			const auto endpoint = soc.remote_endpoint(ec);
-			if (!ec)
+			auto& soc = con->socket;
+
+			if (soc.is_open())
 			{
-				LOG_TRACE("Peer {}:{} disconnected", endpoint.address().to_string(),
-					endpoint.port());
-			}
+				boost::system::error_code ec;
+				const auto endpoint = soc.remote_endpoint(ec);
+				if (!ec)
+				{
+					LOG_TRACE("Peer {}:{} disconnected", endpoint.address().to_string(),
+						endpoint.port());
+				}
 
-			soc.shutdown(boost::asio::socket_base::shutdown_both, ec);
-			soc.close(ec);
-		}
+				soc.shutdown(boost::asio::socket_base::shutdown_both, ec);
+				soc.close(ec);
+			}
+		});
 		if (con->node_type & NodeType::Miner)
 		{
 			const auto vec_it2 = std::find(miner_connections.begin(), miner_connections.end(), con);
@@ -10,16 +10,22 @@
 #include <boost/thread/thread.hpp>
 
 #include "net/connection.hpp"
+#include "net/framed_msg.hpp"
 #include "net/i_msg.hpp"
 
 class BinaryBuffer;
 
 class NetClient
 {
+	friend class NetClientTest;
+
 public:
 	static const std::vector<std::pair<std::string, uint16_t>> initial_peers;
 
-	static void run_async();
+	// Serves the network on a pool of io threads and handles messages on a pool of workers, at least
+	// one of each
+	static void run_async(uint32_t io_thread_count = boost::thread::hardware_concurrency(),
+		uint32_t msg_worker_count = boost::thread::hardware_concurrency());
 	static void stop();
 
 	static void connect(const std::string& address, uint16_t port);
@@ -41,10 +47,21 @@ private:
 	static constexpr uint32_t MAX_PAYLOAD_SIZE = 4 * 1024 * 1024;
 	static constexpr std::array<uint8_t, MAGIC_SIZE> magic = { 0xf9, 0xbe, 0xb4, 0xd9 };
 
+	// A peer with more than this much unsent data is not keeping up and gets disconnected
+	static constexpr size_t MAX_SEND_QUEUE_BYTES = 4 * MAX_PAYLOAD_SIZE;
+	// Queued messages gathered into one async_write, two buffers each to stay within asio's
+	// scatter/gather limit of 64
+	static constexpr size_t MAX_WRITE_BATCH = 32;
+
 	static boost::asio::io_context io_context;
-	static boost::thread io_thread;
+	static boost::thread_group io_threads;
 	static boost::asio::ip::tcp::acceptor acceptor;
 
+	static constexpr int64_t MEMPOOL_EXPIRY_INTERVAL_SECS = 60;
+	static boost::asio::steady_timer mempool_expiry_timer;
+
+	static void start_mempool_expiry_timer();
+
 	static std::vector<std::shared_ptr<Connection>> connections;
 
 	static std::shared_ptr<Connection> get_random_connection();
@@ -62,10 +79,17 @@ private:
 		std::array<uint8_t, CHECKSUM_SIZE> expected_checksum,
 		const boost::system::error_code& err, size_t bytes_transferred);
 
-	static void handle_msg(const std::shared_ptr<Connection>& con, BinaryBuffer& msg_buffer);
-
-	static BinaryBuffer prepare_send_buffer(const IMsg& msg);
-	static void write(const std::shared_ptr<Connection>& con, const BinaryBuffer& msg_buffer);
+	// Deserializes the message and queues it for the workers. Returns false if reading from the
+	// peer should pause until its queue drains.
+	static bool handle_msg(const std::shared_ptr<Connection>& con, BinaryBuffer& msg_buffer);
+
+	// Serializes and checksums the message once for any number of peers
+	static std::shared_ptr<const FramedMsg> frame_msg(const IMsg& msg);
+	// Queues the message and returns at once, the queue being drained on the io thread
+	static void write(const std::shared_ptr<Connection>& con, const std::shared_ptr<const FramedMsg>& framed_msg);
+	// Runs on the connection's strand
+	static void start_write(const std::shared_ptr<Connection>& con);
+	static void handle_write(const std::shared_ptr<Connection>& con, const boost::system::error_code& err);
 
 	static void remove_connection(const std::shared_ptr<Connection>& con);
 };
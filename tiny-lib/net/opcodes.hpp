@@ -15,7 +15,13 @@ enum class Opcode : uint8_t
 	SendActiveChainMsg,
 	SendMempoolMsg,
 	SendUTXOsMsg,
-	TxInfoMsg
+	TxInfoMsg,
+	GetHeadersMsg,
+	HeadersMsg,
+	GetBlocksMsg,
+	BlocksMsg,
+	GetFeeHistogramMsg,
+	SendFeeHistogramMsg
 };
 
 using OpcodeType = std::underlying_type_t<Opcode>;
@@ -0,0 +1,56 @@
+#include "net/send_fee_histogram_msg.hpp"
+
+#include "net/msg_cache.hpp"
+
+SendFeeHistogramMsg::SendFeeHistogramMsg(const std::vector<FeeRateHistogram::Bucket>& buckets)
+	: buckets(buckets)
+{}
+
+void SendFeeHistogramMsg::handle([[maybe_unused]] const std::shared_ptr<Connection>& con)
+{
+	MsgCache::set_send_fee_histogram_msg(std::make_shared<SendFeeHistogramMsg>(*this));
+}
+
+BinaryBuffer SendFeeHistogramMsg::serialize() const
+{
+	BinaryBuffer buffer;
+
+	buffer.write_size(static_cast<uint32_t>(buckets.size()));
+	for (const auto& bucket : buckets)
+	{
+		buffer.write(bucket.idx);
+		buffer.write(bucket.tx_count);
+		buffer.write(bucket.fee_rate_sum);
+	}
+
+	return buffer;
+}
+
+bool SendFeeHistogramMsg::deserialize(BinaryBuffer& buffer)
+{
+	uint32_t bucket_count = 0;
+	if (!buffer.read_size(bucket_count))
+		return false;
+
+	if (bucket_count > FeeRateHistogram::get_bucket_bounds().size())
+		return false;
+
+	std::vector<FeeRateHistogram::Bucket> new_buckets(bucket_count);
+	for (auto& bucket : new_buckets)
+	{
+		if (!buffer.read(bucket.idx) || !buffer.read(bucket.tx_count) || !buffer.read(bucket.fee_rate_sum))
+			return false;
+	}
+
+	if (!FeeRateHistogram::are_valid_buckets(new_buckets))
+		return false;
+
+	buckets = std::move(new_buckets);
+
+	return true;
+}
+
+Opcode SendFeeHistogramMsg::get_opcode() const
+{
+	return Opcode::SendFeeHistogramMsg;
+}
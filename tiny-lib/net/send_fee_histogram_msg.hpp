@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+
+#include "mining/fee_rate_histogram.hpp"
+#include "net/i_msg.hpp"
+
+class SendFeeHistogramMsg : public IMsg
+{
+public:
+	SendFeeHistogramMsg() = default;
+	SendFeeHistogramMsg(const std::vector<FeeRateHistogram::Bucket>& buckets);
+
+	~SendFeeHistogramMsg() override = default;
+
+	// Non-empty buckets of the sender's mempool fee rate histogram
+	std::vector<FeeRateHistogram::Bucket> buckets;
+
+	void handle(const std::shared_ptr<Connection>& con) override;
+	BinaryBuffer serialize() const override;
+	bool deserialize(BinaryBuffer& buffer) override;
+
+	Opcode get_opcode() const override;
+};
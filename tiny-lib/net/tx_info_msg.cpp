@@ -13,7 +13,16 @@ void TxInfoMsg::handle(const std::shared_ptr<Connection>& con)
 	LOG_TRACE("Received transaction {} from peer {}:{}", tx->id(), endpoint.address().to_string(),
 		endpoint.port());
 
-	Mempool::add_tx_to_mempool(tx);
+	Mempool::add_tx_to_mempool(tx, con);
+}
+
+void TxInfoMsg::handle_batch(const std::shared_ptr<Connection>& con, const std::vector<std::shared_ptr<Tx>>& txs)
+{
+	const auto endpoint = con->socket.remote_endpoint();
+	LOG_TRACE("Received {} transactions from peer {}:{}", txs.size(), endpoint.address().to_string(),
+		endpoint.port());
+
+	Mempool::add_txs_to_mempool(txs, con);
 }
 
 BinaryBuffer TxInfoMsg::serialize() const
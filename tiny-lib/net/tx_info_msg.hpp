@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <vector>
 
 #include "net/i_msg.hpp"
 #include "core/tx.hpp"
@@ -15,6 +16,8 @@ public:
 	std::shared_ptr<Tx> tx;
 
 	void handle(const std::shared_ptr<Connection>& con) override;
+	// For txs received in a row from one peer, which are admitted together with their signatures checked in parallel
+	static void handle_batch(const std::shared_ptr<Connection>& con, const std::vector<std::shared_ptr<Tx>>& txs);
 	BinaryBuffer serialize() const override;
 	bool deserialize(BinaryBuffer& buffer) override;
 
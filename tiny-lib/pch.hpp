@@ -31,7 +31,6 @@
 #include <vector>
 
 #include <boost/asio.hpp>
-#include <boost/multiprecision/cpp_int.hpp>
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
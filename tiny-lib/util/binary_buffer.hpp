@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <string>
@@ -116,6 +117,14 @@ public:
 		}
 	}
 
+	template <size_t N>
+	void write_raw(const std::array<uint8_t, N>& obj)
+	{
+		grow_if_needed(static_cast<uint32_t>(N));
+		std::memcpy(buffer_.data() + write_offset_, obj.data(), N);
+		write_offset_ += static_cast<uint32_t>(N);
+	}
+
 	void write(const std::string& obj);
 
 	void write_raw(const std::string& obj);
@@ -189,6 +198,22 @@ public:
 		return true;
 	}
 
+	template <size_t N>
+	bool read_raw(std::array<uint8_t, N>& obj)
+	{
+		if (N > UINT32_MAX - read_offset_)
+			return false;
+
+		const uint32_t final_offset = read_offset_ + static_cast<uint32_t>(N);
+		if (buffer_.size() < final_offset)
+			return false;
+
+		std::memcpy(obj.data(), buffer_.data() + read_offset_, N);
+		read_offset_ = final_offset;
+
+		return true;
+	}
+
 	bool read(std::string& obj);
 
 	bool operator==(const BinaryBuffer& obj) const;
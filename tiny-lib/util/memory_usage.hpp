@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Estimates of the heap memory held by standard containers, assuming a 64-bit glibc malloc and
+// libstdc++ node layouts. Used to bound memory rather than serialized bytes.
+class MemoryUsage
+{
+public:
+	// A malloc'd block carries 8 bytes of header and is rounded up to a multiple of 16
+	static constexpr size_t malloc_usage(size_t alloc)
+	{
+		return alloc == 0 ? 0 : ((alloc + 31) >> 4) << 4;
+	}
+
+	static constexpr size_t dynamic_usage(const std::string& str)
+	{
+		// Up to 15 chars are stored inline
+		return str.capacity() > 15 ? malloc_usage(str.capacity() + 1) : 0;
+	}
+
+	template<typename T>
+	static constexpr size_t dynamic_usage(const std::vector<T>& vec)
+	{
+		return malloc_usage(vec.capacity() * sizeof(T));
+	}
+
+	// Object allocated by std::make_shared together with its control block
+	template<typename T>
+	static constexpr size_t shared_usage()
+	{
+		return malloc_usage(sizeof(T) + 2 * sizeof(int) + sizeof(void*));
+	}
+
+	// Node of a std::set or std::map: colour, parent, left and right ahead of the value
+	template<typename T>
+	static constexpr size_t tree_node_usage()
+	{
+		return malloc_usage(sizeof(T) + 4 * sizeof(void*));
+	}
+
+	// Node of a std::unordered_set or std::unordered_map: next pointer, value and cached hash
+	template<typename T>
+	static constexpr size_t hash_node_usage()
+	{
+		return malloc_usage(sizeof(void*) + sizeof(T) + sizeof(size_t));
+	}
+
+	static constexpr size_t bucket_usage(size_t bucket_count)
+	{
+		// A single bucket is stored inline
+		return bucket_count > 1 ? malloc_usage(bucket_count * sizeof(void*)) : 0;
+	}
+};
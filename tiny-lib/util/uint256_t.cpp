@@ -0,0 +1,56 @@
+#include "util/uint256_t.hpp"
+
+#include <algorithm>
+
+std::optional<uint256_t> uint256_t::from_hex(std::string_view hex)
+{
+	if (hex.starts_with("0x") || hex.starts_with("0X"))
+		hex.remove_prefix(2);
+
+	if (hex.empty() || hex.size() > BYTE_SIZE * 2)
+		return std::nullopt;
+
+	uint256_t result;
+	for (size_t i = 0; i < hex.size(); i++)
+	{
+		const char c = hex[hex.size() - 1 - i];
+		uint64_t nibble;
+		if (c >= '0' && c <= '9')
+			nibble = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			nibble = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			nibble = c - 'A' + 10;
+		else
+			return std::nullopt;
+
+		result.limbs_[i / 16] |= nibble << (4 * (i % 16));
+	}
+	return result;
+}
+
+std::string uint256_t::str() const
+{
+	if (is_zero())
+		return "0";
+
+	// Peel off 19 decimal digits at a time so most of the work is 64-bit
+	constexpr uint64_t CHUNK = 10000000000000000000ULL;
+
+	std::string result;
+	uint256_t value = *this;
+	while (!value.is_zero())
+	{
+		const auto [quotient, remainder] = div_mod(value, uint256_t(CHUNK));
+		uint64_t chunk = remainder.low64();
+		value = quotient;
+		for (int i = 0; i < 19 && (chunk != 0 || !value.is_zero()); i++)
+		{
+			result.push_back(static_cast<char>('0' + chunk % 10));
+			chunk /= 10;
+		}
+	}
+	std::ranges::reverse(result);
+
+	return result;
+}
@@ -1,4 +1,243 @@
 #pragma once
-#include <boost/multiprecision/cpp_int.hpp>
+#include <array>
+#include <bit>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
 
-using uint256_t = boost::multiprecision::uint256_t;
+// Fixed-width unsigned 256-bit integer stored as four little-endian 64-bit limbs. Arithmetic wraps
+// modulo 2^256 like the built-in unsigned types.
+class uint256_t
+{
+public:
+	static constexpr size_t LIMB_COUNT = 4;
+	static constexpr size_t BYTE_SIZE = 32;
+	static constexpr uint32_t BIT_SIZE = 256;
+
+	constexpr uint256_t() = default;
+	constexpr uint256_t(uint64_t value)
+		: limbs_{ value, 0, 0, 0 }
+	{}
+
+	// Big-endian, i.e. the order digests are printed in and block ids are compared in
+	static constexpr uint256_t from_be_bytes(std::span<const uint8_t, BYTE_SIZE> bytes)
+	{
+		uint256_t result;
+		for (size_t i = 0; i < BYTE_SIZE; i++)
+			result.limbs_[LIMB_COUNT - 1 - i / 8] |= static_cast<uint64_t>(bytes[i]) << (56 - 8 * (i % 8));
+		return result;
+	}
+
+	constexpr std::array<uint8_t, BYTE_SIZE> to_be_bytes() const
+	{
+		std::array<uint8_t, BYTE_SIZE> bytes{};
+		for (size_t i = 0; i < BYTE_SIZE; i++)
+			bytes[i] = static_cast<uint8_t>(limbs_[LIMB_COUNT - 1 - i / 8] >> (56 - 8 * (i % 8)));
+		return bytes;
+	}
+
+	// Up to 64 hex digits, optionally prefixed with "0x". Empty if anything else is found.
+	static std::optional<uint256_t> from_hex(std::string_view hex);
+
+	// Decimal representation
+	std::string str() const;
+
+	constexpr bool is_zero() const
+	{
+		return (limbs_[0] | limbs_[1] | limbs_[2] | limbs_[3]) == 0;
+	}
+
+	// Number of significant bits, 0 for zero
+	constexpr uint32_t bit_length() const
+	{
+		for (size_t i = LIMB_COUNT; i-- > 0;)
+		{
+			if (limbs_[i] != 0)
+				return static_cast<uint32_t>(i * 64) + (64 - static_cast<uint32_t>(std::countl_zero(limbs_[i])));
+		}
+		return 0;
+	}
+
+	constexpr uint64_t low64() const
+	{
+		return limbs_[0];
+	}
+
+	constexpr bool operator==(const uint256_t& obj) const = default;
+
+	constexpr std::strong_ordering operator<=>(const uint256_t& obj) const
+	{
+		for (size_t i = LIMB_COUNT; i-- > 0;)
+		{
+			if (limbs_[i] != obj.limbs_[i])
+				return limbs_[i] < obj.limbs_[i] ? std::strong_ordering::less : std::strong_ordering::greater;
+		}
+		return std::strong_ordering::equal;
+	}
+
+	constexpr uint256_t operator~() const
+	{
+		uint256_t result;
+		for (size_t i = 0; i < LIMB_COUNT; i++)
+			result.limbs_[i] = ~limbs_[i];
+		return result;
+	}
+
+	constexpr uint256_t& operator<<=(uint32_t shift)
+	{
+		if (shift >= BIT_SIZE)
+			return *this = uint256_t();
+
+		const size_t limb_shift = shift / 64;
+		const uint32_t bit_shift = shift % 64;
+		for (size_t i = LIMB_COUNT; i-- > 0;)
+		{
+			uint64_t limb = 0;
+			if (i >= limb_shift)
+			{
+				limb = limbs_[i - limb_shift] << bit_shift;
+				if (bit_shift != 0 && i > limb_shift)
+					limb |= limbs_[i - limb_shift - 1] >> (64 - bit_shift);
+			}
+			limbs_[i] = limb;
+		}
+		return *this;
+	}
+
+	constexpr uint256_t& operator>>=(uint32_t shift)
+	{
+		if (shift >= BIT_SIZE)
+			return *this = uint256_t();
+
+		const size_t limb_shift = shift / 64;
+		const uint32_t bit_shift = shift % 64;
+		for (size_t i = 0; i < LIMB_COUNT; i++)
+		{
+			uint64_t limb = 0;
+			if (i + limb_shift < LIMB_COUNT)
+			{
+				limb = limbs_[i + limb_shift] >> bit_shift;
+				if (bit_shift != 0 && i + limb_shift + 1 < LIMB_COUNT)
+					limb |= limbs_[i + limb_shift + 1] << (64 - bit_shift);
+			}
+			limbs_[i] = limb;
+		}
+		return *this;
+	}
+
+	constexpr uint256_t& operator+=(const uint256_t& obj)
+	{
+		uint64_t carry = 0;
+		for (size_t i = 0; i < LIMB_COUNT; i++)
+		{
+			const uint64_t sum = limbs_[i] + obj.limbs_[i];
+			const uint64_t carry_out = sum < limbs_[i] ? 1 : 0;
+			limbs_[i] = sum + carry;
+			carry = carry_out | (limbs_[i] < sum ? 1 : 0);
+		}
+		return *this;
+	}
+
+	constexpr uint256_t& operator-=(const uint256_t& obj)
+	{
+		uint64_t borrow = 0;
+		for (size_t i = 0; i < LIMB_COUNT; i++)
+		{
+			const uint64_t diff = limbs_[i] - obj.limbs_[i];
+			const uint64_t borrow_out = limbs_[i] < obj.limbs_[i] ? 1 : 0;
+			limbs_[i] = diff - borrow;
+			borrow = borrow_out | (diff < borrow ? 1 : 0);
+		}
+		return *this;
+	}
+
+	constexpr uint256_t& operator*=(const uint256_t& obj)
+	{
+		std::array<uint64_t, LIMB_COUNT> result{};
+		for (size_t i = 0; i < LIMB_COUNT; i++)
+		{
+			uint64_t carry = 0;
+			for (size_t j = 0; i + j < LIMB_COUNT; j++)
+			{
+				auto [lo, hi] = mul_wide(limbs_[i], obj.limbs_[j]);
+				lo += carry;
+				hi += lo < carry ? 1 : 0;
+				result[i + j] += lo;
+				hi += result[i + j] < lo ? 1 : 0;
+				carry = hi;
+			}
+		}
+		limbs_ = result;
+		return *this;
+	}
+
+	// Shift-subtract long division, only as many rounds as the dividend has bits. Division by
+	// zero yields zero.
+	constexpr uint256_t& operator/=(const uint256_t& obj)
+	{
+		*this = div_mod(*this, obj).first;
+		return *this;
+	}
+
+	constexpr uint256_t& operator%=(const uint256_t& obj)
+	{
+		*this = div_mod(*this, obj).second;
+		return *this;
+	}
+
+	friend constexpr uint256_t operator<<(uint256_t lhs, uint32_t shift) { return lhs <<= shift; }
+	friend constexpr uint256_t operator>>(uint256_t lhs, uint32_t shift) { return lhs >>= shift; }
+	friend constexpr uint256_t operator+(uint256_t lhs, const uint256_t& rhs) { return lhs += rhs; }
+	friend constexpr uint256_t operator-(uint256_t lhs, const uint256_t& rhs) { return lhs -= rhs; }
+	friend constexpr uint256_t operator*(uint256_t lhs, const uint256_t& rhs) { return lhs *= rhs; }
+	friend constexpr uint256_t operator/(uint256_t lhs, const uint256_t& rhs) { return lhs /= rhs; }
+	friend constexpr uint256_t operator%(uint256_t lhs, const uint256_t& rhs) { return lhs %= rhs; }
+
+private:
+	std::array<uint64_t, LIMB_COUNT> limbs_{};
+
+	static constexpr std::pair<uint64_t, uint64_t> mul_wide(uint64_t a, uint64_t b)
+	{
+		const uint64_t a_lo = a & 0xFFFFFFFF;
+		const uint64_t a_hi = a >> 32;
+		const uint64_t b_lo = b & 0xFFFFFFFF;
+		const uint64_t b_hi = b >> 32;
+
+		const uint64_t lo_lo = a_lo * b_lo;
+		const uint64_t hi_lo = a_hi * b_lo;
+		const uint64_t lo_hi = a_lo * b_hi;
+		const uint64_t hi_hi = a_hi * b_hi;
+
+		const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+		const uint64_t lo = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+		const uint64_t hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+
+		return { lo, hi };
+	}
+
+	static constexpr std::pair<uint256_t, uint256_t> div_mod(const uint256_t& dividend, const uint256_t& divisor)
+	{
+		if (divisor.is_zero() || dividend < divisor)
+			return { uint256_t(), divisor.is_zero() ? uint256_t() : dividend };
+
+		uint256_t quotient;
+		uint256_t remainder;
+		for (uint32_t bit = dividend.bit_length(); bit-- > 0;)
+		{
+			const bool carry = (remainder.limbs_[LIMB_COUNT - 1] >> 63) != 0;
+			remainder <<= 1;
+			remainder.limbs_[0] |= (dividend.limbs_[bit / 64] >> (bit % 64)) & 1;
+			if (carry || remainder >= divisor)
+			{
+				remainder -= divisor;
+				quotient.limbs_[bit / 64] |= uint64_t(1) << (bit % 64);
+			}
+		}
+		return { quotient, remainder };
+	}
+};
@@ -3,12 +3,12 @@
 #include <chrono>
 #include <boost/algorithm/hex.hpp>
 
-std::string Utils::byte_array_to_hex_string(const std::vector<uint8_t>& vec)
+std::string Utils::byte_array_to_hex_string(std::span<const uint8_t> bytes)
 {
 	std::string hash;
-	hash.reserve(vec.size() * 2);
+	hash.reserve(bytes.size() * 2);
 
-	boost::algorithm::hex_lower(vec, std::back_inserter(hash));
+	boost::algorithm::hex_lower(bytes.begin(), bytes.end(), std::back_inserter(hash));
 
 	return hash;
 }
@@ -1,13 +1,14 @@
 #pragma once
 #include <bit>
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
 class Utils
 {
 public:
-	static std::string byte_array_to_hex_string(const std::vector<uint8_t>& vec);
+	static std::string byte_array_to_hex_string(std::span<const uint8_t> bytes);
 	static std::vector<uint8_t> hex_string_to_byte_array(const std::string& str);
 	static std::vector<uint8_t> string_to_byte_array(const std::string& str);
 
@@ -27,8 +27,7 @@ std::vector<uint8_t> ExtendedKey::get_fingerprint() const
     if (pub_key.empty())
         return { 0, 0, 0, 0 };
 
-    const auto sha = SHA256::hash_binary(pub_key);
-    const auto ripe = RIPEMD160::hash_binary(sha);
+    const auto ripe = RIPEMD160::hash(SHA256::hash(pub_key));
 
     return { ripe[0], ripe[1], ripe[2], ripe[3] };
 }
@@ -39,8 +38,6 @@ ExtendedKey HDKeyChain::from_seed(const std::vector<uint8_t>& seed)
     const std::vector<uint8_t> hmac_key(hmac_key_str.begin(), hmac_key_str.end());
 
     const auto I = HMACSHA512::hash(hmac_key, seed);
-    if (I.size() != 64)
-        throw std::runtime_error("HMAC-SHA512 failed during master key generation");
 
     ExtendedKey master;
     master.key = pad_key_32(std::vector<uint8_t>(I.begin(), I.begin() + 32));
@@ -88,8 +85,6 @@ ExtendedKey HDKeyChain::derive_child(const ExtendedKey& parent, uint32_t index)
     data.insert(data.end(), index_bytes.begin(), index_bytes.end());
 
     const auto I = HMACSHA512::hash(parent.chain_code, data);
-    if (I.size() != 64)
-        throw std::runtime_error("HMAC-SHA512 failed during child key derivation");
 
     const std::vector<uint8_t> IL(I.begin(), I.begin() + 32);
     const std::vector<uint8_t> IR(I.begin() + 32, I.end());
@@ -13,16 +13,19 @@
 #include "core/chain.hpp"
 #include "crypto/ecdsa.hpp"
 #include "net/get_active_chain_msg.hpp"
+#include "net/get_fee_histogram_msg.hpp"
 #include "net/get_mempool_msg.hpp"
 #include "net/get_utxos_msg.hpp"
 #include "util/log.hpp"
 #include "core/mempool.hpp"
+#include "mining/fee_estimator.hpp"
 #include "net/msg_cache.hpp"
 #include "core/net_params.hpp"
 #include "net/msg_serializer.hpp"
 #include "net/net_client.hpp"
 #include "crypto/ripemd160.hpp"
 #include "net/send_active_chain_msg.hpp"
+#include "net/send_fee_histogram_msg.hpp"
 #include "net/send_mempool_msg.hpp"
 #include "net/send_utxos_msg.hpp"
 #include "crypto/sha256.hpp"
@@ -37,20 +40,33 @@ std::string Wallet::hd_wallet_path = DEFAULT_HD_WALLET_PATH;
 
 std::string Wallet::pub_key_to_address(const std::vector<uint8_t>& pub_key)
 {
-	const auto sha256 = SHA256::hash_binary(pub_key);
+	return pub_key_hash_to_address(pub_key_to_hash(pub_key));
+}
 
-	const auto ripe = RIPEMD160::hash_binary(sha256);
+Wallet::PubKeyHash Wallet::pub_key_to_hash(const std::vector<uint8_t>& pub_key)
+{
+	return RIPEMD160::hash(SHA256::hash(pub_key));
+}
 
-	std::vector<uint8_t> versioned_ripe;
-	versioned_ripe.reserve(1 + ripe.size() + 4);
-	versioned_ripe.push_back(0x00);
-	versioned_ripe.insert(versioned_ripe.end(), ripe.begin(), ripe.end());
+std::string Wallet::pub_key_hash_to_address(const PubKeyHash& pub_key_hash)
+{
+	std::array<uint8_t, 1 + std::tuple_size_v<PubKeyHash>> versioned_hash;
+	versioned_hash[0] = ADDRESS_VERSION;
+	std::ranges::copy(pub_key_hash, versioned_hash.begin() + 1);
 
-	const auto sha256d = SHA256::double_hash_binary(versioned_ripe);
+	return Base58::encode_check(versioned_hash);
+}
 
-	versioned_ripe.insert(versioned_ripe.end(), sha256d.begin(), sha256d.begin() + 4);
+std::optional<Wallet::PubKeyHash> Wallet::address_to_pub_key_hash(const std::string& address)
+{
+	std::array<uint8_t, 1 + std::tuple_size_v<PubKeyHash>> versioned_hash;
+	if (!Base58::decode_check(address, versioned_hash) || versioned_hash[0] != ADDRESS_VERSION)
+		return std::nullopt;
+
+	PubKeyHash pub_key_hash;
+	std::copy(versioned_hash.begin() + 1, versioned_hash.end(), pub_key_hash.begin());
 
-	return Base58::encode(versioned_ripe);
+	return pub_key_hash;
 }
 
 std::tuple<std::vector<uint8_t>, std::vector<uint8_t>, std::string> Wallet::get_wallet(const std::string& wallet_path)
@@ -125,7 +141,16 @@ std::shared_ptr<TxIn> Wallet::build_tx_in(const std::vector<uint8_t>& priv_key,
 	const std::vector<std::shared_ptr<TxOut>>& tx_outs,
 	int32_t sequence)
 {
-	const auto spend_msg = MsgSerializer::build_spend_msg(tx_out_point, pub_key, sequence, tx_outs);
+	return build_tx_in(priv_key, pub_key, tx_out_point, MsgSerializer::serialize_tx_outs(tx_outs), sequence);
+}
+
+std::shared_ptr<TxIn> Wallet::build_tx_in(const std::vector<uint8_t>& priv_key,
+	const std::vector<uint8_t>& pub_key,
+	const std::shared_ptr<TxOutPoint>& tx_out_point,
+	const std::vector<uint8_t>& serialized_tx_outs,
+	int32_t sequence)
+{
+	const auto spend_msg = MsgSerializer::build_spend_msg(tx_out_point, pub_key, sequence, serialized_tx_outs);
 	auto unlock_sig = ECDSA::sign_msg(spend_msg, priv_key);
 
 	return std::make_shared<TxIn>(tx_out_point, unlock_sig, pub_key, sequence);
@@ -317,17 +342,19 @@ std::shared_ptr<Tx> Wallet::build_rbf_replacement(const std::shared_ptr<Tx>& ori
 	{
 		if (i < original_tx->tx_outs.size() - 1)
 			new_tx_outs.push_back(std::make_shared<TxOut>(original_tx->tx_outs[i]->value,
-				original_tx->tx_outs[i]->to_address));
+				original_tx->tx_outs[i]->to_pub_key_hash));
 		else
 			new_tx_outs.push_back(std::make_shared<TxOut>(new_change,
-				original_tx->tx_outs[i]->to_address));
+				original_tx->tx_outs[i]->to_pub_key_hash));
 	}
 
+	const auto serialized_tx_outs = MsgSerializer::serialize_tx_outs(new_tx_outs);
 	std::vector<std::shared_ptr<TxIn>> new_tx_ins;
 	new_tx_ins.reserve(original_tx->tx_ins.size());
 	for (const auto& old_in : original_tx->tx_ins)
 	{
-		new_tx_ins.emplace_back(build_tx_in(priv_key, pub_key, old_in->to_spend, new_tx_outs, TxIn::SEQUENCE_RBF));
+		new_tx_ins.emplace_back(build_tx_in(priv_key, pub_key, old_in->to_spend, serialized_tx_outs,
+			TxIn::SEQUENCE_RBF));
 	}
 
 	auto replacement = std::make_shared<Tx>(new_tx_ins, new_tx_outs, original_tx->lock_time);
@@ -513,6 +540,59 @@ void Wallet::print_balance(const std::string& address)
 	LOG_INFO("Address {} holds {} coins", address, balance);
 }
 
+std::shared_ptr<FeeRateHistogram> Wallet::get_mempool_fee_histogram()
+{
+	MsgCache::set_send_fee_histogram_msg(nullptr);
+
+	if (!NetClient::send_msg_random(GetFeeHistogramMsg()))
+	{
+		LOG_ERROR("No connection to ask fee histogram");
+
+		return nullptr;
+	}
+
+	auto start = Utils::get_unix_timestamp();
+	std::shared_ptr<SendFeeHistogramMsg> cached_fee_histogram_msg;
+	while (true)
+	{
+		cached_fee_histogram_msg = MsgCache::get_send_fee_histogram_msg();
+		if (cached_fee_histogram_msg != nullptr)
+			break;
+		if (Utils::get_unix_timestamp() - start > MsgCache::MAX_MSG_AWAIT_TIME_IN_SECS)
+		{
+			LOG_ERROR("Timeout on GetFeeHistogramMsg");
+
+			return nullptr;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(16));
+	}
+
+	return std::make_shared<FeeRateHistogram>(cached_fee_histogram_msg->buckets);
+}
+
+void Wallet::print_fee_estimate()
+{
+	const uint64_t high = FeeEstimator::estimate_fee_rate(1);
+	const uint64_t medium = FeeEstimator::estimate_fee_rate(3);
+	const uint64_t low = FeeEstimator::estimate_fee_rate(6);
+	LOG_INFO("Fee estimates (coins/byte): high={} (1 block), medium={} (3 blocks), low={} (6 blocks)",
+		high, medium, low);
+
+	const auto histogram = get_mempool_fee_histogram();
+	if (histogram == nullptr)
+		return;
+
+	if (histogram->get_tx_count() == 0)
+	{
+		LOG_INFO("Peer mempool is empty");
+
+		return;
+	}
+
+	LOG_INFO("Peer mempool fee rates (coins/byte) over {} txs: p10={}, p50={}, p90={}", histogram->get_tx_count(),
+		*histogram->get_percentile(0.1), *histogram->get_percentile(0.5), *histogram->get_percentile(0.9));
+}
+
 std::vector<std::shared_ptr<UTXO>> Wallet::branch_and_bound_select(const std::vector<std::shared_ptr<UTXO>>& utxos,
 	uint64_t target, uint64_t cost_of_change)
 {
@@ -636,6 +716,14 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos(std::vector<std::shared_ptr<UTXO
 	const std::vector<uint8_t>& priv_key, const std::vector<uint8_t>& pub_key,
 	int64_t lock_time)
 {
+	const auto to_pub_key_hash = address_to_pub_key_hash(address);
+	if (!to_pub_key_hash)
+	{
+		LOG_ERROR("Invalid address {}", address);
+
+		return nullptr;
+	}
+
 	const uint32_t total_size_est = 300;
 	const uint64_t total_fee_est = total_size_est * fee;
 	const uint64_t target = value + total_fee_est;
@@ -675,7 +763,7 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos(std::vector<std::shared_ptr<UTXO
 		in_sum += coin->tx_out->value;
 
 	std::vector<std::shared_ptr<TxOut>> tx_outs;
-	const auto tx_out = std::make_shared<TxOut>(value, address);
+	const auto tx_out = std::make_shared<TxOut>(value, *to_pub_key_hash);
 	tx_outs.push_back(tx_out);
 
 	if (!exact_match)
@@ -685,11 +773,13 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos(std::vector<std::shared_ptr<UTXO
 		tx_outs.push_back(tx_out_change);
 	}
 
+	const auto serialized_tx_outs = MsgSerializer::serialize_tx_outs(tx_outs);
 	std::vector<std::shared_ptr<TxIn>> tx_ins;
 	tx_ins.reserve(selected_utxos.size());
 	for (const auto& selected_coin : selected_utxos)
 	{
-		tx_ins.emplace_back(build_tx_in(priv_key, pub_key, selected_coin->tx_out_point, tx_outs));
+		tx_ins.emplace_back(build_tx_in(priv_key, pub_key, selected_coin->tx_out_point, serialized_tx_outs,
+			TxIn::SEQUENCE_RBF));
 	}
 	auto tx = std::make_shared<Tx>(tx_ins, tx_outs, lock_time);
 	const uint32_t tx_size = tx->serialize().get_size();
@@ -728,6 +818,10 @@ std::shared_ptr<Tx> Wallet::build_tx(uint64_t value, uint64_t fee, const std::st
 
 std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_address_miner(const std::string& address)
 {
+	const auto pub_key_hash = address_to_pub_key_hash(address);
+	if (!pub_key_hash)
+		return {};
+
 	std::vector<std::shared_ptr<UTXO>> utxos;
 	{
 		std::scoped_lock lock(UTXO::mutex);
@@ -735,7 +829,7 @@ std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_address_miner(const st
 		const uint32_t current_height = Chain::get_current_height();
 		for (const auto& v : UTXO::map | std::views::values)
 		{
-			if (v->tx_out->to_address == address)
+			if (v->tx_out->to_pub_key_hash == *pub_key_hash)
 			{
 				if (v->is_coinbase && current_height - v->height < NetParams::COINBASE_MATURITY)
 					continue;
@@ -748,6 +842,10 @@ std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_address_miner(const st
 
 std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_address(const std::string& address)
 {
+	const auto pub_key_hash = address_to_pub_key_hash(address);
+	if (!pub_key_hash)
+		return {};
+
 	MsgCache::set_send_utxos_msg(nullptr);
 
 	if (!NetClient::send_msg_random(GetUTXOsMsg()))
@@ -776,7 +874,7 @@ std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_address(const std::str
 	std::vector<std::shared_ptr<UTXO>> utxos;
 	for (const auto& v : cached_utxos_msg->utxo_map | std::views::values)
 	{
-		if (v->tx_out->to_address == address)
+		if (v->tx_out->to_pub_key_hash == *pub_key_hash)
 		{
 			utxos.push_back(v);
 		}
@@ -882,6 +980,13 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos_hd(std::vector<std::shared_ptr<U
 	uint64_t value, uint64_t fee, const std::string& address,
 	HDWallet& hd_wallet, int64_t lock_time)
 {
+	const auto to_pub_key_hash = address_to_pub_key_hash(address);
+	if (!to_pub_key_hash)
+	{
+		LOG_ERROR("Invalid address {}", address);
+		return nullptr;
+	}
+
 	const uint32_t total_size_est = 300;
 	const uint64_t total_fee_est = total_size_est * fee;
 	const uint64_t target = value + total_fee_est;
@@ -922,7 +1027,7 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos_hd(std::vector<std::shared_ptr<U
 	const auto change_address = hd_wallet.get_change_address();
 
 	std::vector<std::shared_ptr<TxOut>> tx_outs;
-	const auto tx_out = std::make_shared<TxOut>(value, address);
+	const auto tx_out = std::make_shared<TxOut>(value, *to_pub_key_hash);
 	tx_outs.push_back(tx_out);
 
 	if (!exact_match)
@@ -932,11 +1037,12 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos_hd(std::vector<std::shared_ptr<U
 		tx_outs.push_back(tx_out_change);
 	}
 
+	const auto serialized_tx_outs = MsgSerializer::serialize_tx_outs(tx_outs);
 	std::vector<std::shared_ptr<TxIn>> tx_ins;
 	tx_ins.reserve(selected_utxos.size());
 	for (const auto& selected_coin : selected_utxos)
 	{
-		const auto& utxo_address = selected_coin->tx_out->to_address;
+		const auto utxo_address = selected_coin->tx_out->to_address();
 
 		std::vector<uint8_t> priv_key;
 		std::vector<uint8_t> pub_key;
@@ -946,7 +1052,8 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos_hd(std::vector<std::shared_ptr<U
 			return nullptr;
 		}
 
-		tx_ins.emplace_back(build_tx_in(priv_key, pub_key, selected_coin->tx_out_point, tx_outs));
+		tx_ins.emplace_back(build_tx_in(priv_key, pub_key, selected_coin->tx_out_point, serialized_tx_outs,
+			TxIn::SEQUENCE_RBF));
 	}
 
 	auto tx = std::make_shared<Tx>(tx_ins, tx_outs, lock_time);
@@ -958,16 +1065,16 @@ std::shared_ptr<Tx> Wallet::build_tx_from_utxos_hd(std::vector<std::shared_ptr<U
 
 std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_hd_wallet_miner(HDWallet& hd_wallet)
 {
-	const auto addresses = hd_wallet.get_all_addresses();
+	const auto pub_key_hashes = get_pub_key_hashes(hd_wallet);
 	std::vector<std::shared_ptr<UTXO>> utxos;
 	{
 		std::scoped_lock lock(UTXO::mutex);
 
 		for (const auto& v : UTXO::map | std::views::values)
 		{
-			for (const auto& addr : addresses)
+			for (const auto& pub_key_hash : pub_key_hashes)
 			{
-				if (v->tx_out->to_address == addr)
+				if (v->tx_out->to_pub_key_hash == pub_key_hash)
 				{
 					utxos.push_back(v);
 					break;
@@ -1003,13 +1110,13 @@ std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_hd_wallet(HDWallet& hd
 		std::this_thread::sleep_for(std::chrono::milliseconds(16));
 	}
 
-	const auto addresses = hd_wallet.get_all_addresses();
+	const auto pub_key_hashes = get_pub_key_hashes(hd_wallet);
 	std::vector<std::shared_ptr<UTXO>> utxos;
 	for (const auto& v : cached_utxos_msg->utxo_map | std::views::values)
 	{
-		for (const auto& addr : addresses)
+		for (const auto& pub_key_hash : pub_key_hashes)
 		{
-			if (v->tx_out->to_address == addr)
+			if (v->tx_out->to_pub_key_hash == pub_key_hash)
 			{
 				utxos.push_back(v);
 				break;
@@ -1018,3 +1125,17 @@ std::vector<std::shared_ptr<UTXO>> Wallet::find_utxos_for_hd_wallet(HDWallet& hd
 	}
 	return utxos;
 }
+
+std::vector<Wallet::PubKeyHash> Wallet::get_pub_key_hashes(const HDWallet& hd_wallet)
+{
+	const auto addresses = hd_wallet.get_all_addresses();
+
+	std::vector<PubKeyHash> pub_key_hashes;
+	pub_key_hashes.reserve(addresses.size());
+	for (const auto& addr : addresses)
+	{
+		if (const auto pub_key_hash = address_to_pub_key_hash(addr))
+			pub_key_hashes.push_back(*pub_key_hash);
+	}
+	return pub_key_hashes;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -10,6 +11,8 @@
 #include "core/tx_in.hpp"
 #include "core/tx_out.hpp"
 #include "core/tx_out_point.hpp"
+#include "crypto/ripemd160.hpp"
+#include "mining/fee_rate_histogram.hpp"
 #include "wallet/hd_wallet.hpp"
 
 class UnspentTxOut;
@@ -17,7 +20,16 @@ class UnspentTxOut;
 class Wallet
 {
 public:
+	using PubKeyHash = RIPEMD160::Hash;
+
+	static constexpr uint8_t ADDRESS_VERSION = 0x00;
+
 	static std::string pub_key_to_address(const std::vector<uint8_t>& pub_key);
+	// RIPEMD160(SHA256(pub_key)), the payload of an address
+	static PubKeyHash pub_key_to_hash(const std::vector<uint8_t>& pub_key);
+	static std::string pub_key_hash_to_address(const PubKeyHash& pub_key_hash);
+	// Empty if the address is not valid Base58Check with the expected version byte
+	static std::optional<PubKeyHash> address_to_pub_key_hash(const std::string& address);
 
 	static std::tuple<std::vector<uint8_t>, std::vector<uint8_t>, std::string>
 		get_wallet(const std::string& wallet_path);
@@ -35,6 +47,12 @@ public:
 		const std::shared_ptr<TxOutPoint>& tx_out_point,
 		const std::vector<std::shared_ptr<TxOut>>& tx_outs,
 		int32_t sequence);
+	// Takes the outputs as encoded by MsgSerializer::serialize_tx_outs, for signing several inputs
+	static std::shared_ptr<TxIn> build_tx_in(const std::vector<uint8_t>& priv_key,
+		const std::vector<uint8_t>& pub_key,
+		const std::shared_ptr<TxOutPoint>& tx_out_point,
+		const std::vector<uint8_t>& serialized_tx_outs,
+		int32_t sequence);
 	static std::shared_ptr<Tx> send_value_miner(uint64_t value, uint64_t fee, const std::string& address,
 		const std::vector<uint8_t>& priv_key, int64_t lock_time = 0);
 	static std::shared_ptr<Tx> send_value(uint64_t value, uint64_t fee, const std::string& address,
@@ -69,6 +87,10 @@ public:
 	static uint64_t get_balance(const std::string& address);
 	static void print_balance(const std::string& address);
 
+	// Fee rate histogram of a peer's mempool, nullptr if no peer answered
+	static std::shared_ptr<FeeRateHistogram> get_mempool_fee_histogram();
+	static void print_fee_estimate();
+
 private:
 	static constexpr char DEFAULT_WALLET_PATH[] = "wallet.dat";
 	static constexpr char DEFAULT_HD_WALLET_PATH[] = "hd_wallet.dat";
@@ -109,4 +131,6 @@ private:
 
 	static std::vector<std::shared_ptr<UnspentTxOut>> find_utxos_for_hd_wallet_miner(HDWallet& hd_wallet);
 	static std::vector<std::shared_ptr<UnspentTxOut>> find_utxos_for_hd_wallet(HDWallet& hd_wallet);
+
+	static std::vector<PubKeyHash> get_pub_key_hashes(const HDWallet& hd_wallet);
 };
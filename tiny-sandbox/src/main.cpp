@@ -5,9 +5,11 @@
 #include <vector>
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "util/log.hpp"
 #include "crypto/crypto.hpp"
+#include "core/mempool.hpp"
 #include "mining/fee_estimator.hpp"
 #include "net/net_client.hpp"
 #include "wallet/node_config.hpp"
@@ -19,6 +21,8 @@ namespace po = boost::program_options;
 void atexit_handler()
 {
 	NetClient::stop();
+	if (NodeConfig::type == NodeType::Miner)
+		Mempool::save_to_disk();
 	Crypto::cleanup();
 	Log::stop_log();
 }
@@ -34,6 +38,10 @@ int main(int argc, char** argv)
 	desc.add_options()
 		("node_type", po::value<std::string>(), "specify node type")
 		("port", po::value<uint16_t>(), "port to listen on network connections")
+		("io_threads", po::value<uint32_t>()->default_value(boost::thread::hardware_concurrency()),
+			"number of threads serving network connections")
+		("msg_workers", po::value<uint32_t>()->default_value(boost::thread::hardware_concurrency()),
+			"number of threads handling received messages")
 		("wallet", po::value<std::string>(), "path to wallet");
 
 	po::variables_map vm;
@@ -79,7 +87,7 @@ int main(int argc, char** argv)
 		: Wallet::init_wallet();
 	const auto port = vm["port"].as<uint16_t>();
 	NetClient::listen_async(port);
-	NetClient::run_async();
+	NetClient::run_async(vm["io_threads"].as<uint32_t>(), vm["msg_workers"].as<uint32_t>());
 
 	std::vector<std::future<void>> pending_connections;
 	for (const auto& [k, v] : NetClient::initial_peers)
@@ -186,11 +194,7 @@ int main(int argc, char** argv)
 			}
 			else if (command.starts_with(fee_estimate))
 			{
-				const uint64_t high = FeeEstimator::estimate_fee_rate(1);
-				const uint64_t medium = FeeEstimator::estimate_fee_rate(3);
-				const uint64_t low = FeeEstimator::estimate_fee_rate(6);
-				LOG_INFO("Fee estimates (coins/byte): high={} (1 block), medium={} (3 blocks), low={} (6 blocks)",
-					high, medium, low);
+				Wallet::print_fee_estimate();
 			}
 			else
 			{
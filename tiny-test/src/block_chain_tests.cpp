@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <ranges>
@@ -11,8 +12,10 @@
 #include "util/exceptions.hpp"
 #include "core/mempool.hpp"
 #include "core/net_params.hpp"
+#include "mining/fee_estimator.hpp"
 #include "mining/merkle_tree.hpp"
 #include "mining/pow.hpp"
+#include "net/block_sync.hpp"
 #include "core/tx.hpp"
 #include "core/tx_in.hpp"
 #include "core/tx_out.hpp"
@@ -143,14 +146,173 @@ const auto chain2 = std::vector{
 	chain1_block1, chain2_block2, chain2_block3, chain2_block4, chain2_block5
 };
 
+TEST_F(BlockChainTest, MedianTimePastCacheFollowsConnectAndDisconnect)
+{
+	auto expect_cached_mtp_matches_chain = []()
+	{
+		for (uint32_t height = 0; height < Chain::active_chain.size(); height++)
+		{
+			const uint32_t first_idx = height + 1 > NetParams::MEDIAN_TIME_PAST_BLOCKS
+				? height + 1 - NetParams::MEDIAN_TIME_PAST_BLOCKS
+				: 0;
+			std::vector<int64_t> timestamps;
+			for (uint32_t i = first_idx; i <= height; i++)
+				timestamps.push_back(Chain::active_chain[i]->timestamp);
+			std::ranges::sort(timestamps);
+
+			EXPECT_EQ(timestamps[timestamps.size() / 2], Chain::get_median_time_past_at_height(height));
+		}
+	};
+
+	for (const auto& block : chain1)
+		ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(block));
+	expect_cached_mtp_matches_chain();
+
+	auto context = Chain::get_validation_context();
+	EXPECT_EQ(static_cast<int64_t>(Chain::active_chain.size()), context.height);
+	EXPECT_EQ(Chain::get_median_time_past(NetParams::MEDIAN_TIME_PAST_BLOCKS), context.median_time_past);
+
+	Chain::disconnect_block(Chain::active_chain.back());
+	ASSERT_EQ(chain1.size() - 1, Chain::active_chain.size());
+	expect_cached_mtp_matches_chain();
+
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1.back()));
+	expect_cached_mtp_matches_chain();
+
+	context = Chain::get_validation_context();
+	EXPECT_EQ(static_cast<int64_t>(chain1.size()), context.height);
+}
+
+TEST_F(BlockChainTest, ChainWorkIndexMatchesSummation)
+{
+	for (const auto& block : chain1)
+		ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(block));
+
+	uint256_t expected_work = 0;
+	for (const auto& block : Chain::active_chain)
+		expected_work += PoW::get_block_work(block->bits);
+	EXPECT_EQ(expected_work, Chain::get_chain_work(Chain::active_chain));
+
+	const std::vector prefix(Chain::active_chain.begin(), Chain::active_chain.begin() + 2);
+	EXPECT_EQ(PoW::get_block_work(prefix[0]->bits) + PoW::get_block_work(prefix[1]->bits),
+		Chain::get_chain_work(prefix));
+
+	const auto unindexed = std::vector{
+		std::make_shared<Block>(0, "", "merkle", 1, 10, 0, std::vector<std::shared_ptr<Tx>>()),
+		std::make_shared<Block>(0, "prev", "merkle", 2, 12, 0, std::vector<std::shared_ptr<Tx>>())
+	};
+	EXPECT_EQ(PoW::get_block_work(10) + PoW::get_block_work(12), Chain::get_chain_work(unindexed));
+	EXPECT_EQ(0, Chain::get_chain_work({}));
+}
+
+std::shared_ptr<Block> header_of(const std::shared_ptr<Block>& block)
+{
+	auto header = std::make_shared<Block>(*block);
+	header->txs.clear();
+
+	return header;
+}
+
+TEST_F(BlockChainTest, HeadersFirstSyncConnectsBlocksInHeaderOrder)
+{
+	BlockSync::reset();
+
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[0]));
+	ASSERT_TRUE(BlockSync::accept_headers({ header_of(chain1[1]), header_of(chain1[2]) }));
+	ASSERT_EQ(2, BlockSync::get_pending_header_count());
+	EXPECT_EQ((std::vector{ chain1[2]->id(), chain1[1]->id(), chain1[0]->id() }), BlockSync::get_locator());
+
+	// Already known headers are skipped
+	ASSERT_TRUE(BlockSync::accept_headers({ header_of(chain1[0]), header_of(chain1[1]) }));
+	ASSERT_EQ(2, BlockSync::get_pending_header_count());
+
+	EXPECT_EQ(0, BlockSync::accept_blocks({ chain1[2] }));
+	EXPECT_EQ(1, Chain::active_chain.size());
+
+	EXPECT_EQ(2, BlockSync::accept_blocks({ chain1[1] }));
+	ASSERT_EQ(chain1.size(), Chain::active_chain.size());
+	for (uint32_t i = 0; i < chain1.size(); i++)
+		EXPECT_EQ(*chain1[i], *Chain::active_chain[i]);
+	EXPECT_EQ(0, BlockSync::get_pending_header_count());
+
+	BlockSync::reset();
+}
+
+TEST_F(BlockChainTest, HeadersFirstSyncExtendsPendingHeaders)
+{
+	BlockSync::reset();
+
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[0]));
+	ASSERT_TRUE(BlockSync::accept_headers({ header_of(chain1[1]) }));
+	ASSERT_TRUE(BlockSync::accept_headers({ header_of(chain1[1]), header_of(chain1[2]) }));
+	ASSERT_EQ(2, BlockSync::get_pending_header_count());
+	EXPECT_EQ((std::vector{ chain1[2]->id(), chain1[1]->id(), chain1[0]->id() }), BlockSync::get_locator());
+
+	EXPECT_EQ(1, BlockSync::accept_blocks({ chain1[1] }));
+	ASSERT_EQ(1, BlockSync::get_pending_header_count());
+
+	// The connected header is gone, the remaining one is still found by id
+	EXPECT_EQ(1, BlockSync::accept_blocks({ chain1[2] }));
+	EXPECT_EQ(chain1.size(), Chain::active_chain.size());
+	EXPECT_EQ(0, BlockSync::get_pending_header_count());
+
+	BlockSync::reset();
+}
+
+TEST_F(BlockChainTest, HeadersFirstSyncRejectsInvalidHeaders)
+{
+	BlockSync::reset();
+
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[0]));
+
+	auto bad_pow = header_of(chain1[1]);
+	bad_pow->nonce++;
+	EXPECT_FALSE(BlockSync::accept_headers({ bad_pow }));
+
+	EXPECT_FALSE(BlockSync::accept_headers({ header_of(chain1[2]) }));
+	EXPECT_FALSE(BlockSync::accept_headers({ header_of(chain1[2]), header_of(chain1[1]) }));
+	EXPECT_EQ(0, BlockSync::get_pending_header_count());
+
+	// Blocks that no pending header announced are ignored
+	ASSERT_TRUE(BlockSync::accept_headers({ header_of(chain1[1]) }));
+	EXPECT_EQ(0, BlockSync::accept_blocks({ chain1[2] }));
+	EXPECT_EQ(1, BlockSync::get_pending_header_count());
+	EXPECT_EQ(1, Chain::active_chain.size());
+
+	BlockSync::reset();
+}
+
+#ifdef NDEBUG
+TEST_F(BlockChainTest, HeadersFirstSyncAppliesBlockMedianTimePastRule)
+{
+	BlockSync::reset();
+
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[0]));
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[1]));
+
+	// Not past the median of the two blocks before it, which only counts once there are
+	// MEDIAN_TIME_PAST_BLOCKS of them
+	auto unsolved = std::make_shared<Block>(*chain1[2]);
+	unsolved->timestamp = chain1[1]->timestamp - 1;
+	const auto block = PoW::mine(unsolved);
+	ASSERT_NE(nullptr, block);
+
+	ASSERT_TRUE(BlockSync::accept_headers({ header_of(block) }));
+	ASSERT_EQ(1, BlockSync::get_pending_header_count());
+	EXPECT_EQ(1, BlockSync::accept_blocks({ block }));
+	EXPECT_EQ(block->id(), Chain::active_chain.back()->id());
+
+	BlockSync::reset();
+}
+#endif
+
 TEST_F(BlockChainTest, Reorg)
 {
 	for (const auto& block : chain1)
 		ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(block));
 
 	Chain::side_branches.clear();
-	Mempool::map.clear();
-	Mempool::total_size_bytes = 0;
+	Mempool::clear();
 	UTXO::map.clear();
 
 	for (const auto& block : Chain::active_chain)
@@ -315,11 +477,11 @@ TEST_F(BlockChainTest, DependentTxsInSingleBlock)
 	auto utxo_it = std::ranges::find_if(UTXO::map,
 		[&address](const std::pair<const std::shared_ptr<TxOutPoint>, std::shared_ptr<UTXO>>& p)
 	{
-		return p.second->tx_out->to_address == address;
+		return p.second->tx_out->to_address() == address;
 	});
 	ASSERT_NE(utxo_it, UTXO::map.end());
 	const auto& utxo1 = utxo_it->second;
-	auto tx_out1 = std::make_shared<TxOut>(901, utxo1->tx_out->to_address);
+	auto tx_out1 = std::make_shared<TxOut>(901, utxo1->tx_out->to_pub_key_hash);
 	std::vector tx_outs1{ tx_out1 };
 	auto tx_in1 = Wallet::build_tx_in(priv_key, pub_key, utxo1->tx_out_point, tx_outs1);
 	auto tx1 = std::make_shared<Tx>(std::vector{ tx_in1 }, tx_outs1, 0);
@@ -343,7 +505,7 @@ TEST_F(BlockChainTest, DependentTxsInSingleBlock)
 	Mempool::add_tx_to_mempool(tx1);
 	ASSERT_TRUE(Mempool::map.contains(tx1->id()));
 
-	auto tx_out2 = std::make_shared<TxOut>(9001, tx_out1->to_address);
+	auto tx_out2 = std::make_shared<TxOut>(9001, tx_out1->to_pub_key_hash);
 	std::vector tx_outs2{ tx_out2 };
 	auto tx_out_point2 = std::make_shared<TxOutPoint>(tx1->id(), 0);
 	auto tx_in2 = Wallet::build_tx_in(priv_key, pub_key, tx_out_point2, tx_outs2);
@@ -402,6 +564,129 @@ TEST_F(BlockChainTest, DependentTxsInSingleBlock)
 	ASSERT_NE(map_it2, UTXO::map.end());
 }
 
+#ifdef NDEBUG
+TEST_F(BlockChainTest, ConnectBlockRecordsFeesOfConfirmedTxs)
+{
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[0]));
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[1]));
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[2]));
+
+	auto priv_key = Utils::hex_string_to_byte_array("18e14a7b6a307f426a94f8114701e7c8e774e7f9a47e2c2035db29a206321725");
+	auto pub_key = ECDSA::get_pub_key_from_priv_key(priv_key);
+	auto address = Wallet::pub_key_to_address(pub_key);
+
+	auto utxo_it = std::ranges::find_if(UTXO::map,
+		[&address](const std::pair<const std::shared_ptr<TxOutPoint>, std::shared_ptr<UTXO>>& p)
+	{
+		return p.second->tx_out->to_address() == address;
+	});
+	ASSERT_NE(utxo_it, UTXO::map.end());
+	const auto utxo = utxo_it->second;
+	auto tx_out = std::make_shared<TxOut>(901, utxo->tx_out->to_pub_key_hash);
+	std::vector tx_outs{ tx_out };
+	auto tx_in = Wallet::build_tx_in(priv_key, pub_key, utxo->tx_out_point, tx_outs);
+	auto tx = std::make_shared<Tx>(std::vector{ tx_in }, tx_outs, 0);
+
+	Mempool::add_tx_to_mempool(tx);
+	ASSERT_TRUE(Mempool::map.contains(tx->id()));
+
+	auto block = PoW::assemble_and_solve_block(address);
+
+	// Never tracked, so its fee can only come from the block being connected
+	FeeEstimator::reset();
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(block));
+	ASSERT_FALSE(UTXO::map.contains(utxo->tx_out_point));
+
+	const uint64_t fee_rate = (utxo->tx_out->value - tx_out->value) / tx->serialize().get_size();
+	ASSERT_GT(fee_rate, FeeEstimator::DEFAULT_FEE_RATE);
+	EXPECT_EQ(fee_rate, FeeEstimator::estimate_fee_rate(1));
+}
+
+TEST_F(BlockChainTest, DisconnectBlockReturnsTxsToPoolAndFeeTracking)
+{
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[0]));
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[1]));
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[2]));
+
+	auto priv_key = Utils::hex_string_to_byte_array("18e14a7b6a307f426a94f8114701e7c8e774e7f9a47e2c2035db29a206321725");
+	auto pub_key = ECDSA::get_pub_key_from_priv_key(priv_key);
+	auto address = Wallet::pub_key_to_address(pub_key);
+
+	auto utxo_it = std::ranges::find_if(UTXO::map,
+		[&address](const std::pair<const std::shared_ptr<TxOutPoint>, std::shared_ptr<UTXO>>& p)
+	{
+		return p.second->tx_out->to_address() == address;
+	});
+	ASSERT_NE(utxo_it, UTXO::map.end());
+	const auto utxo = utxo_it->second;
+	auto tx_outs = std::vector{ std::make_shared<TxOut>(901, utxo->tx_out->to_pub_key_hash) };
+	auto tx = std::make_shared<Tx>(
+		std::vector{ Wallet::build_tx_in(priv_key, pub_key, utxo->tx_out_point, tx_outs) }, tx_outs, 0);
+
+	Mempool::add_tx_to_mempool(tx);
+	auto block = PoW::assemble_and_solve_block(address);
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(block));
+	ASSERT_FALSE(Mempool::map.contains(tx->id()));
+
+	Chain::disconnect_block(block);
+	ASSERT_TRUE(Mempool::map.contains(tx->id()));
+	const uint64_t fee = utxo->tx_out->value - 901;
+	EXPECT_EQ(fee, Mempool::map[tx->id()].fee);
+
+	// A tracked tx confirms at the fee rate it was tracked with, not the one the block reports
+	FeeEstimator::record_block("reconfirming_block", { { tx->id(), 1 } });
+	EXPECT_EQ(fee / tx->serialize().get_size(), FeeEstimator::estimate_fee_rate(1));
+}
+
+TEST_F(BlockChainTest, ConnectBlockRemovesConflictingPoolTxs)
+{
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[0]));
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[1]));
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(chain1[2]));
+
+	auto priv_key = Utils::hex_string_to_byte_array("18e14a7b6a307f426a94f8114701e7c8e774e7f9a47e2c2035db29a206321725");
+	auto pub_key = ECDSA::get_pub_key_from_priv_key(priv_key);
+	auto address = Wallet::pub_key_to_address(pub_key);
+
+	auto utxo_it = std::ranges::find_if(UTXO::map,
+		[&address](const std::pair<const std::shared_ptr<TxOutPoint>, std::shared_ptr<UTXO>>& p)
+	{
+		return p.second->tx_out->to_address() == address;
+	});
+	ASSERT_NE(utxo_it, UTXO::map.end());
+	const auto utxo = utxo_it->second;
+
+	auto pool_tx_outs = std::vector{ std::make_shared<TxOut>(901, utxo->tx_out->to_pub_key_hash) };
+	auto pool_tx = std::make_shared<Tx>(
+		std::vector{ Wallet::build_tx_in(priv_key, pub_key, utxo->tx_out_point, pool_tx_outs) }, pool_tx_outs, 0);
+	Mempool::add_tx_to_mempool(pool_tx);
+	ASSERT_TRUE(Mempool::map.contains(pool_tx->id()));
+
+	auto child_tx_outs = std::vector{ std::make_shared<TxOut>(800, utxo->tx_out->to_pub_key_hash) };
+	auto child_tx = std::make_shared<Tx>(
+		std::vector{ Wallet::build_tx_in(priv_key, pub_key, std::make_shared<TxOutPoint>(pool_tx->id(), 0),
+			child_tx_outs) }, child_tx_outs, 0);
+	Mempool::add_tx_to_mempool(child_tx);
+	ASSERT_TRUE(Mempool::map.contains(child_tx->id()));
+
+	// Spends the same coin as the pool tx, without ever having been in the pool
+	auto block_tx_outs = std::vector{ std::make_shared<TxOut>(900, utxo->tx_out->to_pub_key_hash) };
+	auto block_tx = std::make_shared<Tx>(
+		std::vector{ Wallet::build_tx_in(priv_key, pub_key, utxo->tx_out_point, block_tx_outs) }, block_tx_outs, 0);
+	auto block = PoW::assemble_and_solve_block(address, { block_tx });
+	ASSERT_NE(nullptr, block);
+
+	ASSERT_EQ(Chain::ACTIVE_CHAIN_IDX, Chain::connect_block(block));
+	EXPECT_FALSE(Mempool::map.contains(pool_tx->id()));
+	EXPECT_FALSE(Mempool::map.contains(child_tx->id()));
+	EXPECT_TRUE(Mempool::spenders.empty());
+
+	const auto block_template = Mempool::get_block_template();
+	EXPECT_TRUE(block_template.txs.empty());
+	EXPECT_EQ(0, block_template.fees);
+}
+#endif
+
 TEST_F(BlockChainTest, MinerTransaction)
 {
 	const auto [miner_priv_key, miner_pub_key, miner_address] = Wallet::init_wallet("miner.dat");
@@ -446,7 +731,7 @@ TEST(LockTimeTest, IsFinalAndCheckLockTime)
 	auto make_tx = [](int32_t seq, int64_t lock_time)
 	{
 		auto tx_in = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>(), std::vector<uint8_t>(), seq);
-		auto tx_out = std::make_shared<TxOut>(1000, "addr");
+		auto tx_out = std::make_shared<TxOut>(1000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 		return std::make_shared<Tx>(std::vector{ tx_in }, std::vector{ tx_out }, lock_time);
 	};
 
@@ -483,7 +768,7 @@ TEST_F(BlockChainTest, CheckSequenceLocks)
 	auto make_tx_with_seq = [](const std::shared_ptr<TxOutPoint>& outpoint, int32_t seq)
 	{
 		auto tx_in = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>(), std::vector<uint8_t>(), seq);
-		auto tx_out = std::make_shared<TxOut>(1000, "addr");
+		auto tx_out = std::make_shared<TxOut>(1000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 		return std::make_shared<Tx>(std::vector{ tx_in }, std::vector{ tx_out }, 0);
 	};
 
@@ -503,7 +788,7 @@ TEST_F(BlockChainTest, CheckSequenceLocks)
 	}
 
 	const std::string tx_id = "abc123";
-	UTXO::add_to_map(std::make_shared<TxOut>(5000, "addr"), tx_id, 0, false, 2);
+	UTXO::add_to_map(std::make_shared<TxOut>(5000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa"), tx_id, 0, false, 2);
 
 	auto to_spend_time = std::make_shared<TxOutPoint>(tx_id, 0);
 
@@ -571,7 +856,7 @@ TEST_F(BlockChainTest, RBFSignaling)
 		std::vector<std::shared_ptr<TxIn>> ins;
 		for (auto s : seqs)
 			ins.push_back(std::make_shared<TxIn>(nullptr, std::vector<uint8_t>(), std::vector<uint8_t>(), s));
-		auto tx_out = std::make_shared<TxOut>(1000, "addr");
+		auto tx_out = std::make_shared<TxOut>(1000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 		return std::make_shared<Tx>(ins, std::vector{ tx_out }, 0);
 	};
 
@@ -605,7 +890,7 @@ TEST_F(BlockChainTest, RBFMempoolReplacement)
 			std::scoped_lock lock(UTXO::mutex);
 			for (const auto& [_, u] : UTXO::map)
 			{
-				if (u->tx_out->to_address == address &&
+				if (u->tx_out->to_address() == address &&
 					(!u->is_coinbase ||
 						Chain::get_current_height() - u->height >= NetParams::COINBASE_MATURITY))
 				{
@@ -714,7 +999,7 @@ TEST(TxValidationTest, DuplicateInputRejection)
 	auto outpoint = std::make_shared<TxOutPoint>("deadbeef", 0);
 	auto tx_in1 = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>(), std::vector<uint8_t>(), -1);
 	auto tx_in2 = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>(), std::vector<uint8_t>(), -1);
-	auto tx_out = std::make_shared<TxOut>(1000, "addr");
+	auto tx_out = std::make_shared<TxOut>(1000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto tx = std::make_shared<Tx>(std::vector{ tx_in1, tx_in2 }, std::vector{ tx_out }, 0);
 
 	EXPECT_THROW(
@@ -830,7 +1115,7 @@ TEST(TxValidationBasicsTest, EmptyOutputsRejected)
 
 TEST(TxValidationBasicsTest, EmptyInputsNonCoinbaseRejected)
 {
-	auto tx_out = std::make_shared<TxOut>(1000, "addr");
+	auto tx_out = std::make_shared<TxOut>(1000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto tx = std::make_shared<Tx>(std::vector<std::shared_ptr<TxIn>>{}, std::vector{ tx_out }, 0);
 
 	EXPECT_THROW(tx->validate_basics(false), TxValidationException);
@@ -838,7 +1123,7 @@ TEST(TxValidationBasicsTest, EmptyInputsNonCoinbaseRejected)
 
 TEST(TxValidationBasicsTest, EmptyInputsCoinbaseAllowed)
 {
-	auto tx_out = std::make_shared<TxOut>(1000, "addr");
+	auto tx_out = std::make_shared<TxOut>(1000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto tx = std::make_shared<Tx>(std::vector<std::shared_ptr<TxIn>>{}, std::vector{ tx_out }, 0);
 
 	EXPECT_NO_THROW(tx->validate_basics(true));
@@ -847,7 +1132,7 @@ TEST(TxValidationBasicsTest, EmptyInputsCoinbaseAllowed)
 TEST(TxValidationBasicsTest, SingleOutputExceedingMaxMoney)
 {
 	auto tx_in = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
-	auto tx_out = std::make_shared<TxOut>(NetParams::MAX_MONEY + 1, "addr");
+	auto tx_out = std::make_shared<TxOut>(NetParams::MAX_MONEY + 1, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto tx = std::make_shared<Tx>(std::vector{ tx_in }, std::vector{ tx_out }, 0);
 
 	EXPECT_THROW(tx->validate_basics(true), TxValidationException);
@@ -857,8 +1142,8 @@ TEST(TxValidationBasicsTest, TotalOutputsExceedingMaxMoney)
 {
 	auto tx_in = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
 	const uint64_t half_plus_one = NetParams::MAX_MONEY / 2 + 1;
-	auto tx_out1 = std::make_shared<TxOut>(half_plus_one, "addr1");
-	auto tx_out2 = std::make_shared<TxOut>(half_plus_one, "addr2");
+	auto tx_out1 = std::make_shared<TxOut>(half_plus_one, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
+	auto tx_out2 = std::make_shared<TxOut>(half_plus_one, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
 	auto tx = std::make_shared<Tx>(std::vector{ tx_in }, std::vector{ tx_out1, tx_out2 }, 0);
 
 	EXPECT_THROW(tx->validate_basics(true), TxValidationException);
@@ -873,7 +1158,7 @@ TEST(TxValidationBasicsTest, CreateCoinbaseStructure)
 	EXPECT_EQ(nullptr, coinbase->tx_ins[0]->to_spend);
 	EXPECT_EQ(1, coinbase->tx_outs.size());
 	EXPECT_EQ(5000000000ULL, coinbase->tx_outs[0]->value);
-	EXPECT_EQ("1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs", coinbase->tx_outs[0]->to_address);
+	EXPECT_EQ("1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs", coinbase->tx_outs[0]->to_address());
 	EXPECT_EQ(0, coinbase->lock_time);
 
 	EXPECT_FALSE(coinbase->tx_ins[0]->unlock_sig.empty());
@@ -887,7 +1172,7 @@ TEST(TxValidationBasicsTest, CreateCoinbaseStructure)
 TEST(TxValidationBasicsTest, IsCoinbaseDetection)
 {
 	auto tx_in_cb = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
-	auto tx_out = std::make_shared<TxOut>(100, "addr");
+	auto tx_out = std::make_shared<TxOut>(100, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto coinbase_tx = std::make_shared<Tx>(std::vector{ tx_in_cb }, std::vector{ tx_out }, 0);
 	EXPECT_TRUE(coinbase_tx->is_coinbase());
 
@@ -26,7 +26,7 @@ protected:
         uint64_t input_value, uint64_t output_value,
         const std::string& to_addr = "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs")
     {
-        UTXO::add_to_map(std::make_shared<TxOut>(input_value, "addr"), source_id, source_idx, false, 1);
+        UTXO::add_to_map(std::make_shared<TxOut>(input_value, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa"), source_id, source_idx, false, 1);
         auto outpoint = std::make_shared<TxOutPoint>(source_id, source_idx);
         auto tin = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>(), std::vector<uint8_t>(), -1);
         auto tout = std::make_shared<TxOut>(output_value, to_addr);
@@ -41,8 +41,7 @@ protected:
         entry.fee = fee;
         entry.fee_rate = entry.serialized_size > 0 ? fee / entry.serialized_size : 0;
         entry.insertion_time = std::chrono::steady_clock::now();
-        Mempool::total_size_bytes += entry.serialized_size;
-        Mempool::map[tx->id()] = std::move(entry);
+        Mempool::insert_entry(tx->id(), std::move(entry));
     }
 };
 
@@ -155,6 +154,45 @@ TEST_F(CPFPTest, DeepAncestryPackage)
     EXPECT_LT(child_pos, unrelated_pos);
 }
 
+TEST_F(CPFPTest, IncludedParentNoLongerLiftsChildScore)
+{
+    auto parent_tx = make_tx("utxo_parent", 0, 1000000, 900000);
+    insert_into_mempool(parent_tx, 100000);
+
+    auto child_outpoint = std::make_shared<TxOutPoint>(parent_tx->id(), 0);
+    auto child_tin = std::make_shared<TxIn>(child_outpoint, std::vector<uint8_t>(), std::vector<uint8_t>(), -1);
+    auto child_tout = std::make_shared<TxOut>(899000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+    auto child_tx = std::make_shared<Tx>(std::vector{ child_tin }, std::vector{ child_tout }, 0);
+    insert_into_mempool(child_tx, 1000);
+
+    auto unrelated_tx = make_tx("utxo_unrelated", 0, 500000, 480000);
+    insert_into_mempool(unrelated_tx, 20000);
+
+    auto empty_block = std::make_shared<Block>(0, "", "", 0, 24, 0, std::vector<std::shared_ptr<Tx>>{});
+    auto assembled = Mempool::select_from_mempool(empty_block);
+
+    ASSERT_EQ(assembled->txs.size(), 3);
+    EXPECT_EQ(assembled->txs[0]->id(), parent_tx->id());
+    EXPECT_EQ(assembled->txs[1]->id(), unrelated_tx->id());
+    EXPECT_EQ(assembled->txs[2]->id(), child_tx->id());
+}
+
+TEST_F(CPFPTest, TxWithMissingInputIsSkipped)
+{
+    auto tx_ok = make_tx("utxo_ok", 0, 500000, 450000);
+    insert_into_mempool(tx_ok, 50000);
+
+    auto tx_missing = make_tx("utxo_missing", 0, 500000, 400000);
+    insert_into_mempool(tx_missing, 100000);
+    UTXO::remove_from_map("utxo_missing", 0);
+
+    auto empty_block = std::make_shared<Block>(0, "", "", 0, 24, 0, std::vector<std::shared_ptr<Tx>>{});
+    auto assembled = Mempool::select_from_mempool(empty_block);
+
+    ASSERT_EQ(assembled->txs.size(), 1);
+    EXPECT_EQ(assembled->txs[0]->id(), tx_ok->id());
+}
+
 TEST_F(CPFPTest, EmptyMempoolProducesEmptyBlock)
 {
     auto empty_block = std::make_shared<Block>(0, "", "", 0, 24, 0, std::vector<std::shared_ptr<Tx>>{});
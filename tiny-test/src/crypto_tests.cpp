@@ -1,10 +1,14 @@
+#include <array>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 
 #include "crypto/base58.hpp"
 #include "crypto/ecdsa.hpp"
 #include "crypto/hmac_sha512.hpp"
+#include "crypto/pub_key_cache.hpp"
 #include "crypto/ripemd160.hpp"
 #include "crypto/sha256.hpp"
 #include "crypto/sig_cache.hpp"
@@ -100,6 +104,72 @@ TEST(CryptoTest, HMACSHA512_BasicVector)
 		hex);
 }
 
+TEST(CryptoTest, SHA256_StreamingMatchesOneShot)
+{
+	const auto foo = Utils::string_to_byte_array("foo");
+	const auto bar = Utils::string_to_byte_array("bar");
+
+	SHA256::Hasher hasher;
+	const auto streamed = hasher.update(foo).update(bar).finalize();
+	EXPECT_EQ(SHA256::hash_binary(Utils::string_to_byte_array("foobar")),
+		std::vector<uint8_t>(streamed.begin(), streamed.end()));
+
+	// A finalized hasher starts over for the next message
+	const auto reused = hasher.update(foo).finalize_double();
+	EXPECT_EQ("c7ade88fc7a21498a6a5e5c385e1f68bed822b72aa63c4a9a48a02c2466ee29e",
+		Utils::byte_array_to_hex_string(reused));
+}
+
+TEST(CryptoTest, RIPEMD160_StreamingMatchesOneShot)
+{
+	const auto hash = RIPEMD160::Hasher()
+		.update(Utils::string_to_byte_array("f"))
+		.update(Utils::string_to_byte_array("oo"))
+		.finalize();
+
+	EXPECT_EQ("42cfa211018ea492fdee45ac637b7972a0ad6873", Utils::byte_array_to_hex_string(hash));
+}
+
+TEST(CryptoTest, HMACSHA512_StreamingMatchesOneShot)
+{
+	const auto key = Utils::string_to_byte_array("Jefe");
+
+	const auto hash = HMACSHA512::Hasher(key)
+		.update(Utils::string_to_byte_array("what do ya want "))
+		.update(Utils::string_to_byte_array("for nothing?"))
+		.finalize();
+
+	EXPECT_EQ(HMACSHA512::hash(key, Utils::string_to_byte_array("what do ya want for nothing?")), hash);
+}
+
+TEST(CryptoTest, Hashers_NestedInstancesAreIndependent)
+{
+	SHA256::Hasher outer;
+	outer.update(Utils::string_to_byte_array("foo"));
+	{
+		SHA256::Hasher inner;
+		inner.update(Utils::string_to_byte_array("bar")).finalize();
+	}
+
+	EXPECT_EQ("2c26b46b68ffc68ff99b453c1d30413413422d706483bfa0f98a5e886266e7ae",
+		Utils::byte_array_to_hex_string(outer.finalize()));
+}
+
+TEST(CryptoTest, Hashers_ExitCleanlyWithPooledContexts)
+{
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	// Exiting runs main's atexit cleanup after this thread's context pools are destroyed
+	EXPECT_EXIT(
+		{
+			SHA256::hash(Utils::string_to_byte_array("foo"));
+			RIPEMD160::hash(Utils::string_to_byte_array("foo"));
+			HMACSHA512::hash(Utils::string_to_byte_array("key"), Utils::string_to_byte_array("foo"));
+			std::exit(0);
+		},
+		::testing::ExitedWithCode(0), "");
+}
+
 TEST(CryptoTest, SHA256_EmptyInput)
 {
 	auto hash = Utils::byte_array_to_hex_string(SHA256::hash_binary({}));
@@ -130,6 +200,48 @@ TEST(CryptoTest, Base58_LeadingZeroBytes)
 	EXPECT_EQ('1', encoded[1]);
 }
 
+TEST(CryptoTest, Base58_DecodeRoundTrip)
+{
+	std::vector<uint8_t> decoded;
+	ASSERT_TRUE(Base58::decode("bQbp", decoded));
+	EXPECT_EQ(Utils::string_to_byte_array("foo"), decoded);
+
+	const std::vector<uint8_t> input{ 0x00, 0x00, 0x01, 0xff, 0x80 };
+	ASSERT_TRUE(Base58::decode(Base58::encode(input), decoded));
+	EXPECT_EQ(input, decoded);
+
+	ASSERT_TRUE(Base58::decode("", decoded));
+	EXPECT_TRUE(decoded.empty());
+
+	EXPECT_FALSE(Base58::decode("b0bp", decoded));
+	EXPECT_FALSE(Base58::decode("bQbl", decoded));
+}
+
+TEST(CryptoTest, Base58_FixedSizeDecodeRejectsOtherLengths)
+{
+	std::array<uint8_t, 3> fixed{};
+	ASSERT_TRUE(Base58::decode("bQbp", fixed));
+	EXPECT_EQ(Utils::string_to_byte_array("foo"), std::vector<uint8_t>(fixed.begin(), fixed.end()));
+
+	std::array<uint8_t, 4> too_long{};
+	EXPECT_FALSE(Base58::decode("bQbp", too_long));
+	std::array<uint8_t, 2> too_short{};
+	EXPECT_FALSE(Base58::decode("bQbp", too_short));
+}
+
+TEST(CryptoTest, Base58Check_DetectsCorruption)
+{
+	const std::array<uint8_t, 3> payload{ 0x00, 0x12, 0x34 };
+	auto encoded = Base58::encode_check(payload);
+
+	std::array<uint8_t, 3> decoded{};
+	ASSERT_TRUE(Base58::decode_check(encoded, decoded));
+	EXPECT_EQ(payload, decoded);
+
+	encoded.back() = encoded.back() == 'z' ? 'y' : 'z';
+	EXPECT_FALSE(Base58::decode_check(encoded, decoded));
+}
+
 class SigCacheTest : public ::testing::Test
 {
 protected:
@@ -174,3 +286,193 @@ TEST_F(SigCacheTest, ClearRemovesEntries)
 	SigCache::clear();
 	EXPECT_FALSE(SigCache::contains(sig, msg, pub));
 }
+
+class PubKeyCacheTest : public ::testing::Test
+{
+protected:
+	void SetUp() override { PubKeyCache::clear(); }
+	void TearDown() override { PubKeyCache::clear(); }
+};
+
+TEST_F(PubKeyCacheTest, RepeatedVerificationHitsCache)
+{
+	auto [priv_key, pub_key] = ECDSA::generate();
+
+	const auto msg = Utils::string_to_byte_array("foo");
+	const auto sig = ECDSA::sign_msg(msg, priv_key);
+
+	EXPECT_TRUE(ECDSA::verify_sig(sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_EQ(0, PubKeyCache::get_hits());
+	EXPECT_EQ(1, PubKeyCache::get_misses());
+
+	EXPECT_TRUE(ECDSA::verify_sig(sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_TRUE(ECDSA::verify_sig(sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_EQ(2, PubKeyCache::get_hits());
+	EXPECT_EQ(1, PubKeyCache::get_misses());
+	EXPECT_EQ(1, PubKeyCache::size());
+}
+
+TEST_F(PubKeyCacheTest, CachedKeyStillRejectsBadSignature)
+{
+	auto [priv_key, pub_key] = ECDSA::generate();
+	auto [other_priv_key, other_pub_key] = ECDSA::generate();
+
+	const auto msg = Utils::string_to_byte_array("foo");
+	const auto sig = ECDSA::sign_msg(msg, priv_key);
+	const auto other_sig = ECDSA::sign_msg(msg, other_priv_key);
+
+	EXPECT_TRUE(ECDSA::verify_sig(sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_FALSE(ECDSA::verify_sig(other_sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_FALSE(ECDSA::verify_sig(sig, Utils::string_to_byte_array("bar"), pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_TRUE(ECDSA::verify_sig(sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_TRUE(ECDSA::verify_sig(other_sig, msg, other_pub_key, ECDSA::Engine::OpenSSL));
+}
+
+TEST_F(PubKeyCacheTest, InvalidPubKeyNotCached)
+{
+	const std::vector<uint8_t> bad_pub_key{ 0x02, 0x01, 0x02, 0x03 };
+	const auto msg = Utils::string_to_byte_array("foo");
+
+	EXPECT_FALSE(ECDSA::verify_sig({ 0x30 }, msg, bad_pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_EQ(0, PubKeyCache::size());
+}
+
+TEST_F(PubKeyCacheTest, EvictsLeastRecentlyUsed)
+{
+	for (uint32_t i = 0; i < PubKeyCache::MAX_ENTRIES + 1; i++)
+	{
+		std::vector<uint8_t> pub_key(4);
+		std::memcpy(pub_key.data(), &i, sizeof(i));
+		PubKeyCache::add(pub_key, nullptr);
+	}
+
+	EXPECT_EQ(PubKeyCache::MAX_ENTRIES, PubKeyCache::size());
+
+	std::vector<uint8_t> first_key(4, 0x00);
+	PubKeyCache::get(first_key);
+	EXPECT_EQ(0, PubKeyCache::get_hits());
+	EXPECT_EQ(1, PubKeyCache::get_misses());
+}
+
+TEST(CryptoTest, Secp256k1_PubKeyMatchesOpenSSL)
+{
+	const auto priv_key = Utils::hex_string_to_byte_array(
+		"18e14a7b6a307f426a94f8114701e7c8e774e7f9a47e2c2035db29a206321725");
+	EXPECT_EQ("0250863ad64a87ae8a2fe83c1af1a8403cb53f53e486d8511dad8a04887e5b2352",
+		Utils::byte_array_to_hex_string(ECDSA::get_pub_key_from_priv_key(priv_key, ECDSA::Engine::Native)));
+
+	for (int i = 0; i < 16; i++)
+	{
+		auto [generated_priv_key, pub_key] = ECDSA::generate();
+
+		EXPECT_EQ(pub_key, ECDSA::get_pub_key_from_priv_key(generated_priv_key, ECDSA::Engine::Native));
+	}
+}
+
+TEST(CryptoTest, Secp256k1_DeterministicSignatureVector)
+{
+	const auto priv_key = Utils::hex_string_to_byte_array(
+		"0000000000000000000000000000000000000000000000000000000000000001");
+	const auto msg = SHA256::hash_binary(Utils::string_to_byte_array("Satoshi Nakamoto"));
+
+	const auto sig = ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::Native);
+
+	EXPECT_EQ("3045022100934b1ea10a4b3c1757e2b0c017d0b6143ce3c9a7e6a4a49860d7a6ab210ee3d8"
+		"02202442ce9d2b916064108014783e923ec36b49743e2ffa1c4496f01a512aafd9e5",
+		Utils::byte_array_to_hex_string(sig));
+	EXPECT_EQ(sig, ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::Native));
+}
+
+TEST(CryptoTest, Secp256k1_CrossVerifiesWithOpenSSL)
+{
+	for (int i = 0; i < 16; i++)
+	{
+		auto [priv_key, pub_key] = ECDSA::generate();
+
+		const auto msg = SHA256::hash_binary(Utils::string_to_byte_array("msg " + std::to_string(i)));
+		const auto other_msg = SHA256::hash_binary(Utils::string_to_byte_array("other " + std::to_string(i)));
+
+		const auto native_sig = ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::Native);
+		const auto openssl_sig = ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::OpenSSL);
+
+		EXPECT_TRUE(ECDSA::verify_sig(native_sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+		EXPECT_TRUE(ECDSA::verify_sig(native_sig, msg, pub_key, ECDSA::Engine::Native));
+		EXPECT_TRUE(ECDSA::verify_sig(openssl_sig, msg, pub_key, ECDSA::Engine::Native));
+		EXPECT_TRUE(ECDSA::verify_sig(openssl_sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+
+		EXPECT_FALSE(ECDSA::verify_sig(native_sig, other_msg, pub_key, ECDSA::Engine::Native));
+		EXPECT_FALSE(ECDSA::verify_sig(openssl_sig, other_msg, pub_key, ECDSA::Engine::Native));
+		EXPECT_FALSE(ECDSA::verify_sig(native_sig, other_msg, pub_key, ECDSA::Engine::OpenSSL));
+	}
+}
+
+TEST(CryptoTest, Secp256k1_ShortMessagesMatchOpenSSL)
+{
+	auto [priv_key, pub_key] = ECDSA::generate();
+
+	const auto msg = Utils::string_to_byte_array("foo");
+	const auto native_sig = ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::Native);
+	const auto openssl_sig = ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::OpenSSL);
+
+	EXPECT_TRUE(ECDSA::verify_sig(native_sig, msg, pub_key, ECDSA::Engine::OpenSSL));
+	EXPECT_TRUE(ECDSA::verify_sig(openssl_sig, msg, pub_key, ECDSA::Engine::Native));
+}
+
+TEST(CryptoTest, Secp256k1_AcceptsSamePubKeyEncodingsAsOpenSSL)
+{
+	const auto priv_key = Utils::hex_string_to_byte_array("18e14a7b6a307f426a94f8114701e7c8e774e7f9a47e2c2035db29a206321725");
+	const auto x = "50863ad64a87ae8a2fe83c1af1a8403cb53f53e486d8511dad8a04887e5b2352";
+	const auto y = "2cd470243453a299fa9e77237716103abc11a1df38855ed6f2ee187e9c582ba6";
+	const auto msg = SHA256::hash_binary(Utils::string_to_byte_array("foo"));
+	const auto sig = ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::OpenSSL);
+
+	const auto encode = [](const std::string& hex) { return Utils::hex_string_to_byte_array(hex); };
+	const std::vector<std::pair<std::vector<uint8_t>, bool>> encodings{
+		{ encode(std::string("02") + x), true },
+		{ encode(std::string("04") + x + y), true },
+		// Hybrid, the prefix also giving the parity of y
+		{ encode(std::string("06") + x + y), true },
+		{ encode(std::string("07") + x + y), false },
+		{ encode(std::string("03") + x), false },
+		{ encode(std::string("05") + x + y), false },
+		{ encode(std::string("04") + x), false },
+		{ encode(std::string("02") + x + y), false },
+		{ encode(std::string("04") + x + y + "00"), false },
+		{ encode("00"), false },
+		{ {}, false }
+	};
+
+	for (const auto& [pub_key, valid] : encodings)
+	{
+		EXPECT_EQ(valid, ECDSA::verify_sig(sig, msg, pub_key, ECDSA::Engine::OpenSSL))
+			<< Utils::byte_array_to_hex_string(pub_key);
+		EXPECT_EQ(valid, ECDSA::verify_sig(sig, msg, pub_key, ECDSA::Engine::Native))
+			<< Utils::byte_array_to_hex_string(pub_key);
+	}
+}
+
+TEST(CryptoTest, Secp256k1_RejectsMalformedInput)
+{
+	auto [priv_key, pub_key] = ECDSA::generate();
+	const auto msg = SHA256::hash_binary(Utils::string_to_byte_array("foo"));
+	const auto sig = ECDSA::sign_msg(msg, priv_key, ECDSA::Engine::Native);
+
+	auto truncated_sig = sig;
+	truncated_sig.pop_back();
+	EXPECT_FALSE(ECDSA::verify_sig(truncated_sig, msg, pub_key, ECDSA::Engine::Native));
+
+	auto flipped_sig = sig;
+	flipped_sig[10] ^= 0x01;
+	EXPECT_FALSE(ECDSA::verify_sig(flipped_sig, msg, pub_key, ECDSA::Engine::Native));
+
+	auto wrong_parity_pub_key = pub_key;
+	wrong_parity_pub_key[0] ^= 0x01;
+	EXPECT_FALSE(ECDSA::verify_sig(sig, msg, wrong_parity_pub_key, ECDSA::Engine::Native));
+
+	const std::vector<uint8_t> bad_pub_key{ 0x02, 0x01, 0x02, 0x03 };
+	EXPECT_FALSE(ECDSA::verify_sig(sig, msg, bad_pub_key, ECDSA::Engine::Native));
+
+	const std::vector<uint8_t> zero_priv_key(32, 0x00);
+	EXPECT_TRUE(ECDSA::sign_msg(msg, zero_priv_key, ECDSA::Engine::Native).empty());
+	EXPECT_TRUE(ECDSA::get_pub_key_from_priv_key(zero_priv_key, ECDSA::Engine::Native).empty());
+}
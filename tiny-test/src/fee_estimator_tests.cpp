@@ -1,5 +1,9 @@
+#include <chrono>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "core/block.hpp"
@@ -11,7 +15,9 @@
 #include "core/tx_out_point.hpp"
 #include "core/unspent_tx_out.hpp"
 #include "mining/fee_estimator.hpp"
+#include "mining/fee_rate_histogram.hpp"
 #include "mining/pow.hpp"
+#include "net/send_fee_histogram_msg.hpp"
 #include <gtest/gtest.h>
 
 class FeeEstimatorTest : public ::testing::Test
@@ -36,13 +42,28 @@ protected:
 
     static std::shared_ptr<Tx> make_fee_tx(const std::string& source_id, uint64_t input_value, uint64_t output_value)
     {
-        UTXO::add_to_map(std::make_shared<TxOut>(input_value, "addr"), source_id, 0, false, 1);
+        UTXO::add_to_map(std::make_shared<TxOut>(input_value, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa"), source_id, 0, false, 1);
         auto outpoint = std::make_shared<TxOutPoint>(source_id, 0);
         auto tin = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>(), std::vector<uint8_t>(), -1);
         auto tout = std::make_shared<TxOut>(output_value, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
         return std::make_shared<Tx>(std::vector{ tin }, std::vector{ tout }, 0);
     }
 
+    // Fee rates worked out the way Chain::connect_block does, while the inputs are still in the UTXO set
+    static void record_block(const std::shared_ptr<Block>& block)
+    {
+        std::vector<std::pair<std::string, uint64_t>> tx_fee_rates;
+        for (const auto& tx : block->txs)
+        {
+            if (tx->is_coinbase())
+                continue;
+
+            const uint32_t tx_size = tx->serialize().get_size();
+            tx_fee_rates.emplace_back(tx->id(), tx_size > 0 ? PoW::calculate_fees(tx) / tx_size : 0);
+        }
+        FeeEstimator::record_block(block->id(), tx_fee_rates);
+    }
+
     static std::shared_ptr<Block> make_block_with_fee_tx(const std::string& source_id,
         uint64_t input_value, uint64_t output_value, int64_t timestamp = 1501821412, uint64_t nonce = 0)
     {
@@ -64,29 +85,61 @@ TEST_F(FeeEstimatorTest, DefaultFeeRateWithNoData)
 TEST_F(FeeEstimatorTest, RecordUnrecordAndReset)
 {
     auto block = make_block_with_fee_tx("src_1", 1000000, 900000);
-    FeeEstimator::record_block(block);
+    record_block(block);
 
     const uint64_t rate = FeeEstimator::estimate_fee_rate(3);
     EXPECT_NE(rate, 0);
     EXPECT_GE(rate, FeeEstimator::MIN_RELAY_FEE_RATE);
 
-    FeeEstimator::record_block(block);
+    record_block(block);
     EXPECT_EQ(FeeEstimator::estimate_fee_rate(3), rate);
 
     auto coinbase_block = std::make_shared<Block>(0, "", "merkle2", 1501821500, 24, 99,
         std::vector<std::shared_ptr<Tx>>{make_coinbase_tx(5000000000)});
-    FeeEstimator::record_block(coinbase_block);
+    record_block(coinbase_block);
     EXPECT_EQ(FeeEstimator::estimate_fee_rate(3), rate);
 
     FeeEstimator::unrecord_block(block->id());
     EXPECT_EQ(FeeEstimator::estimate_fee_rate(3), FeeEstimator::DEFAULT_FEE_RATE);
 
-    FeeEstimator::record_block(block);
+    record_block(block);
     EXPECT_NE(FeeEstimator::estimate_fee_rate(3), FeeEstimator::DEFAULT_FEE_RATE);
     FeeEstimator::reset();
     EXPECT_EQ(FeeEstimator::estimate_fee_rate(3), FeeEstimator::DEFAULT_FEE_RATE);
 }
 
+TEST_F(FeeEstimatorTest, UnrecordingTheTipRollsBackItsBlock)
+{
+    auto waiting_tx = make_fee_tx("rollback_waiting_src", 150000, 50000);
+    FeeEstimator::track_tx(waiting_tx->id(), 1000);
+
+    // The block count is back where it was, so the tx still confirms in the first block
+    auto stale_block = std::make_shared<Block>(0, "", "merkle", 1501821412, 24, 100,
+        std::vector<std::shared_ptr<Tx>>{ make_coinbase_tx(5000000000) });
+    record_block(stale_block);
+    FeeEstimator::unrecord_block(stale_block->id());
+
+    auto expiring_tx = make_fee_tx("rollback_expiring_src", 150000, 50000);
+    FeeEstimator::track_tx(expiring_tx->id(), 1000);
+
+    record_block(std::make_shared<Block>(0, "", "merkle", 1501821412, 24, 0,
+        std::vector<std::shared_ptr<Tx>>{ make_coinbase_tx(5000000000), waiting_tx }));
+    EXPECT_EQ(1000, FeeEstimator::estimate_fee_rate(1));
+
+    std::shared_ptr<Block> expiring_block;
+    for (uint32_t i = 1; i <= FeeEstimator::MAX_CONFIRM_BLOCKS; i++)
+    {
+        expiring_block = std::make_shared<Block>(0, "", "merkle", 1501821412 + i, 24, static_cast<uint64_t>(i),
+            std::vector<std::shared_ptr<Tx>>{ make_coinbase_tx(5000000000) });
+        record_block(expiring_block);
+    }
+    EXPECT_EQ(FeeEstimator::DEFAULT_FEE_RATE, FeeEstimator::estimate_fee_rate(1));
+
+    // The failure goes with the block that counted it
+    FeeEstimator::unrecord_block(expiring_block->id());
+    EXPECT_NEAR(1000, FeeEstimator::estimate_fee_rate(1), 1);
+}
+
 TEST_F(FeeEstimatorTest, HighPriorityHigherThanLow)
 {
     for (int i = 0; i < 5; i++)
@@ -102,7 +155,7 @@ TEST_F(FeeEstimatorTest, HighPriorityHigherThanLow)
         }
 
         auto block = std::make_shared<Block>(0, "", "merkle", 1501821412 + i, 24, static_cast<uint64_t>(i), txs);
-        FeeEstimator::record_block(block);
+        record_block(block);
     }
 
     const uint64_t high = FeeEstimator::estimate_fee_rate(1);
@@ -131,7 +184,7 @@ TEST_F(FeeEstimatorTest, MempoolFeeRatePercentile)
         e1.fee = 500000 - 100000;
         e1.fee_rate = e1.serialized_size > 0 ? e1.fee / e1.serialized_size : 0;
         e1.insertion_time = std::chrono::steady_clock::now();
-        Mempool::map[tx1->id()] = std::move(e1);
+        Mempool::insert_entry(tx1->id(), std::move(e1));
 
         Mempool::MempoolEntry e2;
         e2.tx = tx2;
@@ -139,7 +192,7 @@ TEST_F(FeeEstimatorTest, MempoolFeeRatePercentile)
         e2.fee = 1000000 - 100000;
         e2.fee_rate = e2.serialized_size > 0 ? e2.fee / e2.serialized_size : 0;
         e2.insertion_time = std::chrono::steady_clock::now();
-        Mempool::map[tx2->id()] = std::move(e2);
+        Mempool::insert_entry(tx2->id(), std::move(e2));
     }
 
     const uint64_t p50 = FeeEstimator::get_mempool_fee_rate_percentile(0.5);
@@ -148,3 +201,147 @@ TEST_F(FeeEstimatorTest, MempoolFeeRatePercentile)
     const uint64_t p90 = FeeEstimator::get_mempool_fee_rate_percentile(0.9);
     EXPECT_GE(p90, p50);
 }
+
+TEST_F(FeeEstimatorTest, SlowConfirmationsOnlyCountForLongerTargets)
+{
+    // Low fee txs wait five blocks in the mempool, high fee ones confirm in the next block
+    std::vector<std::shared_ptr<Tx>> low_txs;
+    for (int i = 0; i < 5; i++)
+    {
+        auto tx = make_fee_tx("slow_src_" + std::to_string(i), 60000, 50000);
+        FeeEstimator::track_tx(tx->id(), 10);
+        low_txs.push_back(tx);
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        auto high_tx = make_fee_tx("fast_src_" + std::to_string(i), 150000, 50000);
+        FeeEstimator::track_tx(high_tx->id(), 1000);
+
+        std::vector<std::shared_ptr<Tx>> txs{ make_coinbase_tx(5000000000), high_tx };
+        if (i == 4)
+            txs.insert(txs.end(), low_txs.begin(), low_txs.end());
+
+        record_block(std::make_shared<Block>(0, "", "merkle", 1501821412 + i, 24,
+            static_cast<uint64_t>(i), txs));
+    }
+
+    EXPECT_EQ(1000, FeeEstimator::estimate_fee_rate(1));
+    EXPECT_EQ(1000, FeeEstimator::estimate_fee_rate(4));
+    EXPECT_EQ(10, FeeEstimator::estimate_fee_rate(5));
+}
+
+TEST_F(FeeEstimatorTest, DroppedTxsDoNotCountAsFailures)
+{
+    // Two txs at the same fee rate, one confirms in the next block and the other is evicted
+    auto confirmed_tx = make_fee_tx("dropped_confirmed_src", 150000, 50000);
+    FeeEstimator::track_tx(confirmed_tx->id(), 1000);
+
+    auto evicted_tx = make_fee_tx("dropped_evicted_src", 150000, 50000);
+    {
+        std::scoped_lock lock(Mempool::mutex);
+        Mempool::MempoolEntry entry;
+        entry.tx = evicted_tx;
+        entry.serialized_size = evicted_tx->serialize().get_size();
+        entry.fee = 150000 - 50000;
+        entry.fee_rate = entry.fee / entry.serialized_size;
+        entry.insertion_time = std::chrono::steady_clock::now();
+        Mempool::insert_entry(evicted_tx->id(), std::move(entry));
+    }
+    FeeEstimator::track_tx(evicted_tx->id(), 1000);
+
+    Mempool::trim_to_size(0);
+    ASSERT_TRUE(Mempool::map.empty());
+
+    record_block(std::make_shared<Block>(0, "", "merkle", 1501821412, 24, 0,
+        std::vector<std::shared_ptr<Tx>>{ make_coinbase_tx(5000000000), confirmed_tx }));
+    // Long enough for a tx still being timed to count as never confirming
+    for (uint32_t i = 1; i <= FeeEstimator::MAX_CONFIRM_BLOCKS + 1; i++)
+    {
+        record_block(std::make_shared<Block>(0, "", "merkle", 1501821412 + i, 24, static_cast<uint64_t>(i),
+            std::vector<std::shared_ptr<Tx>>{ make_coinbase_tx(5000000000) }));
+    }
+
+    // Decay can leave the average a rounding step short
+    EXPECT_NEAR(1000, FeeEstimator::estimate_fee_rate(1), 1);
+}
+
+TEST_F(FeeEstimatorTest, FeeRateHistogramPercentilesFollowUpdates)
+{
+    FeeRateHistogram histogram;
+    EXPECT_FALSE(histogram.get_percentile(0.5).has_value());
+
+    for (uint64_t rate = 1; rate <= 100; rate++)
+        histogram.add(rate * 100);
+
+    EXPECT_EQ(100, histogram.get_tx_count());
+    // Each answer is the average of a bucket 10% wide, so within 10% of the exact percentile
+    EXPECT_NEAR(100.0, static_cast<double>(*histogram.get_percentile(0.0)), 10.0);
+    EXPECT_NEAR(5000.0, static_cast<double>(*histogram.get_percentile(0.5)), 500.0);
+    EXPECT_NEAR(10000.0, static_cast<double>(*histogram.get_percentile(1.0)), 1000.0);
+
+    for (uint64_t rate = 51; rate <= 100; rate++)
+        histogram.remove(rate * 100);
+
+    EXPECT_EQ(50, histogram.get_tx_count());
+    EXPECT_NEAR(5000.0, static_cast<double>(*histogram.get_percentile(1.0)), 500.0);
+
+    SendFeeHistogramMsg msg(histogram.get_buckets());
+    auto buffer = msg.serialize();
+    SendFeeHistogramMsg received;
+    ASSERT_TRUE(received.deserialize(buffer));
+
+    FeeRateHistogram rebuilt(received.buckets);
+    EXPECT_EQ(histogram.get_tx_count(), rebuilt.get_tx_count());
+    EXPECT_EQ(*histogram.get_percentile(0.3), *rebuilt.get_percentile(0.3));
+}
+
+TEST_F(FeeEstimatorTest, FeeRateHistogramRejectsMalformedBuckets)
+{
+    using Bucket = FeeRateHistogram::Bucket;
+    const auto bucket_count = static_cast<uint32_t>(FeeRateHistogram::get_bucket_bounds().size());
+    const uint64_t max_count = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+
+    const std::vector<std::vector<Bucket>> malformed{
+        { { 3, 1, 10 }, { 3, 1, 10 } },
+        { { bucket_count, 1, 10 } },
+        { { 3, 0, 0 } },
+        { { 3, max_count, 10 }, { 4, 1, 10 } },
+        { { 3, std::numeric_limits<uint64_t>::max(), 10 } },
+    };
+    for (const auto& buckets : malformed)
+    {
+        EXPECT_FALSE(FeeRateHistogram::are_valid_buckets(buckets));
+        EXPECT_THROW(FeeRateHistogram{ buckets }, std::runtime_error);
+
+        SendFeeHistogramMsg msg(buckets);
+        auto buffer = msg.serialize();
+        SendFeeHistogramMsg received;
+        EXPECT_FALSE(received.deserialize(buffer));
+    }
+
+    const auto bucket_idx = static_cast<uint32_t>(FeeRateHistogram::find_bucket(4));
+    const FeeRateHistogram histogram({ { bucket_idx, 2, 8 }, { bucket_count - 1, 1, 20000000 } });
+    EXPECT_EQ(3, histogram.get_tx_count());
+    EXPECT_EQ(4, *histogram.get_percentile(0.0));
+}
+
+TEST_F(FeeEstimatorTest, MempoolFeeHistogramFollowsPool)
+{
+    auto tx = make_fee_tx("hist_src", 500000, 100000);
+    Mempool::MempoolEntry entry;
+    entry.tx = tx;
+    entry.serialized_size = tx->serialize().get_size();
+    entry.fee = 400000;
+    entry.fee_rate = entry.fee / entry.serialized_size;
+    entry.insertion_time = std::chrono::steady_clock::now();
+    const uint64_t fee_rate = entry.fee_rate;
+    Mempool::insert_entry(tx->id(), std::move(entry));
+
+    EXPECT_EQ(1, Mempool::fee_histogram.get_tx_count());
+    EXPECT_EQ(fee_rate, FeeEstimator::get_mempool_fee_rate_percentile(0.5));
+
+    Mempool::remove_entry(tx->id());
+    EXPECT_EQ(0, Mempool::fee_histogram.get_tx_count());
+    EXPECT_EQ(FeeEstimator::DEFAULT_FEE_RATE, FeeEstimator::get_mempool_fee_rate_percentile(0.5));
+}
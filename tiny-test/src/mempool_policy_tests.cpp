@@ -1,6 +1,12 @@
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
 #include <memory>
+#include <ranges>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "core/block.hpp"
@@ -12,7 +18,12 @@
 #include "core/tx_out.hpp"
 #include "core/tx_out_point.hpp"
 #include "core/unspent_tx_out.hpp"
+#include "net/connection.hpp"
+#include "crypto/ecdsa.hpp"
+#include "util/binary_buffer.hpp"
 #include "util/exceptions.hpp"
+#include "util/utils.hpp"
+#include "wallet/wallet.hpp"
 #include <gtest/gtest.h>
 
 class MempoolPolicyTest : public ::testing::Test
@@ -23,13 +34,24 @@ protected:
 
     static std::shared_ptr<Tx> make_valid_tx(const std::string& source_id, uint64_t input_value, uint64_t output_value)
     {
-        UTXO::add_to_map(std::make_shared<TxOut>(input_value, "addr"), source_id, 0, false, 1);
+        UTXO::add_to_map(std::make_shared<TxOut>(input_value, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa"), source_id, 0, false, 1);
         auto outpoint = std::make_shared<TxOutPoint>(source_id, 0);
         auto tin = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
         auto tout = std::make_shared<TxOut>(output_value, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
         return std::make_shared<Tx>(std::vector{ tin }, std::vector{ tout }, 0);
     }
 
+    static std::shared_ptr<Tx> make_signed_tx(const std::shared_ptr<TxOutPoint>& outpoint, uint64_t output_value)
+    {
+        const auto priv_key = Utils::hex_string_to_byte_array(
+            "18e14a7b6a307f426a94f8114701e7c8e774e7f9a47e2c2035db29a206321725");
+        const auto pub_key = ECDSA::get_pub_key_from_priv_key(priv_key);
+
+        std::vector outs{ std::make_shared<TxOut>(output_value, Wallet::pub_key_to_address(pub_key)) };
+        auto tin = Wallet::build_tx_in(priv_key, pub_key, outpoint, outs);
+        return std::make_shared<Tx>(std::vector{ tin }, outs, 0);
+    }
+
     static void direct_insert(const std::shared_ptr<Tx>& tx, uint64_t fee)
     {
         Mempool::MempoolEntry entry;
@@ -38,14 +60,13 @@ protected:
         entry.fee = fee;
         entry.fee_rate = entry.serialized_size > 0 ? fee / entry.serialized_size : 0;
         entry.insertion_time = std::chrono::steady_clock::now();
-        Mempool::total_size_bytes += entry.serialized_size;
-        Mempool::map[tx->id()] = std::move(entry);
+        Mempool::insert_entry(tx->id(), std::move(entry));
     }
 };
 
 TEST_F(MempoolPolicyTest, DustOutputRejected)
 {
-    UTXO::add_to_map(std::make_shared<TxOut>(10000, "addr"), "dust_source", 0, false, 1);
+    UTXO::add_to_map(std::make_shared<TxOut>(10000, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa"), "dust_source", 0, false, 1);
     auto outpoint = std::make_shared<TxOutPoint>("dust_source", 0);
     auto tin = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
     auto dust_out = std::make_shared<TxOut>(NetParams::DUST_THRESHOLD - 1, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
@@ -92,3 +113,410 @@ TEST_F(MempoolPolicyTest, FindUtxoInMempool)
     auto missing = std::make_shared<TxOutPoint>("nonexistent_tx_id", 0);
     EXPECT_EQ(nullptr, Mempool::find_utxo_in_mempool(missing));
 }
+
+TEST_F(MempoolPolicyTest, BlockTemplateFollowsPoolChanges)
+{
+    auto parent = make_valid_tx("template_parent_src", 500000, 400000);
+    direct_insert(parent, 100000);
+
+    auto child_outpoint = std::make_shared<TxOutPoint>(parent->id(), 0);
+    auto child_tin = std::make_shared<TxIn>(child_outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
+    auto child_tout = std::make_shared<TxOut>(390000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+    auto child = std::make_shared<Tx>(std::vector{ child_tin }, std::vector{ child_tout }, 0);
+    direct_insert(child, 10000);
+
+    auto other = make_valid_tx("template_other_src", 50000, 40000);
+    direct_insert(other, 10000);
+
+    auto block_template = Mempool::get_block_template();
+    ASSERT_EQ(3, block_template.txs.size());
+    EXPECT_EQ(parent->id(), block_template.txs[0]->id());
+    EXPECT_EQ(child->id(), block_template.txs[1]->id());
+    EXPECT_EQ(120000, block_template.fees);
+    EXPECT_EQ(Mempool::total_size_bytes, block_template.size);
+
+    Mempool::remove_entry(child->id());
+    Mempool::remove_entry(parent->id());
+
+    block_template = Mempool::get_block_template();
+    ASSERT_EQ(1, block_template.txs.size());
+    EXPECT_EQ(other->id(), block_template.txs[0]->id());
+    EXPECT_EQ(10000, block_template.fees);
+
+    Mempool::clear();
+    block_template = Mempool::get_block_template();
+    EXPECT_TRUE(block_template.txs.empty());
+    EXPECT_EQ(0, block_template.fees);
+}
+
+TEST_F(MempoolPolicyTest, BlockTemplateKeepsParentFirstWhenDisconnectedTxReturns)
+{
+    // The parent is confirmed, so the child enters the pool and the template on its own
+    auto parent = make_valid_tx("template_disconnect_src", 500000, 400000);
+
+    auto child_outpoint = std::make_shared<TxOutPoint>(parent->id(), 0);
+    auto child_tin = std::make_shared<TxIn>(child_outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
+    auto child_tout = std::make_shared<TxOut>(390000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+    auto child = std::make_shared<Tx>(std::vector{ child_tin }, std::vector{ child_tout }, 0);
+    direct_insert(child, 10000);
+
+    auto block_template = Mempool::get_block_template();
+    ASSERT_EQ(1, block_template.txs.size());
+
+    // Its block is disconnected and the parent comes back the way Chain::disconnect_block inserts it
+    direct_insert(parent, 100000);
+
+    block_template = Mempool::get_block_template();
+    ASSERT_EQ(2, block_template.txs.size());
+    EXPECT_EQ(parent->id(), block_template.txs[0]->id());
+    EXPECT_EQ(child->id(), block_template.txs[1]->id());
+    EXPECT_EQ(110000, block_template.fees);
+}
+
+TEST_F(MempoolPolicyTest, BlockTemplateRefillsAfterRemovalWhenTxsWereLeftOut)
+{
+    // Two txs of which only one fits in a block
+    std::vector<std::shared_ptr<Tx>> large_txs;
+    for (const auto& source_id : { "template_large_src1", "template_large_src2" })
+    {
+        auto tx = make_valid_tx(source_id, 1000000, 1);
+        while (tx->serialize().get_size() < NetParams::MAX_BLOCK_SERIALIZED_SIZE_IN_BYTES * 3 / 5)
+        {
+            for (int i = 0; i < 1000; i++)
+                tx->tx_outs.push_back(std::make_shared<TxOut>(1, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs"));
+        }
+        large_txs.push_back(tx);
+    }
+    direct_insert(large_txs[0], 2000000);
+    direct_insert(large_txs[1], 1000000);
+
+    auto block_template = Mempool::get_block_template();
+    ASSERT_EQ(1, block_template.txs.size());
+    EXPECT_EQ(large_txs[0]->id(), block_template.txs[0]->id());
+
+    // As after a block confirming it connects
+    Mempool::remove_entry(large_txs[0]->id());
+
+    block_template = Mempool::get_block_template();
+    ASSERT_EQ(1, block_template.txs.size());
+    EXPECT_EQ(large_txs[1]->id(), block_template.txs[0]->id());
+    EXPECT_EQ(1000000, block_template.fees);
+}
+
+TEST_F(MempoolPolicyTest, SpenderIndexFollowsInsertAndRemove)
+{
+    auto tx = make_valid_tx("spender_index_src", 50000, 40000);
+    direct_insert(tx, 10000);
+
+    const auto spent = std::make_shared<TxOutPoint>("spender_index_src", 0);
+    ASSERT_TRUE(Mempool::spenders.contains(spent));
+    EXPECT_EQ(tx->id(), Mempool::spenders.at(spent));
+    EXPECT_FALSE(Mempool::spenders.contains(std::make_shared<TxOutPoint>("spender_index_src", 1)));
+
+    Mempool::remove_entry(tx->id());
+    EXPECT_FALSE(Mempool::spenders.contains(spent));
+}
+
+TEST_F(MempoolPolicyTest, PackageStateFollowsGraphChanges)
+{
+    auto parent = make_valid_tx("package_state_src", 500000, 400000);
+    direct_insert(parent, 100000);
+
+    std::vector<std::shared_ptr<Tx>> chain{ parent };
+    for (uint64_t value : { 390000, 380000 })
+    {
+        auto outpoint = std::make_shared<TxOutPoint>(chain.back()->id(), 0);
+        auto tin = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
+        auto tout = std::make_shared<TxOut>(value, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+        chain.push_back(std::make_shared<Tx>(std::vector{ tin }, std::vector{ tout }, 0));
+        direct_insert(chain.back(), 10000);
+    }
+
+    const auto& parent_entry = Mempool::map.at(chain[0]->id());
+    EXPECT_EQ(3, parent_entry.descendant_count);
+    EXPECT_EQ(120000, parent_entry.descendant_fee);
+    EXPECT_EQ(1, parent_entry.ancestor_count);
+    EXPECT_EQ(std::unordered_set{ chain[1]->id() }, parent_entry.children);
+
+    const auto& grandchild_entry = Mempool::map.at(chain[2]->id());
+    EXPECT_EQ(3, grandchild_entry.ancestor_count);
+    EXPECT_EQ(120000, grandchild_entry.ancestor_fee);
+    EXPECT_EQ(Mempool::total_size_bytes, grandchild_entry.ancestor_size);
+
+    Mempool::remove_entry(chain[1]->id());
+
+    EXPECT_EQ(1, Mempool::map.at(chain[0]->id()).descendant_count);
+    EXPECT_TRUE(Mempool::map.at(chain[0]->id()).children.empty());
+    EXPECT_EQ(1, Mempool::map.at(chain[2]->id()).ancestor_count);
+    EXPECT_TRUE(Mempool::map.at(chain[2]->id()).parents.empty());
+}
+
+TEST_F(MempoolPolicyTest, PackageStateCountsSharedDescendantsOnce)
+{
+    // A parent whose two children are both spent by one grandchild
+    auto parent = make_valid_tx("diamond_src", 500000, 200000);
+    parent->tx_outs.push_back(std::make_shared<TxOut>(200000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs"));
+    direct_insert(parent, 100000);
+
+    std::vector<std::shared_ptr<Tx>> children;
+    for (int64_t idx : { 0, 1 })
+    {
+        auto outpoint = std::make_shared<TxOutPoint>(parent->id(), idx);
+        auto tin = std::make_shared<TxIn>(outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
+        auto tout = std::make_shared<TxOut>(190000 - 10000 * idx, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+        children.push_back(std::make_shared<Tx>(std::vector{ tin }, std::vector{ tout }, 0));
+        direct_insert(children.back(), 10000 + 10000 * idx);
+    }
+
+    std::vector<std::shared_ptr<TxIn>> grandchild_tins;
+    for (const auto& child : children)
+    {
+        auto outpoint = std::make_shared<TxOutPoint>(child->id(), 0);
+        grandchild_tins.push_back(std::make_shared<TxIn>(outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1));
+    }
+    auto grandchild_tout = std::make_shared<TxOut>(340000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+    auto grandchild = std::make_shared<Tx>(grandchild_tins, std::vector{ grandchild_tout }, 0);
+    direct_insert(grandchild, 30000);
+
+    EXPECT_EQ(4, Mempool::map.at(parent->id()).descendant_count);
+    EXPECT_EQ(160000, Mempool::map.at(parent->id()).descendant_fee);
+    EXPECT_EQ(Mempool::total_size_bytes, Mempool::map.at(parent->id()).descendant_size);
+    EXPECT_EQ(4, Mempool::map.at(grandchild->id()).ancestor_count);
+    EXPECT_EQ(160000, Mempool::map.at(grandchild->id()).ancestor_fee);
+
+    // As when the parent confirms
+    Mempool::remove_entry(parent->id());
+
+    EXPECT_EQ(3, Mempool::map.at(grandchild->id()).ancestor_count);
+    EXPECT_EQ(60000, Mempool::map.at(grandchild->id()).ancestor_fee);
+    EXPECT_EQ(Mempool::total_size_bytes, Mempool::map.at(grandchild->id()).ancestor_size);
+    EXPECT_EQ(1, Mempool::map.at(children[1]->id()).ancestor_count);
+    EXPECT_EQ(2, Mempool::map.at(children[1]->id()).descendant_count);
+    EXPECT_EQ(50000, Mempool::map.at(children[1]->id()).descendant_fee);
+
+    // The cheaper child's package goes, grandchild first, leaving the other child on its own
+    Mempool::trim_to_size(Mempool::get_memory_usage() - 1);
+
+    ASSERT_EQ(1, Mempool::map.size());
+    const auto& survivor = Mempool::map.at(children[1]->id());
+    EXPECT_TRUE(survivor.children.empty());
+    EXPECT_EQ(1, survivor.descendant_count);
+    EXPECT_EQ(survivor.fee, survivor.descendant_fee);
+
+    Mempool::trim_to_size(0);
+    EXPECT_TRUE(Mempool::map.empty());
+}
+
+TEST_F(MempoolPolicyTest, TrimEvictsLowestDescendantScoreAndRaisesMinFee)
+{
+    auto parent = make_valid_tx("trim_parent_src", 500000, 499000);
+    direct_insert(parent, 1000);
+
+    auto child_outpoint = std::make_shared<TxOutPoint>(parent->id(), 0);
+    auto child_tin = std::make_shared<TxIn>(child_outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
+    auto child_tout = std::make_shared<TxOut>(400000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+    auto child = std::make_shared<Tx>(std::vector{ child_tin }, std::vector{ child_tout }, 0);
+    direct_insert(child, 99000);
+
+    auto low = make_valid_tx("trim_low_src", 500000, 495000);
+    direct_insert(low, 5000);
+
+    EXPECT_EQ(0, Mempool::get_min_fee_per_kb());
+
+    // The parent pays less than the low tx, but its child lifts its descendant score above it
+    const auto& low_entry = Mempool::map.at(low->id());
+    const uint64_t expected_min_fee = low_entry.fee * 1000 / low_entry.serialized_size + NetParams::INCREMENTAL_RELAY_FEE;
+    Mempool::trim_to_size(Mempool::get_memory_usage() - 1);
+
+    EXPECT_FALSE(Mempool::map.contains(low->id()));
+    EXPECT_TRUE(Mempool::map.contains(parent->id()));
+    EXPECT_TRUE(Mempool::map.contains(child->id()));
+    // Reads don't write the decayed value back, so back to back reads don't erode it
+    for (int i = 0; i < 10000; i++)
+        ASSERT_EQ(expected_min_fee, Mempool::get_min_fee_per_kb());
+
+    Mempool::trim_to_size(0);
+    EXPECT_TRUE(Mempool::map.empty());
+    EXPECT_EQ(0, Mempool::total_size_bytes);
+    EXPECT_EQ(0, Mempool::total_memory_usage);
+}
+
+TEST_F(MempoolPolicyTest, ExpiryRemovesOnlyExpiredTxsAndTheirDescendants)
+{
+    auto old_tx = make_valid_tx("expiry_old_src", 500000, 490000);
+    Mempool::MempoolEntry old_entry;
+    old_entry.tx = old_tx;
+    old_entry.serialized_size = old_tx->serialize().get_size();
+    old_entry.fee = 10000;
+    old_entry.fee_rate = old_entry.fee / old_entry.serialized_size;
+    old_entry.insertion_time = std::chrono::steady_clock::now() -
+        std::chrono::seconds(NetParams::MEMPOOL_TX_EXPIRE_SECS + 1);
+    Mempool::insert_entry(old_tx->id(), std::move(old_entry));
+
+    auto child_outpoint = std::make_shared<TxOutPoint>(old_tx->id(), 0);
+    auto child_tin = std::make_shared<TxIn>(child_outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
+    auto child_tout = std::make_shared<TxOut>(480000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+    auto child = std::make_shared<Tx>(std::vector{ child_tin }, std::vector{ child_tout }, 0);
+    direct_insert(child, 10000);
+
+    auto fresh = make_valid_tx("expiry_fresh_src", 50000, 40000);
+    direct_insert(fresh, 10000);
+
+    Mempool::expire_old_transactions();
+
+    EXPECT_FALSE(Mempool::map.contains(old_tx->id()));
+    EXPECT_FALSE(Mempool::map.contains(child->id()));
+    EXPECT_TRUE(Mempool::map.contains(fresh->id()));
+}
+
+TEST_F(MempoolPolicyTest, SavedMempoolIsRevalidatedOnLoad)
+{
+    auto parent = make_signed_tx(std::make_shared<TxOutPoint>("persist_src", 0), 490000);
+    UTXO::add_to_map(std::make_shared<TxOut>(500000, parent->tx_outs[0]->to_address()), "persist_src", 0, false, 1);
+    Mempool::add_tx_to_mempool(parent);
+    auto child = make_signed_tx(std::make_shared<TxOutPoint>(parent->id(), 0), 480000);
+    Mempool::add_tx_to_mempool(child);
+    ASSERT_TRUE(Mempool::map.contains(parent->id()));
+    ASSERT_TRUE(Mempool::map.contains(child->id()));
+
+    auto unsigned_tx = make_valid_tx("persist_unsigned_src", 50000, 40000);
+    direct_insert(unsigned_tx, 10000);
+
+    const auto parent_insertion_time = Mempool::map[parent->id()].insertion_time;
+
+    const std::string path = "test_mempool.dat";
+    Mempool::save_to_disk(path);
+    Mempool::clear();
+
+    EXPECT_EQ(2, Mempool::load_from_disk(path));
+    std::remove(path.c_str());
+
+    ASSERT_TRUE(Mempool::map.contains(parent->id()));
+    EXPECT_TRUE(Mempool::map.contains(child->id()));
+    EXPECT_FALSE(Mempool::map.contains(unsigned_tx->id()));
+    EXPECT_EQ(10000, Mempool::map[parent->id()].fee);
+    EXPECT_LE(Mempool::map[parent->id()].insertion_time, parent_insertion_time + std::chrono::seconds(1));
+    EXPECT_GE(Mempool::map[parent->id()].insertion_time, parent_insertion_time - std::chrono::seconds(2));
+}
+
+TEST_F(MempoolPolicyTest, SaveReplacesThePreviousFile)
+{
+    auto tx = make_valid_tx("replace_save_src", 50000, 40000);
+    direct_insert(tx, 10000);
+
+    const std::string path = "test_mempool_replace.dat";
+    Mempool::save_to_disk(path);
+    const auto first_size = std::filesystem::file_size(path);
+
+    Mempool::clear();
+    Mempool::save_to_disk(path);
+
+    EXPECT_TRUE(std::filesystem::exists(path));
+    EXPECT_FALSE(std::filesystem::exists(path + ".new"));
+    EXPECT_LT(std::filesystem::file_size(path), first_size);
+    std::remove(path.c_str());
+}
+
+TEST_F(MempoolPolicyTest, CorruptSavedMempoolLoadsNothing)
+{
+    const std::string path = "test_mempool_corrupt.dat";
+
+    // Claims the most entries a count can hold, followed by a truncated tx
+    BinaryBuffer mempool_data;
+    mempool_data.write_size(std::numeric_limits<uint32_t>::max());
+    mempool_data.write(static_cast<uint32_t>(1));
+    {
+        std::ofstream mempool_out(path, std::ios::binary | std::ios::trunc);
+        const auto& buffer = mempool_data.get_buffer();
+        mempool_out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    }
+
+    EXPECT_EQ(0, Mempool::load_from_disk(path));
+    std::remove(path.c_str());
+    EXPECT_TRUE(Mempool::map.empty());
+}
+
+TEST_F(MempoolPolicyTest, OrphanIsRetriedWhenItsParentArrives)
+{
+    auto parent = make_signed_tx(std::make_shared<TxOutPoint>("orphan_parent_src", 0), 490000);
+    UTXO::add_to_map(std::make_shared<TxOut>(500000, parent->tx_outs[0]->to_address()), "orphan_parent_src", 0,
+        false, 1);
+    auto child = make_signed_tx(std::make_shared<TxOutPoint>(parent->id(), 0), 480000);
+    auto grandchild = make_signed_tx(std::make_shared<TxOutPoint>(child->id(), 0), 470000);
+
+    Mempool::add_tx_to_mempool(grandchild);
+    Mempool::add_tx_to_mempool(child);
+    EXPECT_FALSE(Mempool::map.contains(child->id()));
+    EXPECT_EQ(2, Mempool::orphan_txs.size());
+    ASSERT_TRUE(Mempool::orphans_by_outpoint.contains(std::make_shared<TxOutPoint>(parent->id(), 0)));
+
+    Mempool::add_tx_to_mempool(parent);
+    EXPECT_TRUE(Mempool::map.contains(parent->id()));
+    EXPECT_TRUE(Mempool::map.contains(child->id()));
+    EXPECT_TRUE(Mempool::map.contains(grandchild->id()));
+    EXPECT_TRUE(Mempool::orphan_txs.empty());
+    EXPECT_TRUE(Mempool::orphans_by_outpoint.empty());
+    EXPECT_EQ(0, Mempool::orphan_txs_size_bytes);
+}
+
+TEST_F(MempoolPolicyTest, OrphanPoolIsCappedAndErasedPerPeer)
+{
+    boost::asio::io_context io_context;
+    auto peer = std::make_shared<Connection>(io_context);
+
+    for (uint32_t i = 0; i < NetParams::MAX_ORPHAN_TXS + 10; i++)
+    {
+        auto orphan = make_valid_tx("orphan_cap_src_" + std::to_string(i), 50000, 40000);
+        UTXO::remove_from_map("orphan_cap_src_" + std::to_string(i), 0);
+        Mempool::add_tx_to_mempool(orphan, i % 2 == 0 ? peer : nullptr);
+    }
+    EXPECT_EQ(NetParams::MAX_ORPHAN_TXS, Mempool::orphan_txs.size());
+    EXPECT_EQ(NetParams::MAX_ORPHAN_TXS, Mempool::orphans_by_outpoint.size());
+
+    Mempool::erase_orphans_from_peer(peer);
+    EXPECT_FALSE(Mempool::orphan_txs.empty());
+    for (const auto& orphan : Mempool::orphan_txs | std::views::values)
+        EXPECT_EQ(nullptr, orphan.from_peer);
+}
+
+TEST_F(MempoolPolicyTest, BatchAdmitsParentsFirstAndDropsBadSignatures)
+{
+    auto parent = make_signed_tx(std::make_shared<TxOutPoint>("batch_parent_src", 0), 490000);
+    UTXO::add_to_map(std::make_shared<TxOut>(500000, parent->tx_outs[0]->to_address()), "batch_parent_src", 0,
+        false, 1);
+    auto child = make_signed_tx(std::make_shared<TxOutPoint>(parent->id(), 0), 480000);
+    auto grandchild = make_signed_tx(std::make_shared<TxOutPoint>(child->id(), 0), 470000);
+    auto unsigned_tx = make_valid_tx("batch_unsigned_src", 50000, 40000);
+
+    EXPECT_EQ(3, Mempool::add_txs_to_mempool({ grandchild, unsigned_tx, child, parent }));
+    EXPECT_TRUE(Mempool::map.contains(parent->id()));
+    EXPECT_TRUE(Mempool::map.contains(child->id()));
+    EXPECT_TRUE(Mempool::map.contains(grandchild->id()));
+    EXPECT_FALSE(Mempool::map.contains(unsigned_tx->id()));
+    EXPECT_TRUE(Mempool::orphan_txs.empty());
+}
+
+TEST_F(MempoolPolicyTest, MemoryUsageCountsEntriesAndLinks)
+{
+    auto parent = make_valid_tx("memory_parent_src", 500000, 490000);
+    direct_insert(parent, 10000);
+    const auto& parent_entry = Mempool::map.at(parent->id());
+    EXPECT_GT(parent_entry.memory_usage, 2 * parent_entry.serialized_size);
+    EXPECT_EQ(parent_entry.memory_usage, Mempool::total_memory_usage);
+    EXPECT_GT(Mempool::get_memory_usage(), Mempool::total_memory_usage);
+
+    auto child_outpoint = std::make_shared<TxOutPoint>(parent->id(), 0);
+    auto child_tin = std::make_shared<TxIn>(child_outpoint, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
+    auto child_tout = std::make_shared<TxOut>(480000, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+    auto child = std::make_shared<Tx>(std::vector{ child_tin }, std::vector{ child_tout }, 0);
+    direct_insert(child, 10000);
+
+    // The link between the two costs on top of both entries
+    const auto& child_entry = Mempool::map.at(child->id());
+    EXPECT_GT(Mempool::total_memory_usage, parent_entry.memory_usage + child_entry.memory_usage);
+
+    Mempool::remove_entry(parent->id());
+    EXPECT_EQ(Mempool::map.at(child->id()).memory_usage, Mempool::total_memory_usage);
+    Mempool::remove_entry(child->id());
+    EXPECT_EQ(0, Mempool::total_memory_usage);
+}
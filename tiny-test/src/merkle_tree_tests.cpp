@@ -111,7 +111,7 @@ TEST(MerkleTreeTest, FourLeavesPowerOfTwo)
 TEST(MerkleTreeTest, GetRootOfTxsConsistentWithGetRoot)
 {
 	auto tx_in = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>{0x01}, std::vector<uint8_t>{}, -1);
-	auto tx_out = std::make_shared<TxOut>(100, "addr");
+	auto tx_out = std::make_shared<TxOut>(100, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto tx1 = std::make_shared<Tx>(std::vector{ tx_in }, std::vector{ tx_out }, 0);
 
 	auto tx_in2 = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>{0x02}, std::vector<uint8_t>{}, -1);
@@ -1,8 +1,16 @@
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
+#include <boost/asio.hpp>
 
+#include "net/connection.hpp"
+#include "net/i_msg.hpp"
+#include "net/msg_queue.hpp"
 #include "net/msg_serializer.hpp"
 #include "core/tx.hpp"
 #include "core/tx_in.hpp"
@@ -19,7 +27,7 @@ TEST(MsgTest, SpendMsg)
 	tx_ins.push_back(tx_in);
 
 	std::vector<std::shared_ptr<TxOut>> tx_outs;
-	const auto tx_out = std::make_shared<TxOut>(0, "foo");
+	const auto tx_out = std::make_shared<TxOut>(0, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	tx_outs.push_back(tx_out);
 
 	const auto tx = std::make_shared<Tx>(tx_ins, tx_outs, 0);
@@ -28,9 +36,9 @@ TEST(MsgTest, SpendMsg)
 		tx->tx_outs);
 	const auto spend_msg_str = Utils::byte_array_to_hex_string(spend_msg);
 
-	EXPECT_EQ("d2cde10c62cdc1707ad78d7356e01a73d1376a7a1f775ca6d207d8a511fdff19", spend_msg_str);
+	EXPECT_EQ("c3efb348975cd54d584ec042b62c7f686deb5334eaf357b0e4e40fb892c3cbbe", spend_msg_str);
 
-	const auto tx_out2 = std::make_shared<TxOut>(0, "foo");
+	const auto tx_out2 = std::make_shared<TxOut>(0, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	tx->tx_outs.push_back(tx_out2);
 
 	const auto spend_msg2 = MsgSerializer::build_spend_msg(tx_in->to_spend, tx_in->unlock_pub_key, tx_in->sequence,
@@ -38,4 +46,135 @@ TEST(MsgTest, SpendMsg)
 	const auto spend_msg2_str = Utils::byte_array_to_hex_string(spend_msg2);
 
 	EXPECT_NE(spend_msg_str, spend_msg2_str);
+
+	// Outputs encoded once for all inputs sign the same message
+	EXPECT_EQ(spend_msg2, MsgSerializer::build_spend_msg(tx_in->to_spend, tx_in->unlock_pub_key, tx_in->sequence,
+		MsgSerializer::serialize_tx_outs(tx->tx_outs)));
+}
+
+class RecordingMsg : public IMsg
+{
+public:
+	RecordingMsg(Opcode opcode, std::string name, std::vector<std::string>& handled, std::mutex& handled_mutex)
+		: opcode(opcode), name(std::move(name)), handled(handled), handled_mutex(handled_mutex)
+	{}
+
+	void handle([[maybe_unused]] const std::shared_ptr<Connection>& con) override
+	{
+		std::scoped_lock lock(handled_mutex);
+		handled.push_back(name);
+	}
+
+	BinaryBuffer serialize() const override
+	{
+		return BinaryBuffer();
+	}
+
+	bool deserialize([[maybe_unused]] BinaryBuffer& buffer) override
+	{
+		return true;
+	}
+
+	Opcode get_opcode() const override
+	{
+		return opcode;
+	}
+
+private:
+	Opcode opcode;
+	std::string name;
+	std::vector<std::string>& handled;
+	std::mutex& handled_mutex;
+};
+
+TEST(MsgTest, MsgQueueServesBlocksFirstAndPeersInTurn)
+{
+	boost::asio::io_context io_context;
+	const auto con_a = std::make_shared<Connection>(io_context);
+	const auto con_b = std::make_shared<Connection>(io_context);
+
+	std::vector<std::string> handled;
+	std::mutex handled_mutex;
+	const auto push = [&](const std::shared_ptr<Connection>& con, Opcode opcode, const std::string& name)
+	{
+		return MsgQueue::push(con, std::make_unique<RecordingMsg>(opcode, name, handled, handled_mutex), 1, [] {});
+	};
+
+	EXPECT_TRUE(push(con_a, Opcode::TxInfoMsg, "a_tx1"));
+	EXPECT_TRUE(push(con_a, Opcode::TxInfoMsg, "a_tx2"));
+	EXPECT_TRUE(push(con_a, Opcode::GetUTXOsMsg, "a_request"));
+	EXPECT_TRUE(push(con_b, Opcode::TxInfoMsg, "b_tx"));
+	EXPECT_TRUE(push(con_a, Opcode::BlockInfoMsg, "a_block"));
+	EXPECT_TRUE(push(con_b, Opcode::PeerHelloMsg, "b_hello"));
+	EXPECT_EQ(6, MsgQueue::get_pending_count());
+
+	// A single worker makes the order deterministic
+	MsgQueue::start(1);
+	for (int i = 0; i < 500 && MsgQueue::get_pending_count() > 0; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	MsgQueue::stop();
+
+	const std::vector<std::string> expected{ "b_hello", "a_block", "a_tx1", "b_tx", "a_tx2", "a_request" };
+	EXPECT_EQ(expected, handled);
+}
+
+TEST(MsgTest, MsgQueuePausesReadingUntilPeerDrains)
+{
+	boost::asio::io_context io_context;
+	const auto con = std::make_shared<Connection>(io_context);
+
+	std::vector<std::string> handled;
+	std::mutex handled_mutex;
+	bool resumed = false;
+	const auto half = MsgQueue::MAX_QUEUED_BYTES_PER_PEER / 2;
+
+	EXPECT_TRUE(MsgQueue::push(con, std::make_unique<RecordingMsg>(Opcode::TxInfoMsg, "tx1", handled, handled_mutex),
+		half, [] {}));
+	EXPECT_FALSE(MsgQueue::push(con, std::make_unique<RecordingMsg>(Opcode::TxInfoMsg, "tx2", handled,
+		handled_mutex), half, [&resumed] { resumed = true; }));
+
+	MsgQueue::start(1);
+	for (int i = 0; i < 500 && MsgQueue::get_pending_count() > 0; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	MsgQueue::stop();
+
+	EXPECT_TRUE(resumed);
+	EXPECT_EQ(2, handled.size());
+
+	// Queued messages of a removed peer are dropped
+	EXPECT_TRUE(MsgQueue::push(con, std::make_unique<RecordingMsg>(Opcode::TxInfoMsg, "tx3", handled, handled_mutex),
+		1, [] {}));
+	MsgQueue::erase_peer(con);
+	EXPECT_EQ(0, MsgQueue::get_pending_count());
+}
+
+TEST(MsgTest, MsgQueueDoesNotStarveRequestsBehindBlocks)
+{
+	boost::asio::io_context io_context;
+	const auto con_a = std::make_shared<Connection>(io_context);
+	const auto con_b = std::make_shared<Connection>(io_context);
+
+	std::vector<std::string> handled;
+	std::mutex handled_mutex;
+	const auto push = [&](const std::shared_ptr<Connection>& con, Opcode opcode, const std::string& name)
+	{
+		return MsgQueue::push(con, std::make_unique<RecordingMsg>(opcode, name, handled, handled_mutex), 1, [] {});
+	};
+
+	EXPECT_TRUE(push(con_a, Opcode::GetHeadersMsg, "a_get_headers"));
+	constexpr size_t block_count = 4 * MsgQueue::MAX_PRIORITY_SKIPS;
+	for (size_t i = 0; i < block_count; i++)
+	{
+		EXPECT_TRUE(push(con_a, Opcode::BlocksMsg, "a_block"));
+		EXPECT_TRUE(push(con_b, Opcode::BlocksMsg, "b_block"));
+	}
+
+	MsgQueue::start(1);
+	for (int i = 0; i < 500 && MsgQueue::get_pending_count() > 0; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	MsgQueue::stop();
+
+	// Taken once the blocks have gone ahead of it as often as allowed, not after all of them
+	ASSERT_EQ(2 * block_count + 1, handled.size());
+	EXPECT_EQ("a_get_headers", handled[MsgQueue::MAX_PRIORITY_SKIPS]);
 }
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include "util/binary_buffer.hpp"
+#include "crypto/sha256.hpp"
+#include "net/connection.hpp"
+#include "net/framed_msg.hpp"
+#include "net/get_block_msg.hpp"
+#include "net/msg_queue.hpp"
+#include "net/net_client.hpp"
+#include "net/peer_hello_msg.hpp"
+#include <gtest/gtest.h>
+
+class NetClientTest : public ::testing::Test
+{
+protected:
+	static constexpr auto MAGIC_SIZE = NetClient::MAGIC_SIZE;
+	static constexpr auto CHECKSUM_SIZE = NetClient::CHECKSUM_SIZE;
+	static constexpr auto HEADER_SIZE = NetClient::HEADER_SIZE;
+	static constexpr auto MAX_SEND_QUEUE_BYTES = NetClient::MAX_SEND_QUEUE_BYTES;
+	static constexpr auto magic = NetClient::magic;
+
+	// The test bodies are not friends of NetClient themselves
+	static std::shared_ptr<const FramedMsg> frame_msg(const IMsg& msg)
+	{
+		return NetClient::frame_msg(msg);
+	}
+
+	static void write(const std::shared_ptr<Connection>& con, const std::shared_ptr<const FramedMsg>& framed_msg)
+	{
+		NetClient::write(con, framed_msg);
+	}
+
+	static void start_reading(const std::shared_ptr<Connection>& con)
+	{
+		boost::asio::post(con->strand, [con] { NetClient::do_async_read_header(con); });
+	}
+
+	static void add_connection(const std::shared_ptr<Connection>& con)
+	{
+		std::scoped_lock lock(NetClient::connections_mutex);
+
+		NetClient::connections.push_back(con);
+	}
+
+	static void remove_connection(const std::shared_ptr<Connection>& con)
+	{
+		NetClient::remove_connection(con);
+	}
+
+	static std::vector<std::shared_ptr<Connection>> get_connections()
+	{
+		std::scoped_lock lock(NetClient::connections_mutex);
+
+		return NetClient::connections;
+	}
+
+	static size_t get_miner_connection_count()
+	{
+		std::scoped_lock lock(NetClient::connections_mutex);
+
+		return NetClient::miner_connections.size();
+	}
+
+	static uint16_t get_listen_port()
+	{
+		return NetClient::acceptor.local_endpoint().port();
+	}
+
+	// Also closes the acceptor and readies the io context, which stop leaves as they are, for the next run
+	static void stop()
+	{
+		NetClient::stop();
+		NetClient::acceptor.close();
+		NetClient::io_context.restart();
+	}
+
+	static bool has_connection(const std::shared_ptr<Connection>& con)
+	{
+		std::scoped_lock lock(NetClient::connections_mutex);
+
+		return std::ranges::find(NetClient::connections, con) != NetClient::connections.end();
+	}
+
+	// Connects the peer's socket over loopback and returns the other end
+	static boost::asio::ip::tcp::socket connect_pair(boost::asio::io_context& io_context,
+		const std::shared_ptr<Connection>& con)
+	{
+		boost::asio::ip::tcp::acceptor acceptor(io_context,
+			boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address_v4("127.0.0.1"), 0));
+		con->socket.connect(acceptor.local_endpoint());
+
+		boost::asio::ip::tcp::socket soc(io_context);
+		acceptor.accept(soc);
+
+		return soc;
+	}
+
+	// Blocks until the next message arrives and returns its payload, opcode first
+	static std::vector<uint8_t> read_payload(boost::asio::ip::tcp::socket& soc)
+	{
+		std::array<uint8_t, HEADER_SIZE> header{};
+		boost::asio::read(soc, boost::asio::buffer(header));
+
+		uint32_t payload_length = 0;
+		std::memcpy(&payload_length, header.data() + MAGIC_SIZE, sizeof(payload_length));
+
+		std::vector<uint8_t> payload(boost::endian::little_to_native(payload_length));
+		boost::asio::read(soc, boost::asio::buffer(payload));
+
+		return payload;
+	}
+};
+
+TEST_F(NetClientTest, QueuedWritesGoOutInOrder)
+{
+	boost::asio::io_context io_context;
+	const auto con = std::make_shared<Connection>(io_context);
+	auto soc = connect_pair(io_context, con);
+
+	auto work = boost::asio::make_work_guard(io_context);
+	std::thread io_thread([&io_context] { io_context.run(); });
+
+	// Enough for several gathered writes, queued while earlier ones are in flight
+	constexpr int msg_count = 100;
+	for (int i = 0; i < msg_count; i++)
+		write(con, frame_msg(GetBlockMsg(std::to_string(i))));
+
+	for (int i = 0; i < msg_count; i++)
+	{
+		auto payload = read_payload(soc);
+		ASSERT_FALSE(payload.empty());
+		EXPECT_EQ(static_cast<OpcodeType>(Opcode::GetBlockMsg), payload[0]);
+
+		BinaryBuffer buffer(std::vector(payload.begin() + 1, payload.end()));
+		GetBlockMsg msg;
+		ASSERT_TRUE(msg.deserialize(buffer));
+		EXPECT_EQ(std::to_string(i), msg.from_block_id);
+	}
+
+	work.reset();
+	io_thread.join();
+
+	std::scoped_lock lock(con->write_mutex);
+	EXPECT_TRUE(con->send_queue.empty());
+	EXPECT_EQ(0, con->queued_bytes);
+	EXPECT_FALSE(con->write_in_progress);
+}
+
+TEST_F(NetClientTest, PeerOverSendQueueLimitIsDropped)
+{
+	boost::asio::io_context io_context;
+	const auto con = std::make_shared<Connection>(io_context);
+	auto soc = connect_pair(io_context, con);
+	add_connection(con);
+
+	auto framed_msg = std::make_shared<FramedMsg>();
+	framed_msg->header.resize(HEADER_SIZE);
+	framed_msg->body.resize(MAX_SEND_QUEUE_BYTES / 4);
+
+	// The io context is not running, so nothing leaves the queue
+	for (int i = 0; i < 3; i++)
+		write(con, framed_msg);
+	EXPECT_TRUE(has_connection(con));
+
+	write(con, framed_msg);
+	EXPECT_FALSE(has_connection(con));
+	{
+		std::scoped_lock lock(con->write_mutex);
+
+		EXPECT_EQ(3, con->send_queue.size());
+	}
+
+	// Runs the pending write and then the close posted to the strand
+	io_context.run();
+	EXPECT_FALSE(con->socket.is_open());
+}
+
+TEST_F(NetClientTest, FramedMsgIsReadBack)
+{
+	const auto framed_msg = frame_msg(GetBlockMsg("block_id"));
+	const auto& header = framed_msg->header;
+	ASSERT_EQ(HEADER_SIZE + sizeof(OpcodeType), header.size());
+	EXPECT_EQ(static_cast<OpcodeType>(Opcode::GetBlockMsg), header[HEADER_SIZE]);
+
+	EXPECT_TRUE(std::equal(header.begin(), header.begin() + MAGIC_SIZE, magic.begin()));
+
+	uint32_t payload_length = 0;
+	std::memcpy(&payload_length, header.data() + MAGIC_SIZE, sizeof(payload_length));
+	EXPECT_EQ(sizeof(OpcodeType) + framed_msg->body.size(), boost::endian::little_to_native(payload_length));
+
+	std::vector payload(header.begin() + HEADER_SIZE, header.end());
+	payload.insert(payload.end(), framed_msg->body.begin(), framed_msg->body.end());
+	const auto hash = SHA256::double_hash(payload);
+	EXPECT_TRUE(std::equal(hash.begin(), hash.begin() + CHECKSUM_SIZE, header.begin() + MAGIC_SIZE
+		+ sizeof(payload_length)));
+
+	boost::asio::io_context io_context;
+	const auto con = std::make_shared<Connection>(io_context);
+	auto soc = connect_pair(io_context, con);
+
+	// A bad checksum only drops its message, and the next one is read from where it ended
+	auto corrupt_header = header;
+	corrupt_header[MAGIC_SIZE + sizeof(payload_length)] ^= 0xff;
+	for (const auto& part : { corrupt_header, framed_msg->body, header, framed_msg->body })
+		boost::asio::write(soc, boost::asio::buffer(part));
+
+	start_reading(con);
+	for (int i = 0; i < 500 && MsgQueue::get_pending_count() == 0; i++)
+		io_context.run_for(std::chrono::milliseconds(10));
+	io_context.run_for(std::chrono::milliseconds(10));
+	EXPECT_EQ(1, MsgQueue::get_pending_count());
+
+	MsgQueue::erase_peer(con);
+}
+
+TEST_F(NetClientTest, PeersConnectAndDisconnectAcrossIoThreads)
+{
+	NetClient::listen_async(0);
+	NetClient::run_async(4, 2);
+	const auto endpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address_v4("127.0.0.1"),
+		get_listen_port());
+
+	PeerHelloMsg hello_msg;
+	hello_msg.node_type = NodeType::Miner;
+	const auto framed_hello_msg = frame_msg(hello_msg);
+
+	boost::asio::io_context io_context;
+	std::vector<boost::asio::ip::tcp::socket> peers;
+	constexpr size_t peer_count = 16;
+	for (size_t i = 0; i < peer_count; i++)
+	{
+		auto& soc = peers.emplace_back(io_context);
+		soc.connect(endpoint);
+		boost::asio::write(soc, std::array{ boost::asio::buffer(framed_hello_msg->header),
+			boost::asio::buffer(framed_hello_msg->body) });
+	}
+
+	for (int i = 0; i < 500 && get_miner_connection_count() < peer_count; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_EQ(peer_count, get_connections().size());
+	EXPECT_EQ(peer_count, get_miner_connection_count());
+
+	// Half hang up, removed by their reads failing on the io threads, while this thread removes
+	// every connection, so the close is dispatched onto the strands from both
+	for (size_t i = 0; i < peer_count; i += 2)
+		peers[i].close();
+	for (const auto& con : get_connections())
+		remove_connection(con);
+
+	for (int i = 0; i < 500 && !get_connections().empty(); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_TRUE(get_connections().empty());
+	EXPECT_EQ(0, get_miner_connection_count());
+
+	// The peers that stayed see their connection closed after the node's hello
+	for (size_t i = 1; i < peer_count; i += 2)
+	{
+		std::array<uint8_t, 64> buffer{};
+		boost::system::error_code ec;
+		while (!ec)
+			peers[i].read_some(boost::asio::buffer(buffer), ec);
+		EXPECT_TRUE(ec == boost::asio::error::eof || ec == boost::asio::error::connection_reset) << ec.message();
+	}
+
+	stop();
+}
@@ -20,7 +20,7 @@ TEST(SerializationTest, TxSerialization)
 	tx_ins.push_back(tx_in);
 
 	std::vector<std::shared_ptr<TxOut>> tx_outs;
-	const auto tx_out = std::make_shared<TxOut>(0, "foo");
+	const auto tx_out = std::make_shared<TxOut>(0, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	tx_outs.push_back(tx_out);
 
 	const auto tx = std::make_shared<Tx>(tx_ins, tx_outs, 0);
@@ -41,7 +41,7 @@ TEST(SerializationTest, TxSerialization)
 
 	EXPECT_EQ(1, tx2->tx_outs.size());
 	auto& tx_out2 = tx2->tx_outs[0];
-	EXPECT_EQ(tx_out->to_address, tx_out2->to_address);
+	EXPECT_EQ(tx_out->to_pub_key_hash, tx_out2->to_pub_key_hash);
 	EXPECT_EQ(tx_out->value, tx_out2->value);
 
 	EXPECT_EQ(tx->lock_time, tx2->lock_time);
@@ -69,17 +69,54 @@ TEST(SerializationTest, TxInSerialization)
 
 TEST(SerializationTest, TxOutSerialization)
 {
-	const auto tx_out = std::make_shared<TxOut>(0, "foo");
+	const auto tx_out = std::make_shared<TxOut>(0, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 
 	auto serialized_buffer = tx_out->serialize();
 
 	const auto tx_out2 = std::make_shared<TxOut>();
 	ASSERT_TRUE(tx_out2->deserialize(serialized_buffer));
 
-	EXPECT_EQ(tx_out->to_address, tx_out2->to_address);
+	EXPECT_EQ(tx_out->to_pub_key_hash, tx_out2->to_pub_key_hash);
 	EXPECT_EQ(tx_out->value, tx_out2->value);
 }
 
+TEST(SerializationTest, TxOutCompactEncoding)
+{
+	const TxOut tx_out(5000000000ULL, "1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+
+	EXPECT_EQ(sizeof(uint64_t) + RIPEMD160::HASH_SIZE, tx_out.serialize().get_size());
+	EXPECT_EQ("1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs", tx_out.to_address());
+
+	auto legacy_buffer = tx_out.serialize_legacy();
+	TxOut tx_out2;
+	ASSERT_TRUE(tx_out2.deserialize_legacy(legacy_buffer));
+	EXPECT_EQ(tx_out, tx_out2);
+
+	EXPECT_THROW(TxOut(0, "foo"), std::invalid_argument);
+}
+
+TEST(SerializationTest, TxDeserializesLegacyEncoding)
+{
+	auto to_spend = std::make_shared<TxOutPoint>("foo", 0);
+	const auto tx_in = std::make_shared<TxIn>(to_spend, std::vector<uint8_t>{ 0x01 }, std::vector<uint8_t>(), -1);
+	const auto tx_out = std::make_shared<TxOut>(100, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
+	const Tx tx(std::vector{ tx_in }, std::vector{ tx_out }, 7);
+
+	auto legacy_buffer = tx.serialize_legacy();
+	auto compact_buffer = tx.serialize();
+	EXPECT_LT(compact_buffer.get_size(), legacy_buffer.get_size());
+
+	Tx from_legacy;
+	ASSERT_TRUE(from_legacy.deserialize(legacy_buffer));
+	Tx from_compact;
+	ASSERT_TRUE(from_compact.deserialize(compact_buffer));
+
+	EXPECT_EQ(tx, from_legacy);
+	EXPECT_EQ(tx, from_compact);
+	EXPECT_EQ(tx.id(), from_legacy.id());
+	EXPECT_EQ(tx.id(), from_compact.id());
+}
+
 TEST(SerializationTest, TxOutPointSerialization)
 {
 	const auto tx_out_point = std::make_shared<TxOutPoint>("foo", 0);
@@ -95,7 +132,7 @@ TEST(SerializationTest, TxOutPointSerialization)
 
 TEST(SerializationTest, UnspentTxOutSerialization)
 {
-	auto tx_out = std::make_shared<TxOut>(0, "foo");
+	auto tx_out = std::make_shared<TxOut>(0, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 
 	auto tx_out_point = std::make_shared<TxOutPoint>("foo", 0);
 
@@ -107,7 +144,7 @@ TEST(SerializationTest, UnspentTxOutSerialization)
 	ASSERT_TRUE(utxo2->deserialize(serialized_buffer));
 
 	const auto& tx_out2 = utxo2->tx_out;
-	EXPECT_EQ(tx_out->to_address, tx_out2->to_address);
+	EXPECT_EQ(tx_out->to_pub_key_hash, tx_out2->to_pub_key_hash);
 	EXPECT_EQ(tx_out->value, tx_out2->value);
 
 	const auto& tx_out_point2 = utxo2->tx_out_point;
@@ -168,7 +205,7 @@ TEST(BlockSerializationTest, EmptyBlockRoundTrip)
 
 TEST(BlockSerializationTest, DeserializeTruncatedData)
 {
-	auto tx_out = std::make_shared<TxOut>(100, "addr");
+	auto tx_out = std::make_shared<TxOut>(100, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto tx_in = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
 	auto tx = std::make_shared<Tx>(std::vector{ tx_in }, std::vector{ tx_out }, 0);
 	Block original(1, "prev", "merkle", 100, 24, 999, std::vector<std::shared_ptr<Tx>>{tx});
@@ -204,7 +241,7 @@ TEST(BlockSerializationTest, HeaderPrefixPlusNonceEqualsHeader)
 
 TEST(BlockSerializationTest, CopyAndMoveProduceCorrectId)
 {
-	auto tx_out = std::make_shared<TxOut>(100, "addr");
+	auto tx_out = std::make_shared<TxOut>(100, "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
 	auto tx_in = std::make_shared<TxIn>(nullptr, std::vector<uint8_t>{}, std::vector<uint8_t>{}, -1);
 	auto tx = std::make_shared<Tx>(std::vector{ tx_in }, std::vector{ tx_out }, 0);
 	Block original(1, "prev", "merkle", 100, 24, 42, std::vector<std::shared_ptr<Tx>>{tx});
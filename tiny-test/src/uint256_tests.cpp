@@ -0,0 +1,72 @@
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "crypto/hash_checker.hpp"
+#include "mining/pow.hpp"
+#include "util/uint256_t.hpp"
+#include "util/utils.hpp"
+#include <gtest/gtest.h>
+
+TEST(UInt256Test, HexAndBytesRoundTrip)
+{
+	const std::string hex = "00000e5425a9cafa0a1d5a3c6d0cd1e8e0d1bf0e8cbcc5c8d2a3b1b0f6a2a0c1";
+
+	const auto value = uint256_t::from_hex(hex);
+	ASSERT_TRUE(value.has_value());
+
+	const auto bytes = value->to_be_bytes();
+	EXPECT_EQ(hex, Utils::byte_array_to_hex_string(bytes));
+	EXPECT_EQ(*value, uint256_t::from_be_bytes(bytes));
+
+	EXPECT_EQ(uint256_t(0xABCD), uint256_t::from_hex("0xabcd"));
+	EXPECT_FALSE(uint256_t::from_hex("").has_value());
+	EXPECT_FALSE(uint256_t::from_hex("xyz").has_value());
+	EXPECT_FALSE(uint256_t::from_hex(std::string(65, '1')).has_value());
+}
+
+TEST(UInt256Test, Arithmetic)
+{
+	const uint256_t max = ~uint256_t(0);
+	EXPECT_EQ("115792089237316195423570985008687907853269984665640564039457584007913129639935", max.str());
+	EXPECT_EQ(uint256_t(0), max + 1);
+	EXPECT_EQ(max, uint256_t(0) - 1);
+	EXPECT_EQ(256u, max.bit_length());
+	EXPECT_EQ(0u, uint256_t(0).bit_length());
+
+	const uint256_t one = 1;
+	EXPECT_EQ(uint256_t(1) << 200, (one << 255) >> 55);
+	EXPECT_EQ(201u, (one << 200).bit_length());
+	EXPECT_LT(one << 63, one << 64);
+
+	const auto a = *uint256_t::from_hex("123456789abcdef0fedcba9876543210");
+	const auto b = *uint256_t::from_hex("fedcba98765432100123456789abcdef");
+	const auto product = a * b;
+	EXPECT_EQ(a, product / b);
+	EXPECT_EQ(uint256_t(0), product % b);
+	EXPECT_EQ(uint256_t(7), (product + 7) % a);
+
+	EXPECT_EQ(uint256_t(12345678901234567890ULL), uint256_t(12345678901234567890ULL) * 1);
+	EXPECT_EQ("12345678901234567890", uint256_t(12345678901234567890ULL).str());
+	EXPECT_EQ(one, max / max);
+	EXPECT_EQ(uint256_t(0), max / 0);
+}
+
+TEST(UInt256Test, TargetsAndWork)
+{
+	EXPECT_EQ(uint256_t(1) << 231, PoW::get_target(24));
+	EXPECT_EQ(uint256_t((1ULL << 25) - 1), PoW::get_block_work(24));
+	EXPECT_EQ(uint256_t(1), PoW::get_block_work(0));
+
+	const auto target_bytes = PoW::target_to_bytes(PoW::get_target(24));
+	ASSERT_EQ(uint256_t::BYTE_SIZE, target_bytes.size());
+	EXPECT_EQ(0x80, target_bytes[3]);
+
+	std::array<uint8_t, uint256_t::BYTE_SIZE> hash{};
+	hash[3] = 0x7F;
+	EXPECT_TRUE(HashChecker::is_valid(hash, PoW::get_target(24)));
+	EXPECT_TRUE(HashChecker::is_valid(Utils::byte_array_to_hex_string(hash), PoW::get_target(24)));
+	hash[3] = 0x80;
+	EXPECT_FALSE(HashChecker::is_valid(hash, PoW::get_target(24)));
+	EXPECT_FALSE(HashChecker::is_valid(Utils::byte_array_to_hex_string(hash), PoW::get_target(24)));
+}
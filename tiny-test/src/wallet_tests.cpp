@@ -28,6 +28,24 @@ TEST(WalletTest, PubKeyToAddress_TestVectors)
 	}
 }
 
+TEST(WalletTest, AddressToPubKeyHash_RoundTrip)
+{
+	const auto pub_key = Utils::hex_string_to_byte_array(
+		"0250863ad64a87ae8a2fe83c1af1a8403cb53f53e486d8511dad8a04887e5b2352");
+	const auto pub_key_hash = Wallet::pub_key_to_hash(pub_key);
+
+	EXPECT_EQ("f54a5851e9372b87810a8e60cdd2e7cfd80b6e31", Utils::byte_array_to_hex_string(pub_key_hash));
+
+	const auto decoded = Wallet::address_to_pub_key_hash("1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs");
+	ASSERT_TRUE(decoded.has_value());
+	EXPECT_EQ(pub_key_hash, *decoded);
+	EXPECT_EQ("1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAs", Wallet::pub_key_hash_to_address(pub_key_hash));
+
+	EXPECT_FALSE(Wallet::address_to_pub_key_hash("1PMycacnJaSqwwJqjawXBErnLsZ7RkXUAt").has_value());
+	EXPECT_FALSE(Wallet::address_to_pub_key_hash("foo").has_value());
+	EXPECT_FALSE(Wallet::address_to_pub_key_hash("").has_value());
+}
+
 TEST(WalletTest, AddressDerivationAndKeys)
 {
 	auto [priv_key, pub_key] = ECDSA::generate();